@@ -12,7 +12,10 @@ namespace JsonRpc
         // 请求管理类
         // 由于muduo是异步网络库，并发地发送多个请求，接收多个响应
         // 导致接收到响应时，无法确定是哪一个请求的响应
-        // 因此使用rid做一个映射，收到响应时，查询哈希表的rid，获取对应的请求
+        // 因此使用关联 id 做一个映射，收到响应时，查询哈希表的关联 id，获取对应的请求
+        // 关联 id 在发送时从 Requestor 的计数器分配，单调递增，不随重连而复位
+        // 否则重连后的连接可能复用旧连接的地址和 id，覆盖仍在等待的描述对象
+        // 一个 Requestor 可能管理连接池中多个连接的请求，因此以 (连接, 关联 id) 为键
         class Requestor
         {
         public:
@@ -32,14 +35,19 @@ namespace JsonRpc
             // 收到响应的回调，注册到dispatcher
             void onResponse(const BaseConnection::s_ptr& conn, BaseMessage::s_ptr& msg)
             {
-                std::string rid = msg->rid();
-                if (_req_descs.count(rid) == 0)
+                RequestKey key(conn.get(), msg->cid());
+                RequestDescriber::s_ptr reqDesc;
                 {
-                    E_LOG("%s 请求不存在", rid.c_str());
-                    return;
+                    // 多个请求同时在途时，发送线程会并发地插入描述对象
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    auto it = _req_descs.find(key);
+                    if (it == _req_descs.end())
+                    {
+                        E_LOG("%lu 请求不存在", (unsigned long)key.second);
+                        return;
+                    }
+                    reqDesc = it->second;
                 }
-
-                RequestDescriber::s_ptr reqDesc = _req_descs[rid];
                 if (reqDesc->rtype == ReqType::REQ_ASYNC)
                 {
                     // 异步请求，响应到达后，设置异步future的值
@@ -56,7 +64,7 @@ namespace JsonRpc
                     E_LOG("不存在的请求类型!");
                 }
 
-                delDescriber(rid); // 得到响应后删除
+                delDescriber(key); // 得到响应后删除
             }
             
             // 发送异步请求
@@ -64,7 +72,7 @@ namespace JsonRpc
             {
                 if (!conn) return false;
                 
-                RequestDescriber::s_ptr reqDesc = newDescriber(req, ReqType::REQ_ASYNC);
+                RequestDescriber::s_ptr reqDesc = newDescriber(conn, req, ReqType::REQ_ASYNC);
                 if (reqDesc == nullptr)
                 {
                     E_LOG("请求描述对象构造失败!");
@@ -94,7 +102,7 @@ namespace JsonRpc
             {
                 if (!conn) return false;
 
-                RequestDescriber::s_ptr reqDesc = newDescriber(req, ReqType::REQ_CALLBACK, cb);
+                RequestDescriber::s_ptr reqDesc = newDescriber(conn, req, ReqType::REQ_CALLBACK, cb);
                 if (reqDesc == nullptr)
                 {
                     E_LOG("请求描述对象构造失败!");
@@ -106,8 +114,22 @@ namespace JsonRpc
             }
 
         private:
-            RequestDescriber::s_ptr newDescriber(const BaseMessage::s_ptr& req, ReqType rtype, const RequestCallback& cb = RequestCallback())
+            using RequestKey = std::pair<BaseConnection*, uint64_t>;
+
+            struct RequestKeyHash
             {
+                size_t operator()(const RequestKey& key) const
+                {
+                    return std::hash<BaseConnection*>{}(key.first) ^ std::hash<uint64_t>{}(key.second);
+                }
+            };
+
+            // 分配关联 id，在发送之前登记，响应可能在 send 返回之前到达
+            RequestDescriber::s_ptr newDescriber(const BaseConnection::s_ptr& conn, const BaseMessage::s_ptr& req,
+                ReqType rtype, const RequestCallback& cb = RequestCallback())
+            {
+                req->setCid(_cid.fetch_add(1, std::memory_order_relaxed) + 1);
+
                 std::unique_lock<std::mutex> lock(_mtx);
                 
                 RequestDescriber::s_ptr reqDes = std::make_shared<RequestDescriber>();
@@ -118,38 +140,39 @@ namespace JsonRpc
                 if (rtype == ReqType::REQ_CALLBACK && cb)
                     reqDes->callback = cb;
 
-                _req_descs[req->rid()] = reqDes;
+                _req_descs[RequestKey(conn.get(), req->cid())] = reqDes;
                 return reqDes;
             }
 
-            RequestDescriber::s_ptr getDescriber(const std::string& rid)
+            RequestDescriber::s_ptr getDescriber(const RequestKey& key)
             {
                 std::unique_lock<std::mutex> lock(_mtx);
-                if (_req_descs.count(rid) == 0)
+                if (_req_descs.count(key) == 0)
                 {
-                    I_LOG("id = %s 的请求不存在", rid.c_str());
+                    I_LOG("id = %lu 的请求不存在", (unsigned long)key.second);
                     return std::make_shared<RequestDescriber>();
                 }
 
-                return _req_descs[rid];
+                return _req_descs[key];
             }
 
-            void delDescriber(const std::string& rid)
+            void delDescriber(const RequestKey& key)
             {
                 std::unique_lock<std::mutex> lock(_mtx);
-                if (_req_descs.count(rid) == 0)
+                if (_req_descs.count(key) == 0)
                 {
-                    I_LOG("id = %s 的请求不存在", rid.c_str());
+                    I_LOG("id = %lu 的请求不存在", (unsigned long)key.second);
                     return;
                 }
                 
-                _req_descs.erase(rid);
+                _req_descs.erase(key);
             }
 
         private:
+            std::atomic<uint64_t> _cid{0}; // 最近分配的关联 id
             std::mutex _mtx;
-            std::unordered_map<std::string, RequestDescriber::s_ptr> _req_descs;
-            // rid -> 请求描述 
+            std::unordered_map<RequestKey, RequestDescriber::s_ptr, RequestKeyHash> _req_descs;
+            // (连接, 关联 id) -> 请求描述 
         };
     }
 }
@@ -30,7 +30,6 @@ namespace JsonRpc
                 BaseMessage::s_ptr req_base = MessageFactory::create(MType::REQ_RPC);
                 RpcRequest::s_ptr req_msg = std::dynamic_pointer_cast<RpcRequest>(req_base);
                 
-                req_msg->setRid(UUID::uuid());
                 req_msg->setMtype(MType::REQ_RPC);
                 req_msg->setMethod(method);
                 req_msg->setParams(params);
@@ -73,7 +72,6 @@ namespace JsonRpc
                 // RpcRequest::s_ptr req_msg = MessageFactory::create(MType::REQ_RPC);
                 BaseMessage::s_ptr req_base = MessageFactory::create(MType::REQ_RPC);
                 RpcRequest::s_ptr req_msg = std::dynamic_pointer_cast<RpcRequest>(req_base);
-                req_msg->setRid(UUID::uuid());
                 req_msg->setMtype(MType::REQ_RPC);
                 req_msg->setMethod(method);
                 req_msg->setParams(params);
@@ -104,7 +102,6 @@ namespace JsonRpc
                 BaseMessage::s_ptr req_base = MessageFactory::create(MType::REQ_RPC);
                 RpcRequest::s_ptr req_msg = std::dynamic_pointer_cast<RpcRequest>(req_base);
 
-                req_msg->setRid(UUID::uuid());
                 req_msg->setMtype(MType::REQ_RPC);
                 req_msg->setMethod(method);
                 req_msg->setParams(params);
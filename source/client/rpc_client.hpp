@@ -54,11 +54,13 @@ namespace JsonRpc
             using s_ptr = std::shared_ptr<DiscoverClient>;
 
             // 构造函数传入注册中心的地址，与注册中心建立连接
-            DiscoverClient(const std::string& ip, int port, const Discover::OfflientCallback& offCb)
+            // compress: 服务发现响应中的主机列表较大时压缩，连接仍使用 JSON + v1
+            DiscoverClient(const std::string& ip, int port, const Discover::OfflientCallback& offCb,
+                const CompressPolicy& compress = CompressPolicy())
                 : _requestor(std::make_shared<Requestor>())
                 , _discover(std::make_shared<Discover>(_requestor, offCb))
                 , _dispatcher(std::make_shared<Dispatcher>())
-                , _client(ClientFactory::create(ip, port))
+                , _client(ClientFactory::create(ip, port, BodyCodec::CODEC_JSON, FrameVersion::FRAME_V1, compress))
             {
                 // 处理响应
                 auto rsp_cb = std::bind(&Requestor::onResponse, _requestor.get(),
@@ -102,8 +104,14 @@ namespace JsonRpc
             // enableDiscover决定rpc调用模式
             // true: 传入的为注册中心的地址，向服务中心发现后，再进行调用
             // false: 传入的是服务提供方的地址，直接向该地址进行 rpc 请求
-            RpcClient(bool enableDiscover, const std::string& ip, int port)
+            // codec、frame: 与服务提供方连接的正文编码和帧头版本，与注册中心的连接总是 JSON + v1
+            // compress: 与服务提供方、注册中心连接的压缩策略
+            RpcClient(bool enableDiscover, const std::string& ip, int port, BodyCodec codec = BodyCodec::CODEC_JSON,
+                FrameVersion frame = FrameVersion::FRAME_V1, const CompressPolicy& compress = CompressPolicy())
                 : _enableDiscover(enableDiscover)
+                , _codec(codec)
+                , _frame(frame)
+                , _compress(compress)
                 , _requestor(std::make_shared<Requestor>())
                 , _dispatcher(std::make_shared<Dispatcher>())
                 , _caller(std::make_shared<RpcCaller>(_requestor))
@@ -118,7 +126,7 @@ namespace JsonRpc
                 {
                     // 创建一个服务发现客户端，连接服务中心
                     auto offCb = std::bind(&RpcClient::delClient, this, std::placeholders::_1);
-                    _discover_client = std::make_shared<DiscoverClient>(ip, port, offCb); 
+                    _discover_client = std::make_shared<DiscoverClient>(ip, port, offCb, _compress);
                 }
                 else // 未启用服务发现
                 {
@@ -126,7 +134,7 @@ namespace JsonRpc
                     auto message_cb = std::bind(&Dispatcher::onMessage, _dispatcher.get(),
                                             std::placeholders::_1, std::placeholders::_2);
 
-                    _rpc_client = ClientFactory::create(ip, port);
+                    _rpc_client = ClientFactory::create(ip, port, _codec, _frame, _compress);
                     _rpc_client->setMessageCallback(message_cb);
                     _rpc_client->connect();
                 }
@@ -174,7 +182,7 @@ namespace JsonRpc
                 auto message_cb = std::bind(&Dispatcher::onMessage, _dispatcher.get(),
                                         std::placeholders::_1, std::placeholders::_2);
 
-                auto client = ClientFactory::create(host.first, host.second);
+                auto client = ClientFactory::create(host.first, host.second, _codec, _frame, _compress);
                 client->setMessageCallback(message_cb);
                 client->connect();
                 // bug记录: 此处额外加锁，造成死锁，在putClient内已经加锁了
@@ -241,6 +249,9 @@ namespace JsonRpc
 
         private:
             bool _enableDiscover;
+            BodyCodec _codec;
+            FrameVersion _frame;
+            CompressPolicy _compress;
             Requestor::s_ptr _requestor;
             DiscoverClient::s_ptr _discover_client; // 进行服务发现
             RpcCaller::s_ptr _caller; // 进行rpc调用
@@ -254,12 +265,13 @@ namespace JsonRpc
         class TopicClient
         {
         public:
-            // 中转服务器的地址
-            TopicClient(const std::string& ip, int port)
+            // 中转服务器的地址，codec、frame、compress 为连接的正文编码、帧头版本和压缩策略
+            TopicClient(const std::string& ip, int port, BodyCodec codec = BodyCodec::CODEC_JSON,
+                FrameVersion frame = FrameVersion::FRAME_V1, const CompressPolicy& compress = CompressPolicy())
                 : _requestor(std::make_shared<Requestor>())
                 , _dispatcher(std::make_shared<Dispatcher>())
                 , _topic_manager(std::make_shared<TopicManager>(_requestor))
-                , _rpc_client(ClientFactory::create(ip, port))
+                , _rpc_client(ClientFactory::create(ip, port, codec, frame, compress))
             {
                 // 处理主题请求后的响应
                 auto rsp_cb = std::bind(&Requestor::onResponse, _requestor.get(),
@@ -273,6 +285,12 @@ namespace JsonRpc
 
                 _dispatcher->registerHandler<TopicRequest>(MType::REQ_TOPIC, top_msg_cb);
 
+                // 服务端开启推送合并时，多条推送打包在一帧中
+                auto bundle_cb = std::bind(&TopicManager::onBundle, _topic_manager.get(),
+                                        std::placeholders::_1, std::placeholders::_2);
+
+                _dispatcher->registerHandler<BundleMessage>(MType::REQ_TOPIC_BUNDLE, bundle_cb);
+
                 // 将dispatcher注册到客户端消息处理
                 auto message_cb = std::bind(&Dispatcher::onMessage, _dispatcher.get(),
                                         std::placeholders::_1, std::placeholders::_2);
@@ -294,9 +312,16 @@ namespace JsonRpc
             }
 
             // 主题订阅
-            bool subscribeTopic(const std::string& key, const TopicManager::SubscribeCallback& cb)
+            bool subscribeTopic(const std::string& key, const TopicManager::SubscribeCallback& cb,
+                const SubscribeOptions& options = SubscribeOptions())
             {
-                return _topic_manager->subscribeTopic(_rpc_client->getConnection(), key, cb);
+                return _topic_manager->subscribeTopic(_rpc_client->getConnection(), key, cb, options);
+            }
+
+            // 收到的指定主题最新消息的序号
+            uint64_t lastSeq(const std::string& key)
+            {
+                return _topic_manager->lastSeq(key);
             }
 
             // 取消订阅
@@ -305,12 +330,65 @@ namespace JsonRpc
                 return _topic_manager->cancelTopic(_rpc_client->getConnection(), key);
             } 
 
+            // 批量订阅，key 可以是通配符模式
+            bool subscribeTopics(const std::vector<std::string>& keys, const TopicManager::SubscribeCallback& cb,
+                const SubscribeOptions& options = SubscribeOptions())
+            {
+                return _topic_manager->subscribeTopics(_rpc_client->getConnection(), keys, cb, options);
+            }
+
+            // 批量取消订阅
+            bool cancelTopics(const std::vector<std::string>& keys)
+            {
+                return _topic_manager->cancelTopics(_rpc_client->getConnection(), keys);
+            }
+
             // 主题消息发布
             bool publishTopic(const std::string& key, const std::string& msg)
             {
                 return _topic_manager->publishTopic(_rpc_client->getConnection(), key, msg);
             }
 
+            // 发布消息，服务端不响应
+            bool publishTopicNoAck(const std::string& key, const std::string& msg)
+            {
+                return _topic_manager->publishTopicNoAck(_rpc_client->getConnection(), key, msg);
+            }
+
+            // 异步发布消息，可以同时有多个发布在途
+            std::future<bool> publishTopicAsync(const std::string& key, const std::string& msg)
+            {
+                return _topic_manager->publishTopicAsync(_rpc_client->getConnection(), key, msg);
+            }
+
+            // 批量发布消息，打包在一个请求中
+            bool publishBatch(const TopicManager::Batch& msgs)
+            {
+                return _topic_manager->publishBatch(_rpc_client->getConnection(), msgs);
+            }
+
+            bool publishBatchNoAck(const TopicManager::Batch& msgs)
+            {
+                return _topic_manager->publishBatchNoAck(_rpc_client->getConnection(), msgs);
+            }
+
+            std::future<bool> publishBatchAsync(const TopicManager::Batch& msgs)
+            {
+                return _topic_manager->publishBatchAsync(_rpc_client->getConnection(), msgs);
+            }
+
+            // 非 INLINE 订阅回调使用的共享线程池大小，需要在订阅之前设置
+            void setCallbackThreadNum(int thread_num)
+            {
+                _topic_manager->setSharedThreadNum(thread_num);
+            }
+
+            // 各订阅回调的排队深度
+            std::vector<TopicManager::CallbackStats> callbackStats()
+            {
+                return _topic_manager->callbackStats();
+            }
+
             void shutDown()
             {
                 _rpc_client->shutdown();
@@ -22,7 +22,6 @@ namespace JsonRpc
             bool registeryMethod(const BaseConnection::s_ptr& conn, const std::string& method, const Address& addr)
             {
                 auto msg_req = MessageFactory::create<ServiceRequest>();
-                msg_req->setRid(UUID::uuid());
                 msg_req->setMtype(MType::REQ_SERVICE);
                 msg_req->setMethod(method);
                 msg_req->setServiceHost(addr);
@@ -134,7 +133,6 @@ namespace JsonRpc
 
                 // 向服务端请求
                 ServiceRequest::s_ptr msg_req = MessageFactory::create<ServiceRequest>();
-                msg_req->setRid(UUID::uuid());
                 msg_req->setMethod(method);
                 msg_req->setMtype(MType::REQ_SERVICE);
                 msg_req->setServiceOpType(ServiceOpType::SERVICE_DISCOVER);
@@ -2,22 +2,90 @@
 
 #include "../common/net.hpp"
 #include "../common/message.hpp"
+#include "../common/topic_trie.hpp"
+#include "../common/executor.hpp"
 #include "requestor.hpp" 
 
+#include <thread>
+
 namespace JsonRpc
 {
     namespace Client
     {
-        class TopicManager
+        // 订阅回调的执行方式
+        enum class CallbackPolicy
+        {
+            INLINE = 0,      // 在连接的 I/O 线程中直接执行(默认)，慢回调会阻塞该连接上所有后续消息与响应
+            SHARED_POOL,     // 投递到 TopicManager 的共享线程池，同一主题的消息可能并发、乱序执行
+            SERIAL_PER_TOPIC // 每个订阅一个串行队列，运行在共享线程池上: 同一主题按顺序执行，不同主题并行
+        };
+
+        // 订阅选项
+        struct SubscribeOptions
+        {
+            uint64_t replay_from = 0; // 从该序号开始回放服务端保留的消息，0 表示不按序号回放
+            size_t replay_last = 0;   // 回放最近 N 条保留的消息，0 表示不回放
+            Json::Value filter;       // 服务端过滤条件，由 TopicFilter::equal/in/range 构造，null 表示不过滤
+            std::string group;        // 共享订阅的组名，同组的订阅者分担消息，每条消息只推送给其中一个；为空表示普通订阅
+            GroupBalance balance = GroupBalance::GROUP_ROUND_ROBIN; // 组内的分配方式，由第一个加入的成员决定
+            bool reliable = false;    // 可靠订阅(至少一次): 服务端保留未确认的消息，超时或续订后重发，只支持精确订阅
+            std::string consumer;     // 可靠订阅的消费者标识，重连后以同一标识订阅可以收到断线前未确认的消息；为空时使用 TopicManager 生成的标识
+            size_t ack_batch = 64;    // 可靠订阅每收到多少条消息确认一次
+            double ack_delay = 0.01;  // 不足 ack_batch 条时最多延迟多久(秒)确认，需要小于服务端的重发超时
+            CallbackPolicy exec = CallbackPolicy::INLINE; // 回调的执行方式，可靠订阅的 SHARED_POOL 按 SERIAL_PER_TOPIC 执行以保证按序确认
+        };
+
+        // 可靠订阅的消息在回调返回后才确认，回调期间断线的消息会被重发
+        // 确认是累计的: 只发送收到的最大序号，一次确认覆盖一批消息
+        // 同一连接上重复收到(序号不大于已收到的最大序号)的消息不再调用回调，只重新确认
+        class TopicManager : public std::enable_shared_from_this<TopicManager>
         {
         public:
             using SubscribeCallback = std::function<void(const std::string& key, const std::string& msg)>;
+            using Batch = std::vector<std::pair<std::string, std::string>>; // 批量发布: 主题名称 -> 消息
             using s_ptr = std::shared_ptr<TopicManager>;
 
+            // 订阅回调的排队统计
+            struct CallbackStats
+            {
+                std::string key;       // 主题名称或通配符模式
+                CallbackPolicy policy;
+                size_t queued;         // 等待执行的回调数，SHARED_POOL 为共享线程池的队列深度
+            };
+
             TopicManager(Requestor::s_ptr requestor)
                 : _requestor(requestor)
+                , _consumer(UUID::uuid())
+                , _shared_thread_num(std::thread::hardware_concurrency())
             {}
 
+            // 共享线程池大小，需要在第一次以非 INLINE 方式订阅之前设置，默认为 CPU 核数
+            void setSharedThreadNum(int thread_num)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _shared_thread_num = thread_num;
+            }
+
+            // 替换共享执行器，需要在第一次以非 INLINE 方式订阅之前设置
+            void setSharedExecutor(const BaseExecutor::s_ptr& executor)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _shared_executor = executor;
+            }
+
+            // 各订阅回调的排队深度
+            std::vector<CallbackStats> callbackStats()
+            {
+                std::vector<CallbackStats> stats;
+                std::unique_lock<std::mutex> lock(_mtx);
+                for (auto& it : _topic_cbs)
+                {
+                    auto& sub = it.second;
+                    stats.push_back({ it.first, sub.policy, sub.executor ? sub.executor->queueSize() : 0 });
+                }
+                return stats;
+            }
+
             // 主题创建
             bool createTopic(const BaseConnection::s_ptr& conn, const std::string& key)
             {
@@ -30,12 +98,17 @@ namespace JsonRpc
                 return commonRequest(conn, key, TopicOpType::TOPIC_REMOVE);
             }
 
-            // 主题订阅
-            bool subscribeTopic(const BaseConnection::s_ptr& conn, const std::string& key, const SubscribeCallback& cb)
+            // 主题订阅，key 可以是通配符模式(例如 market.*.600000、market.#)，通配符订阅不回放保留的消息
+            // 断线重连后可以用 lastSeq(key) + 1 作为 replay_from 续订，补齐断线期间的消息
+            bool subscribeTopic(const BaseConnection::s_ptr& conn, const std::string& key, const SubscribeCallback& cb,
+                const SubscribeOptions& options = SubscribeOptions())
             {
-                addSubscribe(key, cb); // 先设置回调函数，防止响应报文携带了要处理的数据
+                addSubscribe(key, cb, options); // 先设置回调函数，防止响应报文携带了要处理的数据
+
+                auto msg_req = makeRequest(key, TopicOpType::TOPIC_SUBSCRIBE);
+                setOptions(msg_req, options);
 
-                bool ret = commonRequest(conn, key, TopicOpType::TOPIC_SUBSCRIBE);
+                bool ret = sendRequest(conn, msg_req);
                 if (!ret)
                     delSubscribe(key);
 
@@ -49,12 +122,70 @@ namespace JsonRpc
                 return commonRequest(conn, key, TopicOpType::TOPIC_CANCEL);
             } 
 
-            // 主题消息发布
+            // 批量订阅，所有主题(或通配符模式)使用同一个回调函数，只发送一个请求
+            // 任意主题订阅失败时返回 false，并撤销这一批的全部订阅(删除回调，取消服务端已生效的订阅)
+            bool subscribeTopics(const BaseConnection::s_ptr& conn, const std::vector<std::string>& keys, 
+                const SubscribeCallback& cb, const SubscribeOptions& options = SubscribeOptions())
+            {
+                for (auto& key : keys)
+                    addSubscribe(key, cb, options);
+
+                auto msg_req = makeRequest("", TopicOpType::TOPIC_SUBSCRIBE_BATCH);
+                msg_req->setTopicKeys(keys);
+                setOptions(msg_req, options);
+
+                bool ret = sendRequest(conn, msg_req);
+                if (!ret)
+                    cancelTopics(conn, keys);
+
+                return ret;
+            }
+
+            // 批量取消订阅
+            bool cancelTopics(const BaseConnection::s_ptr& conn, const std::vector<std::string>& keys)
+            {
+                for (auto& key : keys)
+                    delSubscribe(key);
+
+                auto msg_req = makeRequest("", TopicOpType::TOPIC_CANCEL_BATCH);
+                msg_req->setTopicKeys(keys);
+                return sendRequest(conn, msg_req);
+            }
+
+            // 主题消息发布，等待服务端确认
             bool publishTopic(const BaseConnection::s_ptr& conn, const std::string& key, const std::string& msg)
             {
                 return commonRequest(conn, key, TopicOpType::TOPIC_PUBLISH, msg);
             }
 
+            // 发布后立即返回，服务端不响应，发布失败(例如主题不存在)只在服务端记录日志
+            bool publishTopicNoAck(const BaseConnection::s_ptr& conn, const std::string& key, const std::string& msg)
+            {
+                return sendNoAck(conn, makePublish(key, msg));
+            }
+
+            // 异步发布，不等待响应，可以同时有多个发布在途，通过 future 获取发布结果
+            std::future<bool> publishTopicAsync(const BaseConnection::s_ptr& conn, const std::string& key, const std::string& msg)
+            {
+                return sendAsync(conn, makePublish(key, msg));
+            }
+
+            // 批量发布，多条消息(可以属于不同主题)打包在一个请求中，服务端只响应一次
+            bool publishBatch(const BaseConnection::s_ptr& conn, const Batch& msgs)
+            {
+                return sendRequest(conn, makeBatch(msgs));
+            }
+
+            bool publishBatchNoAck(const BaseConnection::s_ptr& conn, const Batch& msgs)
+            {
+                return sendNoAck(conn, makeBatch(msgs));
+            }
+
+            std::future<bool> publishBatchAsync(const BaseConnection::s_ptr& conn, const Batch& msgs)
+            {
+                return sendAsync(conn, makeBatch(msgs));
+            }
+
             // 收到推送消息处理
             void onPublish(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
             {
@@ -65,29 +196,254 @@ namespace JsonRpc
                     return;
                 }
 
-                auto cb = getSubscribe(msg->topicKey());
-                if (!cb)
+                // 精确订阅与匹配的通配符订阅的回调都会被调用，各自按订阅的执行方式执行
+                std::string key = msg->topicKey();
+                uint64_t seq = msg->topicSeq();
+                bool duplicate = false;
+                std::vector<Subscription> subs = getSubscribe(key, seq, duplicate);
+                if (subs.empty())
                 {
-                    E_LOG("无法处理主题 %s!", msg->topicKey().c_str());
+                    E_LOG("无法处理主题 %s!", key.c_str());
                     return;
                 }
 
-                return cb(msg->topicKey(), msg->topicMsg());
+                if (duplicate)
+                    return onReliableReceived(conn, key, seq);
+
+                // 可靠订阅(只能是精确订阅)在回调执行完后确认
+                // INLINE 的订阅直接调用回调，只有提交到执行器时才拷贝回调、主题与正文
+                std::string body = msg->topicMsg();
+                for (auto& sub : subs)
+                {
+                    bool ack = sub.reliable;
+                    if (!sub.executor)
+                    {
+                        sub.cb(key, body);
+                        if (ack)
+                            onReliableReceived(conn, key, seq);
+                        continue;
+                    }
+
+                    std::weak_ptr<TopicManager> weak_self = shared_from_this();
+                    SubscribeCallback cb = sub.cb;
+                    sub.executor->submit([weak_self, conn, cb, key, body, seq, ack]() {
+                        cb(key, body);
+                        auto self = weak_self.lock();
+                        if (ack && self)
+                            self->onReliableReceived(conn, key, seq);
+                    });
+                }
+            }
+
+            // 收到合并推送，按顺序逐条处理其中的推送消息
+            void onBundle(const BaseConnection::s_ptr& conn, const BundleMessage::s_ptr& msg)
+            {
+                std::vector<BaseMessage::s_ptr> msgs;
+                if (!conn->protocol()->unbundle(msg, msgs))
+                    return;
+
+                for (auto& m : msgs)
+                {
+                    auto pub = std::dynamic_pointer_cast<TopicRequest>(m);
+                    if (!pub)
+                    {
+                        E_LOG("合并推送中包含非主题消息!");
+                        continue;
+                    }
+                    onPublish(conn, pub);
+                }
+            }
+
+            // 收到的指定主题最新消息的序号，主题未开启保留或尚未收到消息时为 0
+            uint64_t lastSeq(const std::string& key)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                auto it = _last_seqs.find(key);
+                return it != _last_seqs.end() ? it->second : 0;
             }
             
         private:
+            // 一个订阅的回调与执行器
+            struct Subscription
+            {
+                SubscribeCallback cb;
+                CallbackPolicy policy = CallbackPolicy::INLINE;
+                BaseExecutor::s_ptr executor; // INLINE 为空
+                bool reliable = false;
+            };
+
+            // 可靠订阅的确认状态
+            struct AckState
+            {
+                std::string consumer;
+                size_t batch;
+                double delay;
+                uint64_t received = 0; // 收到的最大序号
+                uint64_t acked = 0;    // 已确认的序号
+                bool dirty = false;    // 有尚未发送的确认
+                bool timer = false;    // 延迟确认的定时器已启动
+            };
+
+            void setOptions(const TopicRequest::s_ptr& msg_req, const SubscribeOptions& options)
+            {
+                if (options.replay_from > 0)
+                    msg_req->setReplayFrom(options.replay_from);
+                if (options.replay_last > 0)
+                    msg_req->setReplayLast(options.replay_last);
+                if (!options.filter.isNull())
+                    msg_req->setFilter(options.filter);
+                if (!options.group.empty())
+                {
+                    msg_req->setGroup(options.group);
+                    msg_req->setGroupBalance(options.balance);
+                }
+                if (options.reliable)
+                {
+                    msg_req->setReliable(true);
+                    msg_req->setConsumer(options.consumer.empty() ? _consumer : options.consumer);
+                }
+            }
+
+            // 可靠订阅的消息处理完成: 累计到 ack_batch 条立即确认，否则启动延迟确认的定时器
+            void onReliableReceived(const BaseConnection::s_ptr& conn, const std::string& key, uint64_t seq)
+            {
+                bool now = false, later = false;
+                double delay = 0;
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    auto it = _acks.find(key);
+                    if (seq == 0 || it == _acks.end())
+                        return;
+
+                    AckState& state = it->second;
+                    state.received = std::max(state.received, seq);
+                    state.dirty = true;
+                    if (state.received - state.acked >= state.batch)
+                        now = true;
+                    else if (!state.timer)
+                        later = state.timer = true;
+                    delay = state.delay;
+                }
+
+                if (now)
+                    return sendAck(conn, key);
+
+                if (later)
+                {
+                    std::weak_ptr<TopicManager> weak_self = shared_from_this();
+                    conn->runAfter(delay, [weak_self, conn, key]() {
+                        auto self = weak_self.lock();
+                        if (self)
+                            self->sendAck(conn, key, true);
+                    });
+                }
+            }
+
+            // 发送累计确认，由定时器触发时同时清除定时器标记
+            void sendAck(const BaseConnection::s_ptr& conn, const std::string& key, bool timer = false)
+            {
+                auto msg_req = makeRequest(key, TopicOpType::TOPIC_ACK);
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    auto it = _acks.find(key);
+                    if (it == _acks.end())
+                        return;
+
+                    AckState& state = it->second;
+                    if (timer)
+                        state.timer = false;
+                    if (!state.dirty)
+                        return;
+
+                    state.dirty = false;
+                    state.acked = state.received;
+                    msg_req->setConsumer(state.consumer);
+                    msg_req->setAckSeq(state.acked);
+                }
+
+                msg_req->setNoAck(true);
+                conn->send(msg_req);
+            }
+
+            // 调用方持有 _mtx
+            BaseExecutor::s_ptr sharedExecutor()
+            {
+                if (!_shared_executor)
+                    _shared_executor = ExecutorFactory::create<ThreadPoolExecutor>("TopicCallback", _shared_thread_num);
+                return _shared_executor;
+            }
+
             bool commonRequest(const BaseConnection::s_ptr& conn, const std::string& key, TopicOpType op, const std::string& msg = "")
             {
-                I_LOG("发送 %d 类型主题请求", (int)op);
-                // 构造请求对象
+                auto msg_req = makeRequest(key, op);
+                if (op == TopicOpType::TOPIC_PUBLISH)
+                    msg_req->setTopicMsg(msg);
+
+                return sendRequest(conn, msg_req);
+            }
+
+            TopicRequest::s_ptr makePublish(const std::string& key, const std::string& msg)
+            {
+                auto msg_req = makeRequest(key, TopicOpType::TOPIC_PUBLISH);
+                msg_req->setTopicMsg(msg);
+                return msg_req;
+            }
+
+            TopicRequest::s_ptr makeBatch(const Batch& msgs)
+            {
+                auto msg_req = makeRequest("", TopicOpType::TOPIC_PUBLISH_BATCH);
+                msg_req->setTopicBatch(msgs);
+                return msg_req;
+            }
+
+            // 只发送，不注册请求描述，服务端不会响应
+            bool sendNoAck(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg_req)
+            {
+                if (!conn)
+                {
+                    E_LOG("%s 主题发布失败，连接不存在!", msg_req->topicKey().c_str());
+                    return false;
+                }
+
+                msg_req->setNoAck(true);
+                conn->send(msg_req);
+                return true;
+            }
+
+            // 响应到达时在 I/O 线程中设置发布结果
+            std::future<bool> sendAsync(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg_req)
+            {
+                auto result = std::make_shared<std::promise<bool>>();
+                std::future<bool> future = result->get_future();
+
+                std::string key = msg_req->topicKey();
+                Requestor::RequestCallback cb = [result, key](BaseMessage::s_ptr& rsp) {
+                    result->set_value(checkResponse(key, rsp));
+                };
+
+                if (!_requestor->send(conn, msg_req, cb))
+                {
+                    E_LOG("%s 主题操作失败!", key.c_str());
+                    result->set_value(false);
+                }
+                return future;
+            }
+
+            // 构造请求对象
+            TopicRequest::s_ptr makeRequest(const std::string& key, TopicOpType op)
+            {
                 auto msg_req = MessageFactory::create<TopicRequest>();
                 msg_req->setMtype(MType::REQ_TOPIC);
-                msg_req->setRid(UUID::uuid());
                 msg_req->setTopicKey(key);
                 msg_req->setTopicOpType(op);
-                if (op == TopicOpType::TOPIC_PUBLISH)
-                    msg_req->setTopicMsg(msg);
-                
+                return msg_req;
+            }
+
+            bool sendRequest(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg_req)
+            {
+                const std::string& key = msg_req->topicKey();
+                I_LOG("发送 %d 类型主题请求", (int)msg_req->topicOpType());
+
                 // 发送请求
                 BaseMessage::s_ptr rsp;
                 if (!_requestor->send(conn, msg_req, rsp))
@@ -96,7 +452,12 @@ namespace JsonRpc
                     return false;
                 }
 
-                // 等待响应
+                return checkResponse(key, rsp);
+            }
+
+            // 检查响应码
+            static bool checkResponse(const std::string& key, const BaseMessage::s_ptr& rsp)
+            {
                 auto top_rsp = std::dynamic_pointer_cast<TopicResponse>(rsp);
                 if (!top_rsp)       
                 {
@@ -113,28 +474,89 @@ namespace JsonRpc
                 return true;
             }
 
-            void addSubscribe(const std::string& key, const SubscribeCallback& cb)
+            void addSubscribe(const std::string& key, const SubscribeCallback& cb, 
+                const SubscribeOptions& options = SubscribeOptions())
             {
                 std::unique_lock<std::mutex> lock(_mtx);
-                _topic_cbs[key] = cb;
+                CallbackPolicy policy = options.exec;
+                if (options.reliable && policy == CallbackPolicy::SHARED_POOL)
+                    policy = CallbackPolicy::SERIAL_PER_TOPIC;
+
+                auto it = _topic_cbs.find(key);
+                bool keep = it != _topic_cbs.end() && it->second.policy == policy; // 重复订阅时沿用原来的串行队列，保持顺序
+                Subscription& sub = _topic_cbs[key];
+                sub.cb = cb;
+                sub.reliable = options.reliable;
+                if (!keep)
+                {
+                    sub.policy = policy;
+                    if (policy == CallbackPolicy::SHARED_POOL)
+                        sub.executor = sharedExecutor();
+                    else if (policy == CallbackPolicy::SERIAL_PER_TOPIC)
+                        sub.executor = ExecutorFactory::create<SerialExecutor>(sharedExecutor());
+                    else
+                        sub.executor.reset();
+                }
+
+                if (TopicTrie<std::string>::isPattern(key))
+                    _patterns.insert(key, key);
+
+                if (options.reliable && _acks.count(key) == 0)
+                {
+                    AckState& state = _acks[key];
+                    state.consumer = options.consumer.empty() ? _consumer : options.consumer;
+                    state.batch = std::max<size_t>(options.ack_batch, 1);
+                    state.delay = options.ack_delay;
+                }
             }
 
             void delSubscribe(const std::string& key)
             {
                 std::unique_lock<std::mutex> lock(_mtx);
                 _topic_cbs.erase(key);
+                _acks.erase(key);
+                if (TopicTrie<std::string>::isPattern(key))
+                    _patterns.remove(key, key);
             }
 
-            const SubscribeCallback getSubscribe(const std::string& key)
+            // 获取主题的回调函数(精确订阅与匹配的通配符订阅)，同时记录收到的消息序号
+            // duplicate: 可靠订阅重发的、已经处理过的消息
+            std::vector<Subscription> getSubscribe(const std::string& key, uint64_t seq, bool& duplicate)
             {
+                std::vector<Subscription> cbs;
                 std::unique_lock<std::mutex> lock(_mtx);
-                return _topic_cbs.count(key) ? _topic_cbs[key] : SubscribeCallback();
+                auto it = _topic_cbs.find(key);
+                if (it != _topic_cbs.end())
+                    cbs.push_back(it->second);
+
+                if (_patterns.size() > 0)
+                {
+                    std::vector<std::string> patterns;
+                    _patterns.match(key, patterns);
+                    std::sort(patterns.begin(), patterns.end());
+                    patterns.erase(std::unique(patterns.begin(), patterns.end()), patterns.end());
+                    for (auto& pattern : patterns)
+                        cbs.push_back(_topic_cbs[pattern]);
+                }
+
+                auto ait = _acks.find(key);
+                duplicate = seq > 0 && ait != _acks.end() && seq <= ait->second.received;
+
+                if (seq > 0 && !cbs.empty() && !duplicate)
+                    _last_seqs[key] = seq;
+                return cbs;
             }
 
         private:
             std::mutex _mtx;
-            std::unordered_map<std::string, SubscribeCallback> _topic_cbs;
+            std::unordered_map<std::string, Subscription> _topic_cbs; // 主题名称或通配符模式 -> 回调
+            TopicTrie<std::string> _patterns; // 已订阅的通配符模式
+            std::unordered_map<std::string, uint64_t> _last_seqs; // 每个主题收到的最新消息序号
+            std::unordered_map<std::string, AckState> _acks; // 可靠订阅的主题 -> 确认状态
             Requestor::s_ptr _requestor;
+            std::string _consumer; // 未指定消费者标识时使用
+            int _shared_thread_num;
+            BaseExecutor::s_ptr _shared_executor; // 第一次以非 INLINE 方式订阅时创建
         };
     }
 }
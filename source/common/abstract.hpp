@@ -3,10 +3,47 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <vector>
+#include <cstdint>
 #include "fields.hpp"
 
 namespace JsonRpc
 {
+    class KeyDictionary;
+
+    // 缓冲区基类
+    class BaseBuffer 
+    {
+    public:
+        using s_ptr = std::shared_ptr<BaseBuffer>;
+
+        // 缓冲区可读的数据范围
+        virtual size_t readableSize() = 0; 
+        // 可读数据的起始位置，在下一次 retrieve 之前有效
+        virtual const char* peek() = 0;
+        // 删除前 len byte 数据
+        virtual void retrieve(size_t len) = 0;
+        // 尝试取出 4 byte, 但是不删除
+        virtual int32_t peekInt32() = 0; 
+        // 删除前 4 byte数据
+        virtual void retrieveInt32() = 0;
+        // 取出并删除前 4 byte数据
+        virtual int32_t readInt32() = 0;
+        // 取出指定长度的数据
+        virtual std::string retrieveAsString(size_t len) = 0;
+
+        // 以下用于编码: 直接把帧写入缓冲区，不生成临时 string
+        // 追加数据
+        virtual void append(const char* data, size_t len) = 0;
+        // 保证至少 len byte 可写，返回写入位置，写完后用 commitWrite 提交实际写入的长度
+        virtual char* prepareWrite(size_t len) = 0;
+        virtual void commitWrite(size_t len) = 0;
+        // 在可读数据之前写入 4 byte(转为网络字节序)，正文写完后回填帧长度
+        virtual void prependInt32(int32_t x) = 0;
+        // 在可读数据之前写入 len byte，用于回填变长的帧长度
+        virtual void prepend(const char* data, size_t len) = 0;
+    };
+
     // 消息基类
     // {
     //      id: xxx,
@@ -20,7 +57,12 @@ namespace JsonRpc
         virtual ~BaseMessage() = default;
 
         virtual std::string rid() { return _rid; };
-        virtual void setRid(std::string rid) { _rid = rid; }
+        virtual void setRid(std::string rid) { _rid = std::move(rid); }
+
+        // 整数关联 id，0 表示没有，由请求方的 Requestor 从单调递增的计数器分配(重连后不复位)，响应方原样带回
+        // 与 rid 二选一: 请求方按 (连接, cid) 匹配响应，rid 保留给旧版本对端的字符串 id
+        virtual uint64_t cid() { return _cid; }
+        virtual void setCid(uint64_t cid) { _cid = cid; }
 
         virtual MType mtype() { return _mtype; };
         virtual void setMtype(MType mtype) { _mtype = mtype; }
@@ -29,31 +71,46 @@ namespace JsonRpc
         virtual std::string serialize() = 0;
         // 反序列化
         virtual bool unSerialize(const std::string& msg) = 0;
+        // 按连接协商的正文编码序列化/反序列化，默认只支持 JSON
+        virtual std::string serialize(BodyCodec codec) { return serialize(); }
+        // 把正文直接编码到缓冲区末尾
+        // keys: 连接上的键字典，只有二进制正文使用，为空时正文不依赖连接状态
+        virtual void serializeTo(BodyCodec codec, BaseBuffer& out, KeyDictionary* keys = nullptr)
+        {
+            std::string body = serialize(codec);
+            out.append(body.data(), body.size());
+        }
+        virtual bool unSerialize(const std::string& msg, BodyCodec codec) { return unSerialize(msg); }
+        // 直接从接收缓冲区中的一段数据反序列化，不先拷贝为 string
+        virtual bool unSerialize(const char* begin, const char* end, BodyCodec codec, KeyDictionary* keys = nullptr)
+        {
+            return unSerialize(std::string(begin, end), codec);
+        }
         // 检查 BaseMessage 字段
         virtual bool check() = 0;
 
+        // 收到消息时的原始正文，由协议层在解析成功后设置
+        // 转发未修改的消息时直接复用，避免再次序列化，只有目标连接的正文编码相同时才能复用
+        // 只有会被转发的消息才需要保留，其余消息解析后不再拷贝正文
+        virtual bool keepRawBody() { return false; }
+        virtual const std::string& rawBody() { return _raw_body; }
+        virtual BodyCodec rawCodec() { return _raw_codec; }
+        virtual void setRawBody(std::string body, BodyCodec codec = BodyCodec::CODEC_JSON)
+        {
+            _raw_body = std::move(body);
+            _raw_codec = codec;
+        }
+
     private:
         MType _mtype; // 消息类型
         std::string _rid; // 消息uuid
+        uint64_t _cid = 0; // 关联 id
+        std::string _raw_body; // 原始正文
+        BodyCodec _raw_codec = BodyCodec::CODEC_JSON; // 原始正文的编码
     };
 
-    // 缓冲区基类
-    class BaseBuffer 
-    {
-    public:
-        using s_ptr = std::shared_ptr<BaseBuffer>;
-
-        // 缓冲区可读的数据范围
-        virtual size_t readableSize() = 0; 
-        // 尝试取出 4 byte, 但是不删除
-        virtual int32_t peekInt32() = 0; 
-        // 删除前 4 byte数据
-        virtual void retrieveInt32() = 0;
-        // 取出并删除前 4 byte数据
-        virtual int32_t readInt32() = 0;
-        // 取出指定长度的数据
-        virtual std::string retrieveAsString(size_t len) = 0;
-    };
+    // 编码完成的帧，引用计数共享，多个连接发送同一份数据
+    using SharedFrame = std::shared_ptr<const std::string>;
 
     // 协议基类
     class BaseProtocol
@@ -61,12 +118,55 @@ namespace JsonRpc
     public:
         using s_ptr = std::shared_ptr<BaseProtocol>;
 
+        // 消息正文的编码
+        virtual BodyCodec codec() = 0;
+
         // 缓冲区是否可转化为消息
         virtual bool canProcessed(const BaseBuffer::s_ptr& buf) = 0;
         // 将缓冲区转化为消息
-        virtual bool onMessage(const BaseBuffer::s_ptr& buf, BaseMessage::s_ptr& msg) = 0;
+        // keys: 连接接收方向的键字典，帧引用了键字典时必须提供(见 CODEC_BINARY_DICT)
+        virtual bool onMessage(const BaseBuffer::s_ptr& buf, BaseMessage::s_ptr& msg, KeyDictionary* keys = nullptr) = 0;
         // 序列化
         virtual std::string serialize(const BaseMessage::s_ptr& msg) = 0;
+        // 把完整的帧直接编码到空的缓冲区中，帧长度在正文写完后回填
+        // keys: 连接发送方向的键字典，调用方保证按帧写入连接的顺序编码；为空时生成不依赖连接状态的帧
+        virtual void serializeTo(const BaseMessage::s_ptr& msg, BaseBuffer& out, KeyDictionary* keys = nullptr) = 0;
+        // 编码为可共享的帧，用于一条消息发送给多个连接
+        // forward: 消息带有原始正文时直接复用，只重新生成帧头(调用方保证收到后未修改正文)
+        virtual SharedFrame sharedFrame(const BaseMessage::s_ptr& msg, bool forward) = 0;
+        // 把多个已编码的帧打包成一个合并推送帧，接收方一次读取、一次解析帧头
+        virtual SharedFrame bundle(const std::vector<SharedFrame>& frames) = 0;
+        // 拆开合并推送帧，依次取出其中的消息
+        virtual bool unbundle(const BaseMessage::s_ptr& bundle, std::vector<BaseMessage::s_ptr>& msgs) = 0;
+
+    protected:
+        // v1 帧头、protobuf 信封中的 id 是字符串: 关联 id 以十进制传输，旧版本的对端把它当作 rid 原样带回
+        static std::string textId(const BaseMessage::s_ptr& msg)
+        {
+            if (msg->cid() != 0 && msg->rid().empty())
+                return std::to_string(msg->cid());
+            return msg->rid();
+        }
+
+        // 不以 0 开头的十进制数字且不溢出时还原为关联 id，其余(uuid 等)作为 rid
+        static void setTextId(const BaseMessage::s_ptr& msg, const char* id, size_t len)
+        {
+            uint64_t cid = 0;
+            bool numeric = len > 0 && len <= 20 && id[0] != '0';
+            for (size_t i = 0; numeric && i < len; i++)
+            {
+                uint64_t digit = id[i] - '0';
+                if (id[i] < '0' || id[i] > '9' || cid > (UINT64_MAX - digit) / 10)
+                    numeric = false;
+                else
+                    cid = cid * 10 + digit;
+            }
+
+            if (numeric)
+                msg->setCid(cid);
+            else
+                msg->setRid(std::string(id, len));
+        }
     };
 
     // 连接基类
@@ -76,10 +176,28 @@ namespace JsonRpc
         using s_ptr = std::shared_ptr<BaseConnection>;
         // 发送消息
         virtual void send(const BaseMessage::s_ptr& msg) = 0;
+        // 发送已编码的帧，帧数据在多个连接间共享，不会为每个连接重新编码
+        virtual void send(const SharedFrame& frame) = 0;
+        // 连接使用的协议，相同协议的连接可以共享同一份编码结果
+        virtual BaseProtocol::s_ptr protocol() = 0;
+        // 更换连接的协议，握手协商出新的正文编码后由网络层在 I/O 线程中调用
+        virtual void setProtocol(const BaseProtocol::s_ptr& proto) = 0;
         // 关闭连接
         virtual void shutdown() = 0;
+        // 强制关闭连接，不等待输出缓冲区发送完成
+        virtual void forceClose() = 0;
         // 检查连接
         virtual bool connected() = 0;
+        // 输出缓冲区是否积压: 超过高水位后为 true，缓冲区写空后恢复为 false
+        virtual bool congested() = 0;
+        // 输出缓冲区写空时的回调，在连接所属的 I/O 线程中执行
+        virtual void setDrainCallback(const std::function<void()>& cb) = 0;
+        // 在连接所属的 I/O 线程中执行任务，当前已在该线程时立即执行
+        virtual void runInLoop(const std::function<void()>& task) = 0;
+        // delay 秒后在连接所属的 I/O 线程中执行任务
+        virtual void runAfter(double delay, const std::function<void()>& task) = 0;
+        // 在连接所属的 I/O 线程的下一轮循环中执行任务，即使当前已在该线程
+        virtual void queueInLoop(const std::function<void()>& task) = 0;
     };
 
     // 回调函数
@@ -111,12 +229,41 @@ namespace JsonRpc
             _cb_message = cb_message;
         }
 
+        // 连接输出缓冲区的高水位，超过后连接进入积压状态，需要在 start 之前设置
+        virtual void setHighWaterMark(size_t bytes)
+        {
+            _high_water_mark = bytes;
+        }
+
+        // 协商了压缩的连接上，正文达到该长度的帧才压缩发送，需要在 start 之前设置
+        virtual void setCompressThreshold(size_t bytes)
+        {
+            _compress_threshold = bytes;
+        }
+
+        // 超过该长度的帧切分为分片发送，与客户端握手时取两者中较小的值，0 表示不分片，需要在 start 之前设置
+        virtual void setChunkSize(size_t bytes)
+        {
+            _chunk_size = bytes;
+        }
+
+        // 每个连接接收方向占用内存的上限(未收完的帧 + 拼接中的分片)，超过后关闭连接，需要在 start 之前设置
+        virtual void setConnectionMemoryLimit(size_t bytes)
+        {
+            _connection_memory_limit = bytes;
+        }
+
         virtual void start() = 0;
+        virtual void stop() = 0;
 
     protected:
         ConnectionCallback _cb_connection;
         CloseCallback _cb_close;
         MessageCallback _cb_message;
+        size_t _high_water_mark = 64 * 1024 * 1024;
+        size_t _compress_threshold = 1024;
+        size_t _chunk_size = 64 * 1024;
+        size_t _connection_memory_limit = 16 * 1024 * 1024;
     };
 
     // 客户基类
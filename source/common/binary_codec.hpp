@@ -0,0 +1,446 @@
+/*
+ *  消息正文的紧凑二进制编码，与 JSON 文本表示同一个 Json::Value
+ *  每个值以 1 字节类型标签开头:
+ *    NULL / FALSE / TRUE       只有标签
+ *    UINT   varint             非负整数
+ *    NEGINT varint(-1 - v)     负整数
+ *    DOUBLE 8 字节              IEEE754 位模式，小端
+ *    STRING varint(len) bytes
+ *    ARRAY  varint(n) 值 * n
+ *    OBJECT varint(n) (键 值) * n
+ *  varint 为 LEB128，每字节 7 位、低位在前
+ *  对象的键做驻留: varint(h)
+ *    h 为奇数: 引用键表中第 h >> 1 个键，键表 = 协议字段的静态字典 + 本条消息中已出现过的键
+ *    h 为偶数: 长度为 h >> 1 的键名紧随其后，并追加到键表末尾(键表未满时)
+ *  使用连接上的键字典(KeyDictionary)编码时，键表 = 静态字典 + 该连接此前所有消息中出现过的键
+ *  静态字典只能在末尾追加，否则新旧版本的编码不兼容
+ */
+#pragma once
+
+#include "util.hpp"
+#include "fields.hpp"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <unordered_map>
+
+namespace JsonRpc
+{
+    // 连接上的键字典，协商了 CODEC_BINARY_DICT 的连接每个方向一个(见 MuduoConnection)
+    // 发送方第一次编码某个对象键时原样发送并追加到字典，之后的消息只发送序号，接收方解码到原样的键时按相同规则追加
+    // 双方都按帧的顺序更新，字典始终一致；字典满后新出现的键一直原样发送
+    class KeyDictionary
+    {
+    public:
+        static const size_t maxKeys = 1024;  // 每个方向最多驻留的键数，限制每个连接占用的内存
+        static const size_t maxKeyLen = 64;  // 更长的键通常是数据而不是字段名，不驻留
+
+        size_t size() const
+        {
+            return _keys.size();
+        }
+
+        bool find(const std::string& key, uint64_t& index) const
+        {
+            auto it = _index.find(key);
+            if (it == _index.end())
+                return false;
+            index = it->second;
+            return true;
+        }
+
+        // 序号越界时返回空指针
+        const std::string* at(uint64_t index) const
+        {
+            return index < _keys.size() ? &_keys[index] : nullptr;
+        }
+
+        // 追加新键，字典已满或键过长时忽略，发送方与接收方必须使用同一规则
+        void add(const std::string& key)
+        {
+            if (_keys.size() >= maxKeys || key.size() > maxKeyLen)
+                return;
+            _index.emplace(key, _keys.size());
+            _keys.push_back(key);
+        }
+
+        // 撤销长度 size 之后追加的键，发送方放弃已编码的帧、改为不使用字典编码时调用
+        void truncate(size_t size)
+        {
+            while (_keys.size() > size)
+            {
+                _index.erase(_keys.back());
+                _keys.pop_back();
+            }
+        }
+
+    private:
+        std::vector<std::string> _keys;
+        std::unordered_map<std::string, uint64_t> _index;
+    };
+
+    class BinaryCodec
+    {
+    public:
+        // 编码
+        static bool serialize(const Json::Value& val, std::string& body)
+        {
+            body.clear();
+            std::vector<std::string> keys;
+            encode(val, body, keys, nullptr);
+            return true;
+        }
+
+        // 编码并追加到输出对象末尾，Out 需要提供 append(const char*, size_t)，例如直接写入连接的发送缓冲区
+        // dict 不为空时使用并更新连接上的键字典，否则只在本条消息内驻留
+        template <typename Out>
+        static bool serialize(const Json::Value& val, Out& out, KeyDictionary* dict = nullptr)
+        {
+            std::vector<std::string> keys;
+            encode(val, out, keys, dict);
+            return true;
+        }
+
+        // 解码，数据不完整、标签未知或嵌套过深时返回 false
+        static bool unSerialize(const std::string& body, Json::Value& val)
+        {
+            return unSerialize(body.data(), body.data() + body.size(), val);
+        }
+
+        // dict 必须与编码时使用的字典对应，解码时同样会更新
+        static bool unSerialize(const char* begin, const char* end, Json::Value& val, KeyDictionary* dict = nullptr)
+        {
+            const char* pos = begin;
+            std::vector<std::string> keys;
+            val = Json::Value();
+            if (!decode(pos, end, val, keys, dict, 0) || pos != end)
+            {
+                E_LOG("二进制正文解析失败!");
+                return false;
+            }
+            return true;
+        }
+
+        // varint 也用于 v2 帧头(见 LVProtocolV2)
+        static const size_t maxVarintSize = 10;
+
+        // 写入 buf，返回写入的字节数，buf 至少 maxVarintSize byte
+        static size_t encodeVarint(char* buf, uint64_t v)
+        {
+            size_t n = 0;
+            while (v >= 0x80)
+            {
+                buf[n++] = (char)(v | 0x80);
+                v >>= 7;
+            }
+            buf[n++] = (char)v;
+            return n;
+        }
+
+        template <typename Out>
+        static void putVarint(Out& out, uint64_t v)
+        {
+            char buf[maxVarintSize];
+            out.append(buf, encodeVarint(buf, v));
+        }
+
+        // 数据不完整或超过 64 位时返回 false
+        static bool getVarint(const char*& pos, const char* end, uint64_t& v)
+        {
+            v = 0;
+            for (int shift = 0; shift < 64 && pos < end; shift += 7)
+            {
+                uint8_t byte = (uint8_t)*pos++;
+                v |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+    private:
+        enum Tag : uint8_t
+        {
+            TAG_NULL = 0,
+            TAG_FALSE,
+            TAG_TRUE,
+            TAG_UINT,
+            TAG_NEGINT,
+            TAG_DOUBLE,
+            TAG_STRING,
+            TAG_ARRAY,
+            TAG_OBJECT
+        };
+
+        static const size_t maxDynamicKeys = 64; // 每条消息最多驻留的键数
+        static const int maxDepth = 256;         // 解码时的最大嵌套层数
+
+        // 协议字段的静态字典，只能在末尾追加
+        static const std::vector<std::string>& dictionary()
+        {
+            static const std::vector<std::string> dict = {
+                KEY_METHOD, KEY_PARAMS, KEY_TOPIC_KEY, KEY_TOPIC_MSG, KEY_TOPIC_SEQ,
+                KEY_REPLAY_FROM, KEY_REPLAY_LAST, KEY_TOPIC_BATCH, KEY_NO_ACK, KEY_TOPIC_KEYS,
+                KEY_FILTER, KEY_FILTER_FIELD, KEY_FILTER_OP, KEY_FILTER_VALUE, KEY_FILTER_VALUES,
+                KEY_FILTER_MIN, KEY_FILTER_MAX, KEY_GROUP, KEY_GROUP_BALANCE, KEY_RELIABLE,
+                KEY_CONSUMER, KEY_ACK_SEQ, KEY_OPTYPE, KEY_HOST, KEY_HOST_IP,
+                KEY_HOST_PORT, KEY_RCODE, KEY_RESULT
+            };
+            return dict;
+        }
+
+        static const std::unordered_map<std::string, uint64_t>& dictionaryIndex()
+        {
+            static const std::unordered_map<std::string, uint64_t> index = []() {
+                std::unordered_map<std::string, uint64_t> m;
+                const std::vector<std::string>& dict = dictionary();
+                for (size_t i = 0; i < dict.size(); i++)
+                    m.emplace(dict[i], i);
+                return m;
+            }();
+            return index;
+        }
+
+        template <typename Out>
+        static void put(Out& out, char c)
+        {
+            out.append(&c, 1);
+        }
+
+        static void put(std::string& out, char c)
+        {
+            out.push_back(c);
+        }
+
+        // 有连接的键字典时代替本条消息的键表
+        template <typename Out>
+        static void encodeKey(const char* name, size_t len, Out& out, std::vector<std::string>& keys, KeyDictionary* dict)
+        {
+            std::string key(name, len);
+            const std::unordered_map<std::string, uint64_t>& index = dictionaryIndex();
+            auto it = index.find(key);
+            if (it != index.end())
+            {
+                putVarint(out, it->second << 1 | 1);
+                return;
+            }
+
+            if (dict)
+            {
+                uint64_t n;
+                if (dict->find(key, n))
+                {
+                    putVarint(out, (dictionary().size() + n) << 1 | 1);
+                    return;
+                }
+                putVarint(out, (uint64_t)len << 1);
+                out.append(name, len);
+                dict->add(key);
+                return;
+            }
+
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                if (keys[i] == key)
+                {
+                    putVarint(out, (dictionary().size() + i) << 1 | 1);
+                    return;
+                }
+            }
+
+            putVarint(out, (uint64_t)len << 1);
+            out.append(name, len);
+            if (keys.size() < maxDynamicKeys)
+                keys.push_back(std::move(key));
+        }
+
+        static bool decodeKey(const char*& pos, const char* end, std::string& key,
+            std::vector<std::string>& keys, KeyDictionary* dict)
+        {
+            uint64_t h;
+            if (!getVarint(pos, end, h))
+                return false;
+
+            uint64_t n = h >> 1;
+            if (h & 1)
+            {
+                const std::vector<std::string>& statics = dictionary();
+                if (n < statics.size())
+                {
+                    key = statics[n];
+                    return true;
+                }
+                n -= statics.size();
+                const std::string* found = dict ? dict->at(n) : (n < keys.size() ? &keys[n] : nullptr);
+                if (!found)
+                    return false;
+                key = *found;
+                return true;
+            }
+
+            if (n > (uint64_t)(end - pos))
+                return false;
+            key.assign(pos, n);
+            pos += n;
+            if (dict)
+                dict->add(key);
+            else if (keys.size() < maxDynamicKeys)
+                keys.push_back(key);
+            return true;
+        }
+
+        template <typename Out>
+        static void encode(const Json::Value& val, Out& out, std::vector<std::string>& keys, KeyDictionary* dict)
+        {
+            switch (val.type())
+            {
+            case Json::nullValue:
+                put(out, (char)TAG_NULL);
+                break;
+            case Json::booleanValue:
+                put(out, (char)(val.asBool() ? TAG_TRUE : TAG_FALSE));
+                break;
+            case Json::intValue:
+            {
+                int64_t v = val.asInt64();
+                if (v >= 0)
+                {
+                    put(out, (char)TAG_UINT);
+                    putVarint(out, (uint64_t)v);
+                }
+                else
+                {
+                    put(out, (char)TAG_NEGINT);
+                    putVarint(out, (uint64_t)(-(v + 1)));
+                }
+                break;
+            }
+            case Json::uintValue:
+                put(out, (char)TAG_UINT);
+                putVarint(out, val.asUInt64());
+                break;
+            case Json::realValue:
+            {
+                double d = val.asDouble();
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                char buf[8];
+                for (int i = 0; i < 8; i++)
+                    buf[i] = (char)(bits >> (i * 8));
+                put(out, (char)TAG_DOUBLE);
+                out.append(buf, 8);
+                break;
+            }
+            case Json::stringValue:
+            {
+                const char* begin = nullptr;
+                const char* end = nullptr;
+                val.getString(&begin, &end);
+                put(out, (char)TAG_STRING);
+                putVarint(out, end - begin);
+                out.append(begin, end - begin);
+                break;
+            }
+            case Json::arrayValue:
+                put(out, (char)TAG_ARRAY);
+                putVarint(out, val.size());
+                for (Json::ArrayIndex i = 0; i < val.size(); i++)
+                    encode(val[i], out, keys, dict);
+                break;
+            case Json::objectValue:
+                put(out, (char)TAG_OBJECT);
+                putVarint(out, val.size());
+                for (auto it = val.begin(); it != val.end(); ++it)
+                {
+                    const char* end = nullptr;
+                    const char* name = it.memberName(&end);
+                    encodeKey(name, end - name, out, keys, dict);
+                    encode(*it, out, keys, dict);
+                }
+                break;
+            }
+        }
+
+        static bool decode(const char*& pos, const char* end, Json::Value& val,
+            std::vector<std::string>& keys, KeyDictionary* dict, int depth)
+        {
+            if (pos >= end || depth > maxDepth)
+                return false;
+
+            uint8_t tag = (uint8_t)*pos++;
+            uint64_t n;
+            switch (tag)
+            {
+            case TAG_NULL:
+                val = Json::Value();
+                return true;
+            case TAG_FALSE:
+                val = false;
+                return true;
+            case TAG_TRUE:
+                val = true;
+                return true;
+            case TAG_UINT: // 与 JSON 文本解析一致: 能放进 int64 时为有符号整数
+                if (!getVarint(pos, end, n))
+                    return false;
+                if (n <= (uint64_t)INT64_MAX)
+                    val = Json::Value((Json::Int64)n);
+                else
+                    val = Json::Value((Json::UInt64)n);
+                return true;
+            case TAG_NEGINT:
+                if (!getVarint(pos, end, n) || n > (uint64_t)INT64_MAX)
+                    return false;
+                val = Json::Value((Json::Int64)(-(int64_t)n - 1));
+                return true;
+            case TAG_DOUBLE:
+            {
+                if (end - pos < 8)
+                    return false;
+                uint64_t bits = 0;
+                for (int i = 0; i < 8; i++)
+                    bits |= (uint64_t)(uint8_t)pos[i] << (i * 8);
+                pos += 8;
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                val = d;
+                return true;
+            }
+            case TAG_STRING:
+                if (!getVarint(pos, end, n) || n > (uint64_t)(end - pos))
+                    return false;
+                val = Json::Value(pos, pos + n);
+                pos += n;
+                return true;
+            case TAG_ARRAY:
+                if (!getVarint(pos, end, n) || n > (uint64_t)(end - pos)) // 每个元素至少 1 字节
+                    return false;
+                val = Json::Value(Json::arrayValue);
+                if (n > 0)
+                    val.resize((Json::ArrayIndex)n);
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    if (!decode(pos, end, val[(Json::ArrayIndex)i], keys, dict, depth + 1))
+                        return false;
+                }
+                return true;
+            case TAG_OBJECT:
+            {
+                if (!getVarint(pos, end, n) || n > (uint64_t)(end - pos) / 2) // 每个成员至少 2 字节
+                    return false;
+                val = Json::Value(Json::objectValue);
+                std::string key;
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    if (!decodeKey(pos, end, key, keys, dict) || !decode(pos, end, val[key], keys, dict, depth + 1))
+                        return false;
+                }
+                return true;
+            }
+            }
+            return false;
+        }
+    };
+}
@@ -0,0 +1,283 @@
+/*
+ *  帧正文压缩，握手时协商算法，之后由 LVProtocol 按发送方的阈值逐帧决定是否压缩
+ *  压缩帧的正文: | varint(原始长度) | 压缩数据 |，帧头中的压缩标志见 LVProtocol、LVProtocolV2
+ *  算法按编译选项启用:
+ *    zlib  -DJSONRPC_WITH_ZLIB，链接 z
+ *    lz4   -DJSONRPC_WITH_LZ4，链接 lz4
+ *    zstd  -DJSONRPC_WITH_ZSTD，链接 zstd
+ *  新增算法: 实现 Compressor，在 CompressType 末尾追加类型，并加入 CompressorFactory
+ */
+#pragma once
+
+#include "util.hpp"
+#include "fields.hpp"
+#include "binary_codec.hpp"
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+#ifdef JSONRPC_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef JSONRPC_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef JSONRPC_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace JsonRpc
+{
+    // 客户端的压缩策略
+    struct CompressPolicy
+    {
+        CompressType type = CompressType::COMPRESS_NONE; // 握手时请求的算法，服务端不支持时不压缩
+        size_t threshold = 1024; // 正文达到该长度才压缩，小帧压缩收益低且占用 CPU
+        size_t max_raw = 16 * 1024 * 1024; // 解压后正文的上限，取连接接收方向的内存上限，防止小帧解压出超大数据
+    };
+
+    // 进程内所有连接的压缩统计
+    struct CompressStats
+    {
+        uint64_t compressed_frames = 0;   // 压缩后发送的帧数
+        uint64_t skipped_frames = 0;      // 达到阈值但压缩后没有变小，原样发送的帧数
+        uint64_t raw_bytes = 0;           // 压缩帧的原始正文长度之和
+        uint64_t compressed_bytes = 0;    // 压缩帧的正文长度之和
+        uint64_t compress_ns = 0;         // 压缩占用的 CPU 时间，包括没有变小的帧
+        uint64_t decompressed_frames = 0; // 收到并解压的帧数
+        uint64_t decompress_ns = 0;       // 解压占用的 CPU 时间
+
+        // 节省的发送字节数
+        uint64_t savedBytes() const { return raw_bytes - compressed_bytes; }
+    };
+
+    class Compressor
+    {
+    public:
+        using s_ptr = std::shared_ptr<Compressor>;
+
+        virtual ~Compressor() = default;
+
+        virtual CompressType type() = 0;
+
+        // 正文达到阈值且压缩后更小时返回 true，packed 为 | varint(原始长度) | 压缩数据 |
+        bool pack(const char* data, size_t len, size_t threshold, std::string& packed)
+        {
+            if (len < threshold)
+                return false;
+
+            uint64_t start = cpuTime();
+            packed.clear();
+            BinaryCodec::putVarint(packed, len);
+            size_t header = packed.size();
+            bool ret = compress(data, len, packed) && packed.size() < len;
+
+            Counters& c = counters();
+            c.compress_ns += cpuTime() - start;
+            if (!ret)
+            {
+                c.skipped_frames++;
+                return false;
+            }
+            c.compressed_frames++;
+            c.raw_bytes += len;
+            c.compressed_bytes += packed.size() - header;
+            return true;
+        }
+
+        // 解压 pack 的结果，原始长度超过 maxRaw 或数据损坏时返回 false
+        bool unpack(const char* data, size_t len, size_t maxRaw, std::string& raw)
+        {
+            const char* pos = data;
+            uint64_t rawLen = 0;
+            if (!BinaryCodec::getVarint(pos, data + len, rawLen) || rawLen > maxRaw)
+            {
+                E_LOG("压缩正文长度错误!");
+                return false;
+            }
+
+            uint64_t start = cpuTime();
+            raw.resize(rawLen);
+            bool ret = decompress(pos, data + len - pos, &raw[0], rawLen);
+
+            Counters& c = counters();
+            c.decompress_ns += cpuTime() - start;
+            c.decompressed_frames++;
+            if (!ret)
+                E_LOG("正文解压失败!");
+            return ret;
+        }
+
+        // 统计快照
+        static CompressStats stats()
+        {
+            Counters& c = counters();
+            CompressStats s;
+            s.compressed_frames = c.compressed_frames;
+            s.skipped_frames = c.skipped_frames;
+            s.raw_bytes = c.raw_bytes;
+            s.compressed_bytes = c.compressed_bytes;
+            s.compress_ns = c.compress_ns;
+            s.decompressed_frames = c.decompressed_frames;
+            s.decompress_ns = c.decompress_ns;
+            return s;
+        }
+
+    protected:
+        // 把 data 压缩后追加到 out 末尾
+        virtual bool compress(const char* data, size_t len, std::string& out) = 0;
+        // 解压到 raw，解压后的长度必须恰好为 rawLen
+        virtual bool decompress(const char* data, size_t len, char* raw, size_t rawLen) = 0;
+
+    private:
+        struct Counters
+        {
+            std::atomic<uint64_t> compressed_frames{0};
+            std::atomic<uint64_t> skipped_frames{0};
+            std::atomic<uint64_t> raw_bytes{0};
+            std::atomic<uint64_t> compressed_bytes{0};
+            std::atomic<uint64_t> compress_ns{0};
+            std::atomic<uint64_t> decompressed_frames{0};
+            std::atomic<uint64_t> decompress_ns{0};
+        };
+
+        static Counters& counters()
+        {
+            static Counters c;
+            return c;
+        }
+
+        // 当前线程占用的 CPU 时间，只在压缩、解压的帧上调用
+        static uint64_t cpuTime()
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+            return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+    };
+
+#ifdef JSONRPC_WITH_ZLIB
+    class ZlibCompressor : public Compressor
+    {
+    public:
+        virtual CompressType type() override
+        {
+            return CompressType::COMPRESS_ZLIB;
+        }
+
+    protected:
+        virtual bool compress(const char* data, size_t len, std::string& out) override
+        {
+            size_t pos = out.size();
+            uLongf outLen = compressBound(len);
+            out.resize(pos + outLen);
+            if (compress2((Bytef*)&out[pos], &outLen, (const Bytef*)data, len, Z_DEFAULT_COMPRESSION) != Z_OK)
+                return false;
+            out.resize(pos + outLen);
+            return true;
+        }
+
+        virtual bool decompress(const char* data, size_t len, char* raw, size_t rawLen) override
+        {
+            uLongf outLen = rawLen;
+            return uncompress((Bytef*)raw, &outLen, (const Bytef*)data, len) == Z_OK && outLen == rawLen;
+        }
+    };
+#endif
+
+#ifdef JSONRPC_WITH_LZ4
+    class Lz4Compressor : public Compressor
+    {
+    public:
+        virtual CompressType type() override
+        {
+            return CompressType::COMPRESS_LZ4;
+        }
+
+    protected:
+        virtual bool compress(const char* data, size_t len, std::string& out) override
+        {
+            size_t pos = out.size();
+            int bound = LZ4_compressBound((int)len);
+            if (bound <= 0)
+                return false;
+            out.resize(pos + bound);
+            int outLen = LZ4_compress_default(data, &out[pos], (int)len, bound);
+            if (outLen <= 0)
+                return false;
+            out.resize(pos + outLen);
+            return true;
+        }
+
+        virtual bool decompress(const char* data, size_t len, char* raw, size_t rawLen) override
+        {
+            return LZ4_decompress_safe(data, raw, (int)len, (int)rawLen) == (int)rawLen;
+        }
+    };
+#endif
+
+#ifdef JSONRPC_WITH_ZSTD
+    class ZstdCompressor : public Compressor
+    {
+    public:
+        virtual CompressType type() override
+        {
+            return CompressType::COMPRESS_ZSTD;
+        }
+
+    protected:
+        virtual bool compress(const char* data, size_t len, std::string& out) override
+        {
+            size_t pos = out.size();
+            size_t bound = ZSTD_compressBound(len);
+            out.resize(pos + bound);
+            size_t outLen = ZSTD_compress(&out[pos], bound, data, len, 3); // zstd 的默认等级
+            if (ZSTD_isError(outLen))
+                return false;
+            out.resize(pos + outLen);
+            return true;
+        }
+
+        virtual bool decompress(const char* data, size_t len, char* raw, size_t rawLen) override
+        {
+            size_t outLen = ZSTD_decompress(raw, rawLen, data, len);
+            return !ZSTD_isError(outLen) && outLen == rawLen;
+        }
+    };
+#endif
+
+    class CompressorFactory
+    {
+    public:
+        // 不支持或 COMPRESS_NONE 时返回空指针
+        static Compressor::s_ptr create(CompressType type)
+        {
+            switch (type)
+            {
+#ifdef JSONRPC_WITH_ZLIB
+            case CompressType::COMPRESS_ZLIB:
+                return std::make_shared<ZlibCompressor>();
+#endif
+#ifdef JSONRPC_WITH_LZ4
+            case CompressType::COMPRESS_LZ4:
+                return std::make_shared<Lz4Compressor>();
+#endif
+#ifdef JSONRPC_WITH_ZSTD
+            case CompressType::COMPRESS_ZSTD:
+                return std::make_shared<ZstdCompressor>();
+#endif
+            default:
+                return Compressor::s_ptr();
+            }
+        }
+
+        // 当前编译支持的算法
+        static bool supported(CompressType type)
+        {
+            return type == CompressType::COMPRESS_NONE || create(type) != nullptr;
+        }
+    };
+}
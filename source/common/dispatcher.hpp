@@ -68,17 +68,24 @@ namespace JsonRpc
         {
             I_LOG("dispatcher 收到消息, MType: %d!", (int)msg->mtype());
 
-            std::unique_lock<std::mutex> lock(_mtx);
+            Callback::s_ptr cb;
+            {
+                // 只在查表时加锁，回调在锁外执行，多个 I/O 线程可以并发处理消息
+                std::unique_lock<std::mutex> lock(_mtx);
+                auto it = _handlers.find(msg->mtype());
+                if (it != _handlers.end())
+                    cb = it->second;
+            }
 
-            if (_handlers.count(msg->mtype()) == 0)
+            if (!cb)
             {
                 E_LOG("消息类型 %d 不存在!", (int)msg->mtype());
                 conn->shutdown();
                 return;
             }
             
-            //             cb对象    回调函数
-            _handlers[msg->mtype()]->onMessage(conn, msg);
+            //  cb对象  回调函数
+            cb->onMessage(conn, msg);
         }
 
     private:
@@ -0,0 +1,422 @@
+/*
+ *  任务执行器
+ *  1.InlineExecutor: 在调用线程直接执行
+ *  2.ThreadPoolExecutor: 固定大小线程池(muduo::ThreadPool)
+ *  3.WorkStealingExecutor: 每个工作线程一个双端队列，空闲时随机窃取其它线程的任务
+ *  4.SerialExecutor: 在另一个执行器上按提交顺序逐个执行任务
+ */
+#pragma once
+
+#include "util.hpp"
+
+#include <muduo/base/ThreadPool.h>
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <random>
+
+namespace JsonRpc
+{
+    using Task = std::function<void()>;
+
+    // 执行器基类
+    class BaseExecutor
+    {
+    public:
+        using s_ptr = std::shared_ptr<BaseExecutor>;
+
+        virtual ~BaseExecutor() = default;
+
+        // 提交任务，线程安全
+        virtual void submit(Task task) = 0;
+        // 排队等待执行的任务数量
+        virtual size_t queueSize() = 0;
+    };
+
+    // 在提交任务的线程中直接执行
+    class InlineExecutor : public BaseExecutor
+    {
+    public:
+        using s_ptr = std::shared_ptr<InlineExecutor>;
+
+        virtual void submit(Task task) override
+        {
+            task();
+        }
+
+        virtual size_t queueSize() override
+        {
+            return 0;
+        }
+    };
+
+    // 固定大小线程池，所有线程共享一个任务队列
+    class ThreadPoolExecutor : public BaseExecutor
+    {
+    public:
+        using s_ptr = std::shared_ptr<ThreadPoolExecutor>;
+
+        // thread_num 为 0 时，muduo::ThreadPool 在提交线程中直接执行任务
+        ThreadPoolExecutor(const std::string& name, int thread_num)
+            : _pool(name)
+        {
+            _pool.start(thread_num);
+        }
+
+        ~ThreadPoolExecutor()
+        {
+            _pool.stop(); // 等待工作线程退出，队列中未执行的任务被丢弃
+        }
+
+        virtual void submit(Task task) override
+        {
+            _pool.run(std::move(task));
+        }
+
+        virtual size_t queueSize() override
+        {
+            return _pool.queueSize();
+        }
+
+    private:
+        muduo::ThreadPool _pool;
+    };
+
+    // 工作窃取线程池
+    // 每个工作线程拥有自己的任务队列(独立的锁)，没有全局任务队列:
+    //   外部线程提交: 轮询放入各工作线程队列的尾部
+    //   工作线程提交(派生子任务): 放入自己队列的尾部，从尾部取出执行(LIFO，缓存友好)
+    //   工作线程空闲: 从随机选取的其它队列头部窃取任务(FIFO，先窃取较早提交的任务)
+    // 全局的 _idle_mtx 只在工作线程无任务可做、准备休眠时使用
+    class WorkStealingExecutor : public BaseExecutor
+    {
+    public:
+        using s_ptr = std::shared_ptr<WorkStealingExecutor>;
+
+        // thread_num 为 0 时，在提交线程中直接执行任务
+        WorkStealingExecutor(const std::string& name, int thread_num)
+            : _name(name)
+            , _running(true)
+            , _next(0)
+            , _pending(0)
+            , _sleepers(0)
+            , _submitted(0)
+        {
+            for (int i = 0; i < thread_num; i++)
+                _workers.emplace_back(new Worker());
+
+            for (int i = 0; i < thread_num; i++)
+                _workers[i]->thread = std::thread(&WorkStealingExecutor::workerLoop, this, i);
+
+            I_LOG("工作窃取线程池 %s 启动，线程数: %d", _name.c_str(), thread_num);
+        }
+
+        ~WorkStealingExecutor()
+        {
+            {
+                std::unique_lock<std::mutex> lock(_idle_mtx);
+                _running = false;
+            }
+            _idle_cv.notify_all();
+
+            for (auto& worker : _workers) // 工作线程执行完所有剩余任务后退出
+                worker->thread.join();
+
+            I_LOG("工作窃取线程池 %s 退出，累计执行 %lu 个任务，窃取 %lu 次", _name.c_str(),
+                (unsigned long)executed(), (unsigned long)steals());
+        }
+
+        virtual void submit(Task task) override
+        {
+            if (_workers.empty())
+            {
+                task();
+                return;
+            }
+
+            _submitted.fetch_add(1, std::memory_order_relaxed);
+
+            // 工作线程派生的子任务放入自己的队列，其余线程轮询分配
+            ThreadLocal& tl = local();
+            size_t index = (tl.executor == this) 
+                ? tl.index 
+                : _next.fetch_add(1, std::memory_order_relaxed) % _workers.size();
+
+            _pending.fetch_add(1); // 先计数再入队，取出任务时计数不会出现负值
+            Worker& worker = *_workers[index];
+            {
+                std::unique_lock<std::mutex> lock(worker.mtx);
+                worker.tasks.push_back(std::move(task));
+                worker.size.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (_sleepers.load() > 0) // 有线程在休眠才需要唤醒
+            {
+                std::unique_lock<std::mutex> lock(_idle_mtx);
+                _idle_cv.notify_one();
+            }
+        }
+
+        // 所有队列中排队的任务总数
+        virtual size_t queueSize() override
+        {
+            return _pending.load(std::memory_order_relaxed);
+        }
+
+        // 指定工作线程的队列深度
+        size_t queueSize(size_t index)
+        {
+            return index < _workers.size() ? _workers[index]->size.load(std::memory_order_relaxed) : 0;
+        }
+
+        size_t threadNum()
+        {
+            return _workers.size();
+        }
+
+        // 累计提交的任务数
+        uint64_t submitted()
+        {
+            return _submitted.load(std::memory_order_relaxed);
+        }
+
+        // 累计执行的任务数
+        uint64_t executed()
+        {
+            uint64_t total = 0;
+            for (auto& worker : _workers)
+                total += worker->executed.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        // 累计窃取成功的次数
+        uint64_t steals()
+        {
+            uint64_t total = 0;
+            for (auto& worker : _workers)
+                total += worker->steals.load(std::memory_order_relaxed);
+            return total;
+        }
+
+        // 当前线程所属的工作窃取线程池，不是工作线程时返回 nullptr
+        // 业务回调中可以通过 current()->submit() 派生子任务，子任务进入本线程队列，不经过任何全局锁
+        static WorkStealingExecutor* current()
+        {
+            return local().executor;
+        }
+
+    private:
+        // 当前线程的归属信息，header-only 下用函数内静态变量代替静态成员
+        struct ThreadLocal
+        {
+            WorkStealingExecutor* executor;
+            size_t index;
+        };
+
+        static ThreadLocal& local()
+        {
+            static thread_local ThreadLocal t_local = { nullptr, 0 };
+            return t_local;
+        }
+
+        struct Worker
+        {
+            std::mutex mtx;          // 只保护本线程的队列，所有者与窃取者之间竞争
+            std::deque<Task> tasks;
+            std::atomic<size_t> size{0};
+            std::atomic<uint64_t> executed{0};
+            std::atomic<uint64_t> steals{0};
+            std::thread thread;
+        };
+
+        void workerLoop(size_t index)
+        {
+            local().executor = this;
+            local().index = index;
+            std::mt19937 rng(std::random_device{}() + index);
+
+            Task task;
+            while (true)
+            {
+                if (popLocal(index, task) || steal(index, rng, task))
+                {
+                    _pending.fetch_sub(1);
+                    task();
+                    task = nullptr; // 及时释放任务持有的资源
+                    _workers[index]->executed.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(_idle_mtx);
+                if (!_running && _pending.load() == 0)
+                    break;
+
+                _sleepers.fetch_add(1);
+                _idle_cv.wait(lock, [this]() { return _pending.load() > 0 || !_running; });
+                _sleepers.fetch_sub(1);
+            }
+
+            local().executor = nullptr;
+        }
+
+        // 从自己队列的尾部取任务
+        bool popLocal(size_t index, Task& task)
+        {
+            Worker& worker = *_workers[index];
+            std::unique_lock<std::mutex> lock(worker.mtx);
+            if (worker.tasks.empty())
+                return false;
+
+            task = std::move(worker.tasks.back());
+            worker.tasks.pop_back();
+            worker.size.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // 从随机位置开始遍历其它队列，窃取头部任务
+        bool steal(size_t index, std::mt19937& rng, Task& task)
+        {
+            size_t num = _workers.size();
+            size_t start = rng() % num;
+            for (size_t i = 0; i < num; i++)
+            {
+                size_t victim = (start + i) % num;
+                if (victim == index || _workers[victim]->size.load(std::memory_order_relaxed) == 0)
+                    continue;
+
+                Worker& worker = *_workers[victim];
+                std::unique_lock<std::mutex> lock(worker.mtx);
+                if (worker.tasks.empty())
+                    continue;
+
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                worker.size.fetch_sub(1, std::memory_order_relaxed);
+                _workers[index]->steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            return false;
+        }
+
+    private:
+        std::string _name;
+        std::vector<std::unique_ptr<Worker>> _workers;
+
+        std::mutex _idle_mtx; // 只用于空闲线程的休眠与唤醒
+        std::condition_variable _idle_cv;
+        bool _running;
+
+        std::atomic<size_t> _next;      // 外部提交的轮询位置
+        std::atomic<size_t> _pending;   // 所有队列中的任务总数
+        std::atomic<size_t> _sleepers;  // 休眠中的工作线程数
+        std::atomic<uint64_t> _submitted;
+
+    };
+
+    // 串行队列
+    // 任务按提交顺序执行，同一时刻最多一个任务在目标执行器上运行
+    // 多个串行队列共享同一个线程池时，队列之间并行、队列内部有序；每次只投递一个任务，各队列轮流使用线程
+    class SerialExecutor : public BaseExecutor, public std::enable_shared_from_this<SerialExecutor>
+    {
+    public:
+        using s_ptr = std::shared_ptr<SerialExecutor>;
+
+        SerialExecutor(const BaseExecutor::s_ptr& target)
+            : _target(target)
+            , _running(false)
+            , _size(0)
+        {}
+
+        virtual void submit(Task task) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _tasks.push_back(std::move(task));
+                _size.fetch_add(1, std::memory_order_relaxed);
+                if (_running)
+                    return;
+                _running = true;
+            }
+            schedule();
+        }
+
+        // 排队等待执行的任务数(不含正在执行的任务)
+        virtual size_t queueSize() override
+        {
+            return _size.load(std::memory_order_relaxed);
+        }
+
+    private:
+        // 把队头任务投递到目标执行器，执行完后再投递下一个
+        // 目标执行器在 submit 内同步执行任务时(InlineExecutor、0 个线程的线程池)，下一个任务不在任务内递归投递，
+        // 而是回到这里循环投递，栈深度与队列长度无关
+        void schedule()
+        {
+            std::shared_ptr<SerialExecutor> self = shared_from_this();
+            while (true)
+            {
+                // 0: submit 尚未返回; 1: submit 已返回(异步执行); 2: 任务在 submit 返回前执行完，由这里继续投递
+                auto state = std::make_shared<std::atomic<int>>(0);
+                _target->submit([self, state]() {
+                    if (!self->runFront())
+                        return;
+
+                    int expected = 0;
+                    if (!state->compare_exchange_strong(expected, 2))
+                        self->schedule(); // 异步执行，由任务投递下一个
+                });
+
+                int expected = 0;
+                if (state->compare_exchange_strong(expected, 1))
+                    return;
+            }
+        }
+
+        // 执行队头任务，返回是否还有排队的任务(没有时清除 _running)
+        bool runFront()
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+                _size.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            task();
+
+            std::unique_lock<std::mutex> lock(_mtx);
+            if (_tasks.empty())
+            {
+                _running = false;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        BaseExecutor::s_ptr _target;
+        std::mutex _mtx;
+        std::deque<Task> _tasks;
+        bool _running; // 是否已有任务投递到目标执行器
+        std::atomic<size_t> _size;
+    };
+
+    class ExecutorFactory
+    {
+    public:
+        template <typename T, typename ...Args>
+        static BaseExecutor::s_ptr create(Args&& ...args)
+        {
+            return std::make_shared<T>(std::forward<Args>(args)...);
+        }
+    };
+}
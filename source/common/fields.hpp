@@ -10,14 +10,38 @@ namespace JsonRpc
     const static std::string KEY_PARAMS = "parameters";   // 方法参数
     const static std::string KEY_TOPIC_KEY = "topic_key"; // 主题名称
     const static std::string KEY_TOPIC_MSG = "topic_msg"; // 主题消息
+    const static std::string KEY_TOPIC_SEQ = "topic_seq"; // 主题消息序号
+    const static std::string KEY_REPLAY_FROM = "replay_from"; // 订阅时从该序号开始回放保留的消息
+    const static std::string KEY_REPLAY_LAST = "replay_last"; // 订阅时回放最近的若干条消息
+    const static std::string KEY_TOPIC_BATCH = "topic_batch"; // 批量发布的消息数组 [{topic_key, topic_msg}]
+    const static std::string KEY_NO_ACK = "no_ack";           // 发布后服务端不响应
+    const static std::string KEY_TOPIC_KEYS = "topic_keys";   // 批量订阅/取消订阅的主题名称或通配符模式数组
+    const static std::string KEY_FILTER = "filter";           // 订阅的内容过滤条件
+    const static std::string KEY_FILTER_FIELD = "field";      // 过滤的顶层字段
+    const static std::string KEY_FILTER_OP = "op";            // 过滤操作
+    const static std::string KEY_FILTER_VALUE = "value";      // 等于
+    const static std::string KEY_FILTER_VALUES = "values";    // 属于集合
+    const static std::string KEY_FILTER_MIN = "min";          // 范围下限
+    const static std::string KEY_FILTER_MAX = "max";          // 范围上限
+    const static std::string KEY_GROUP = "group";             // 共享订阅的组名
+    const static std::string KEY_GROUP_BALANCE = "group_balance"; // 共享订阅组的分配方式
+    const static std::string KEY_RELIABLE = "reliable";       // 可靠订阅(至少一次)
+    const static std::string KEY_CONSUMER = "consumer";       // 消费者标识，重连后以同一标识续订未确认的消息
+    const static std::string KEY_ACK_SEQ = "ack_seq";         // 累计确认的消息序号
     const static std::string KEY_OPTYPE = "optype";       // 操作类型
     const static std::string KEY_HOST = "host";           // 主机信息
     const static std::string KEY_HOST_IP = "ip";          // ip地址
     const static std::string KEY_HOST_PORT = "port";      // 端口号
+    const static std::string KEY_CODECS = "codecs";       // 握手时客户端支持的正文编码，按偏好排序
+    const static std::string KEY_FRAME = "frame";         // 握手时客户端支持的最高帧头版本，响应中为协商的版本
+    const static std::string KEY_COMPRESSES = "compresses"; // 握手时客户端支持的正文压缩算法，按偏好排序
+    const static std::string KEY_CHUNK = "chunk";         // 握手时客户端的分片长度，响应中为协商的分片长度，0 表示不分片
 
     // 响应字段
     const static std::string KEY_RCODE = "retcode";  // 响应码
     const static std::string KEY_RESULT = "result"; // 响应结果
+    const static std::string KEY_CODEC = "codec";   // 握手后连接使用的正文编码
+    const static std::string KEY_COMPRESS = "compress"; // 握手后连接使用的正文压缩算法
     
     // 消息类型定义
     enum class MType 
@@ -30,7 +54,14 @@ namespace JsonRpc
         RSP_TOPIC,
         // 服务操作请求响应
         REQ_SERVICE,
-        RSP_SERVICE
+        RSP_SERVICE,
+        // 合并推送: 正文为多条完整的主题推送帧
+        REQ_TOPIC_BUNDLE,
+        // 协商连接的正文编码，正文总是 JSON
+        REQ_HANDSHAKE,
+        RSP_HANDSHAKE,
+        // 大消息的分片: 正文为被切分的完整帧的一段
+        REQ_CHUNK
     };
 
     // 响应码定义
@@ -78,7 +109,51 @@ namespace JsonRpc
         TOPIC_REMOVE,     // 主题删除
         TOPIC_SUBSCRIBE,  // 主题订阅
         TOPIC_CANCEL,     // 主题取消订阅
-        TOPIC_PUBLISH     // 发布消息
+        TOPIC_PUBLISH,    // 发布消息
+        TOPIC_PUBLISH_BATCH, // 批量发布消息，可以包含多个主题
+        TOPIC_SUBSCRIBE_BATCH, // 批量订阅
+        TOPIC_CANCEL_BATCH,    // 批量取消订阅
+        TOPIC_ACK              // 可靠订阅的累计确认
+    };
+
+    // 订阅过滤操作
+    enum class FilterOp
+    {
+        FILTER_EQ = 0, // 字段等于
+        FILTER_IN,     // 字段属于集合
+        FILTER_RANGE   // 字段在数值范围内
+    };
+
+    // 共享订阅组内的消息分配方式
+    enum class GroupBalance
+    {
+        GROUP_ROUND_ROBIN = 0,     // 轮询
+        GROUP_LEAST_OUTSTANDING    // 积压最少的成员
+    };
+
+    // 消息正文编码
+    enum class BodyCodec
+    {
+        CODEC_JSON = 0, // JSON 文本，未握手的连接默认使用
+        CODEC_BINARY,   // 紧凑二进制(见 binary_codec.hpp)
+        CODEC_PROTOBUF, // protobuf 类型化消息，帧格式也随之更换(见 pb_protocol.hpp)，需要 -DJSONRPC_WITH_PROTOBUF
+        CODEC_BINARY_DICT // 紧凑二进制 + 连接上逐步建立的键字典，对象键第一次出现后只发送序号(见 KeyDictionary)
+    };
+
+    // 正文压缩算法(见 compress.hpp)
+    enum class CompressType
+    {
+        COMPRESS_NONE = 0, // 不压缩，未握手的连接默认使用
+        COMPRESS_ZLIB,     // 需要 -DJSONRPC_WITH_ZLIB，链接 z
+        COMPRESS_LZ4,      // 需要 -DJSONRPC_WITH_LZ4，链接 lz4
+        COMPRESS_ZSTD      // 需要 -DJSONRPC_WITH_ZSTD，链接 zstd
+    };
+
+    // LVProtocol 的帧头版本
+    enum class FrameVersion
+    {
+        FRAME_V1 = 1, // 4 byte 定长字段 + 字符串 rid，未握手的连接默认使用
+        FRAME_V2      // varint 长度 + 1 byte mtype + 64 位整数关联 id(见 LVProtocolV2)
     };
 
     // 服务操作类型
@@ -3,9 +3,64 @@
 #include "util.hpp"
 #include "fields.hpp"
 #include "abstract.hpp"
+#include "topic_filter.hpp"
+#include "binary_codec.hpp"
+#ifdef JSONRPC_WITH_PROTOBUF
+#include "pb_codec.hpp"
+#endif
+
+#include <vector>
+#include <ostream>
+#include <streambuf>
 
 namespace JsonRpc
 {
+    // 以缓冲区的可写空间作为输出流的写入区，流式编码直接写进缓冲区，满了再向缓冲区申请
+    class BufferStreamBuf : public std::streambuf
+    {
+    public:
+        BufferStreamBuf(BaseBuffer& out)
+            : _out(out)
+        {
+            reserve();
+        }
+
+        ~BufferStreamBuf()
+        {
+            commit();
+        }
+
+    protected:
+        virtual int_type overflow(int_type c) override
+        {
+            commit();
+            reserve();
+            if (c != traits_type::eof())
+            {
+                *pptr() = (char)c;
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+    private:
+        void reserve()
+        {
+            char* p = _out.prepareWrite(chunkSize);
+            setp(p, p + chunkSize);
+        }
+
+        void commit()
+        {
+            _out.commitWrite(pptr() - pbase());
+            setp(pptr(), pptr()); // 已提交，之后 prepareWrite 可能移动缓冲区
+        }
+
+    private:
+        static const size_t chunkSize = 1024;
+        BaseBuffer& _out;
+    };
+
     // json消息类
     class JsonMessgae : public BaseMessage
     {
@@ -26,6 +81,69 @@ namespace JsonRpc
         {
             return JsonUtil::unSerialize(msg, _body);
         }
+
+        // 按正文编码序列化，各种编码表示同一个 _body
+        // protobuf 按 mtype 选择类型化消息，调用前需要先设置 mtype
+        virtual std::string serialize(BodyCodec codec) override
+        {
+            std::string body;
+            switch (codec)
+            {
+                case BodyCodec::CODEC_BINARY:
+                    BinaryCodec::serialize(_body, body);
+                    return body;
+#ifdef JSONRPC_WITH_PROTOBUF
+                case BodyCodec::CODEC_PROTOBUF:
+                    PbCodec::serialize(mtype(), _body, body);
+                    return body;
+#endif
+                default:
+                    return serialize();
+            }
+        }
+
+        virtual bool unSerialize(const std::string& msg, BodyCodec codec) override
+        {
+            return unSerialize(msg.data(), msg.data() + msg.size(), codec);
+        }
+
+        // 直接编码到缓冲区，JSON 通过 BufferStreamBuf 写入，二进制逐段追加
+        virtual void serializeTo(BodyCodec codec, BaseBuffer& out, KeyDictionary* keys = nullptr) override
+        {
+            switch (codec)
+            {
+                case BodyCodec::CODEC_BINARY:
+                    BinaryCodec::serialize(_body, out, keys);
+                    return;
+#ifdef JSONRPC_WITH_PROTOBUF
+                case BodyCodec::CODEC_PROTOBUF:
+                    BaseMessage::serializeTo(codec, out);
+                    return;
+#endif
+                default:
+                {
+                    BufferStreamBuf sb(out);
+                    std::ostream os(&sb);
+                    JsonUtil::serialize(_body, os);
+                    return;
+                }
+            }
+        }
+
+        virtual bool unSerialize(const char* begin, const char* end, BodyCodec codec, KeyDictionary* keys = nullptr) override
+        {
+            switch (codec)
+            {
+                case BodyCodec::CODEC_BINARY:
+                    return BinaryCodec::unSerialize(begin, end, _body, keys);
+#ifdef JSONRPC_WITH_PROTOBUF
+                case BodyCodec::CODEC_PROTOBUF:
+                    return PbCodec::unSerialize(mtype(), begin, end, _body);
+#endif
+                default:
+                    return JsonUtil::unSerialize(begin, end, _body);
+            }
+        }
     
     protected:
 
@@ -152,6 +270,12 @@ namespace JsonRpc
     public:
         using s_ptr = std::shared_ptr<TopicRequest>;
 
+        // 发布的消息会原样推送给订阅者
+        virtual bool keepRawBody() override
+        {
+            return true;
+        }
+
         virtual bool check() override
         {
             // 检查主题名称、主题操作类型字段
@@ -164,6 +288,61 @@ namespace JsonRpc
                 && !checkField(KEY_TOPIC_MSG, JsonType::STRING))
                 return false;
 
+            // 批量发布需要消息数组，每一项都要有主题名称和消息
+            if (_body[KEY_OPTYPE].asInt() == (int)TopicOpType::TOPIC_PUBLISH_BATCH)
+            {
+                if (!_body.isMember(KEY_TOPIC_BATCH) || !_body[KEY_TOPIC_BATCH].isArray())
+                {
+                    E_LOG("批量发布缺少消息数组!");
+                    return false;
+                }
+
+                for (auto& item : _body[KEY_TOPIC_BATCH])
+                {
+                    if (!item[KEY_TOPIC_KEY].isString() || !item[KEY_TOPIC_MSG].isString())
+                    {
+                        E_LOG("批量发布的消息格式错误!");
+                        return false;
+                    }
+                }
+            }
+
+            // 过滤条件必须能够编译
+            if (_body.isMember(KEY_FILTER) && !TopicFilter::compile(_body[KEY_FILTER]))
+            {
+                E_LOG("无效的订阅过滤条件!");
+                return false;
+            }
+
+            // 共享订阅的组名必须是字符串
+            if (_body.isMember(KEY_GROUP) && !checkField(KEY_GROUP, JsonType::STRING))
+                return false;
+
+            // 可靠订阅与确认需要消费者标识
+            int op = _body[KEY_OPTYPE].asInt();
+            if ((_body.isMember(KEY_RELIABLE) || op == (int)TopicOpType::TOPIC_ACK)
+                && !checkField(KEY_CONSUMER, JsonType::STRING))
+                return false;
+
+            // 批量订阅/取消订阅需要主题名称数组
+            if (op == (int)TopicOpType::TOPIC_SUBSCRIBE_BATCH || op == (int)TopicOpType::TOPIC_CANCEL_BATCH)
+            {
+                if (!_body.isMember(KEY_TOPIC_KEYS) || !_body[KEY_TOPIC_KEYS].isArray())
+                {
+                    E_LOG("批量订阅缺少主题数组!");
+                    return false;
+                }
+
+                for (auto& key : _body[KEY_TOPIC_KEYS])
+                {
+                    if (!key.isString())
+                    {
+                        E_LOG("批量订阅的主题名称类型错误!");
+                        return false;
+                    }
+                }
+            }
+
             return true;
         }
 
@@ -202,6 +381,164 @@ namespace JsonRpc
         {
             _body[KEY_TOPIC_MSG] = topicMsg;
         }
+
+        // 返回主题消息序号，没有序号时为 0
+        uint64_t topicSeq()
+        {
+            return _body.isMember(KEY_TOPIC_SEQ) ? _body[KEY_TOPIC_SEQ].asUInt64() : 0;
+        }
+
+        // 设置主题消息序号
+        void setTopicSeq(uint64_t seq)
+        {
+            _body[KEY_TOPIC_SEQ] = (Json::UInt64)seq;
+        }
+
+        // 返回订阅回放的起始序号，0 表示不按序号回放
+        uint64_t replayFrom()
+        {
+            return _body.isMember(KEY_REPLAY_FROM) ? _body[KEY_REPLAY_FROM].asUInt64() : 0;
+        }
+
+        // 设置订阅回放的起始序号
+        void setReplayFrom(uint64_t seq)
+        {
+            _body[KEY_REPLAY_FROM] = (Json::UInt64)seq;
+        }
+
+        // 返回订阅时回放的最近消息条数，0 表示不回放
+        uint64_t replayLast()
+        {
+            return _body.isMember(KEY_REPLAY_LAST) ? _body[KEY_REPLAY_LAST].asUInt64() : 0;
+        }
+
+        // 设置订阅时回放的最近消息条数
+        void setReplayLast(uint64_t count)
+        {
+            _body[KEY_REPLAY_LAST] = (Json::UInt64)count;
+        }
+
+        // 订阅的内容过滤条件，见 TopicFilter
+        bool hasFilter()
+        {
+            return _body.isMember(KEY_FILTER);
+        }
+
+        Json::Value filter()
+        {
+            return _body[KEY_FILTER];
+        }
+
+        void setFilter(const Json::Value& filter)
+        {
+            _body[KEY_FILTER] = filter;
+        }
+
+        // 共享订阅的组名，为空表示普通订阅
+        std::string group()
+        {
+            return _body.isMember(KEY_GROUP) ? _body[KEY_GROUP].asString() : std::string();
+        }
+
+        void setGroup(const std::string& group)
+        {
+            _body[KEY_GROUP] = group;
+        }
+
+        // 共享订阅组的分配方式，由创建该组的第一个成员决定
+        GroupBalance groupBalance()
+        {
+            return _body.isMember(KEY_GROUP_BALANCE) ? (GroupBalance)_body[KEY_GROUP_BALANCE].asInt() : GroupBalance::GROUP_ROUND_ROBIN;
+        }
+
+        void setGroupBalance(GroupBalance balance)
+        {
+            _body[KEY_GROUP_BALANCE] = (int)balance;
+        }
+
+        // 是否为可靠订阅
+        bool reliable()
+        {
+            return _body.isMember(KEY_RELIABLE) && _body[KEY_RELIABLE].asBool();
+        }
+
+        void setReliable(bool reliable)
+        {
+            _body[KEY_RELIABLE] = reliable;
+        }
+
+        // 可靠订阅的消费者标识
+        std::string consumer()
+        {
+            return _body.isMember(KEY_CONSUMER) ? _body[KEY_CONSUMER].asString() : std::string();
+        }
+
+        void setConsumer(const std::string& consumer)
+        {
+            _body[KEY_CONSUMER] = consumer;
+        }
+
+        // 累计确认的序号: 该序号及之前推送的消息都已处理
+        uint64_t ackSeq()
+        {
+            return _body.isMember(KEY_ACK_SEQ) ? _body[KEY_ACK_SEQ].asUInt64() : 0;
+        }
+
+        void setAckSeq(uint64_t seq)
+        {
+            _body[KEY_ACK_SEQ] = (Json::UInt64)seq;
+        }
+
+        // 发布后是否不需要响应
+        bool noAck()
+        {
+            return _body.isMember(KEY_NO_ACK) && _body[KEY_NO_ACK].asBool();
+        }
+
+        void setNoAck(bool noAck)
+        {
+            _body[KEY_NO_ACK] = noAck;
+        }
+
+        // 返回批量发布的消息: 主题名称 -> 消息
+        std::vector<std::pair<std::string, std::string>> topicBatch()
+        {
+            std::vector<std::pair<std::string, std::string>> batch;
+            for (auto& item : _body[KEY_TOPIC_BATCH])
+                batch.emplace_back(item[KEY_TOPIC_KEY].asString(), item[KEY_TOPIC_MSG].asString());
+            return batch;
+        }
+
+        // 设置批量发布的消息
+        void setTopicBatch(const std::vector<std::pair<std::string, std::string>>& batch)
+        {
+            Json::Value items(Json::arrayValue);
+            for (auto& msg : batch)
+            {
+                Json::Value item;
+                item[KEY_TOPIC_KEY] = msg.first;
+                item[KEY_TOPIC_MSG] = msg.second;
+                items.append(item);
+            }
+            _body[KEY_TOPIC_BATCH] = items;
+        }
+
+        // 返回批量订阅的主题名称(或通配符模式)
+        std::vector<std::string> topicKeys()
+        {
+            std::vector<std::string> keys;
+            for (auto& key : _body[KEY_TOPIC_KEYS])
+                keys.push_back(key.asString());
+            return keys;
+        }
+
+        void setTopicKeys(const std::vector<std::string>& keys)
+        {
+            Json::Value items(Json::arrayValue);
+            for (auto& key : keys)
+                items.append(key);
+            _body[KEY_TOPIC_KEYS] = items;
+        }
     };
 
     // service请求
@@ -278,6 +615,83 @@ namespace JsonRpc
         }
     };
 
+    // 握手请求，连接建立后客户端发送的第一条消息，服务端选出第一个支持的编码
+    // {
+    //      codecs: [CODEC_BINARY_DICT, CODEC_BINARY, CODEC_JSON],
+    //      frame: FRAME_V2 (可选),
+    //      compresses: [COMPRESS_ZLIB] (可选),
+    //      chunk: 65536 (可选)
+    // }
+    class HandshakeRequest : public JsonRequest
+    {
+    public:
+        using s_ptr = std::shared_ptr<HandshakeRequest>;
+
+        virtual bool check() override
+        {
+            return checkField(KEY_CODECS, JsonType::ARRAY);
+        }
+
+        std::vector<BodyCodec> codecs()
+        {
+            std::vector<BodyCodec> result;
+            for (auto& codec : _body[KEY_CODECS])
+                result.push_back((BodyCodec)codec.asInt());
+            return result;
+        }
+
+        void setCodecs(const std::vector<BodyCodec>& codecs)
+        {
+            _body[KEY_CODECS] = Json::Value(Json::arrayValue);
+            for (auto codec : codecs)
+                _body[KEY_CODECS].append((int)codec);
+        }
+
+        // 客户端支持的最高帧头版本，旧版本的客户端不带此字段
+        FrameVersion frameVersion()
+        {
+            if (!_body.isMember(KEY_FRAME) || !_body[KEY_FRAME].isInt())
+                return FrameVersion::FRAME_V1;
+            return (FrameVersion)_body[KEY_FRAME].asInt();
+        }
+
+        void setFrameVersion(FrameVersion frame)
+        {
+            _body[KEY_FRAME] = (int)frame;
+        }
+
+        // 客户端支持的压缩算法，旧版本的客户端不带此字段
+        std::vector<CompressType> compresses()
+        {
+            std::vector<CompressType> result;
+            if (!_body.isMember(KEY_COMPRESSES) || !_body[KEY_COMPRESSES].isArray())
+                return result;
+            for (auto& type : _body[KEY_COMPRESSES])
+                result.push_back((CompressType)type.asInt());
+            return result;
+        }
+
+        void setCompresses(const std::vector<CompressType>& types)
+        {
+            _body[KEY_COMPRESSES] = Json::Value(Json::arrayValue);
+            for (auto type : types)
+                _body[KEY_COMPRESSES].append((int)type);
+        }
+
+        // 客户端的分片长度，旧版本的客户端不带此字段，不分片
+        size_t chunkSize()
+        {
+            if (!_body.isMember(KEY_CHUNK) || !_body[KEY_CHUNK].isUInt())
+                return 0;
+            return _body[KEY_CHUNK].asUInt();
+        }
+
+        void setChunkSize(size_t size)
+        {
+            _body[KEY_CHUNK] = (Json::UInt)size;
+        }
+    };
+
     // ------------------------------ 响应 ------------------------------
 
     // json响应基类
@@ -425,6 +839,178 @@ namespace JsonRpc
         }
     };
 
+    // 握手响应，之后双方都按 codec 编码正文
+    // {
+    //      rcode: xxx,
+    //      codec: xxx,
+    //      frame: xxx,
+    //      compress: xxx,
+    //      chunk: xxx
+    // }
+    class HandshakeResponse : public JsonResponse
+    {
+    public:
+        using s_ptr = std::shared_ptr<HandshakeResponse>;
+
+        virtual bool check() override
+        {
+            return checkField(KEY_RCODE, JsonType::INT)
+                && checkField(KEY_CODEC, JsonType::INT);
+        }
+
+        BodyCodec codec()
+        {
+            return (BodyCodec)_body[KEY_CODEC].asInt();
+        }
+
+        void setCodec(BodyCodec codec)
+        {
+            _body[KEY_CODEC] = (int)codec;
+        }
+
+        // 协商的帧头版本，旧版本的服务端不带此字段
+        FrameVersion frameVersion()
+        {
+            if (!_body.isMember(KEY_FRAME) || !_body[KEY_FRAME].isInt())
+                return FrameVersion::FRAME_V1;
+            return (FrameVersion)_body[KEY_FRAME].asInt();
+        }
+
+        void setFrameVersion(FrameVersion frame)
+        {
+            _body[KEY_FRAME] = (int)frame;
+        }
+
+        // 协商的压缩算法，旧版本的服务端不带此字段
+        CompressType compress()
+        {
+            if (!_body.isMember(KEY_COMPRESS) || !_body[KEY_COMPRESS].isInt())
+                return CompressType::COMPRESS_NONE;
+            return (CompressType)_body[KEY_COMPRESS].asInt();
+        }
+
+        void setCompress(CompressType type)
+        {
+            _body[KEY_COMPRESS] = (int)type;
+        }
+
+        // 协商的分片长度，旧版本的服务端不带此字段，不分片
+        size_t chunkSize()
+        {
+            if (!_body.isMember(KEY_CHUNK) || !_body[KEY_CHUNK].isUInt())
+                return 0;
+            return _body[KEY_CHUNK].asUInt();
+        }
+
+        void setChunkSize(size_t size)
+        {
+            _body[KEY_CHUNK] = (Json::UInt)size;
+        }
+    };
+
+    // 合并推送消息
+    // 正文不是 JSON，而是若干条完整的帧依次拼接，由协议层打包与拆包(见 BaseProtocol::bundle/unbundle)
+    class BundleMessage : public BaseMessage
+    {
+    public:
+        using s_ptr = std::shared_ptr<BundleMessage>;
+
+        virtual std::string serialize() override
+        {
+            return rawBody();
+        }
+
+        // 正文由协议层保存为原始正文，这里不需要解析
+        virtual bool unSerialize(const std::string& msg) override
+        {
+            return true;
+        }
+
+        virtual bool unSerialize(const char* begin, const char* end, BodyCodec codec, KeyDictionary* keys = nullptr) override
+        {
+            return true;
+        }
+
+        virtual bool keepRawBody() override
+        {
+            return true;
+        }
+
+        virtual bool check() override
+        {
+            return true;
+        }
+    };
+
+    // 分片消息
+    // 超过协商分片长度的帧被切分为若干分片，接收方按流编号拼接完整后再按普通帧解析(见 MuduoConnection)
+    // 正文: | varint(流编号) | 1 byte 是否最后一片 | 帧数据 |，帧 id 与被切分的消息相同
+    class ChunkMessage : public BaseMessage
+    {
+    public:
+        using s_ptr = std::shared_ptr<ChunkMessage>;
+
+        virtual std::string serialize() override
+        {
+            return rawBody();
+        }
+
+        // 正文已经编码好，直接追加，不经过中间的 string
+        virtual void serializeTo(BodyCodec codec, BaseBuffer& out, KeyDictionary* keys = nullptr) override
+        {
+            out.append(rawBody().data(), rawBody().size());
+        }
+
+        // 正文由协议层保存为原始正文，取分片时再解析
+        virtual bool unSerialize(const std::string& msg) override
+        {
+            return true;
+        }
+
+        virtual bool unSerialize(const char* begin, const char* end, BodyCodec codec, KeyDictionary* keys = nullptr) override
+        {
+            return true;
+        }
+
+        virtual bool keepRawBody() override
+        {
+            return true;
+        }
+
+        virtual bool check() override
+        {
+            uint64_t stream;
+            bool last;
+            const char* data;
+            size_t len;
+            return chunk(stream, last, data, len);
+        }
+
+        void setChunk(uint64_t stream, bool last, const char* data, size_t len)
+        {
+            std::string body;
+            body.reserve(BinaryCodec::maxVarintSize + 1 + len);
+            BinaryCodec::putVarint(body, stream);
+            body.push_back(last ? 1 : 0);
+            body.append(data, len);
+            setRawBody(std::move(body));
+        }
+
+        // data 指向原始正文内部，正文格式错误时返回 false
+        bool chunk(uint64_t& stream, bool& last, const char*& data, size_t& len)
+        {
+            const std::string& body = rawBody();
+            const char* pos = body.data();
+            const char* end = pos + body.size();
+            if (!BinaryCodec::getVarint(pos, end, stream) || pos == end)
+                return false;
+            last = *pos++ != 0;
+            data = pos;
+            len = end - pos;
+            return true;
+        }
+    };
+
     // ------------------------------ 消息对象工厂 ------------------------------
     class MessageFactory
     {
@@ -446,6 +1032,14 @@ namespace JsonRpc
                     return std::make_shared<ServiceRequest>();
                 case MType::RSP_SERVICE:
                     return std::make_shared<ServiceResponse>();
+                case MType::REQ_TOPIC_BUNDLE:
+                    return std::make_shared<BundleMessage>();
+                case MType::REQ_HANDSHAKE:
+                    return std::make_shared<HandshakeRequest>();
+                case MType::RSP_HANDSHAKE:
+                    return std::make_shared<HandshakeResponse>();
+                case MType::REQ_CHUNK:
+                    return std::make_shared<ChunkMessage>();
             }
 
             return std::shared_ptr<BaseMessage>();
@@ -4,6 +4,11 @@
 #include "fields.hpp"
 #include "abstract.hpp"
 #include "message.hpp"
+#include "binary_codec.hpp"
+#include "compress.hpp"
+#ifdef JSONRPC_WITH_PROTOBUF
+#include "pb_protocol.hpp"
+#endif
 
 #include <muduo/net/TcpServer.h>
 #include <muduo/net/EventLoop.h>
@@ -14,7 +19,11 @@
 #include <muduo/net/TcpClient.h>
 
 #include <unordered_map>
+#include <deque>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
 
 namespace JsonRpc
 {
@@ -33,6 +42,18 @@ namespace JsonRpc
             return _buf->readableBytes();
         }
 
+        // 可读数据的起始位置
+        virtual const char* peek() override
+        {
+            return _buf->peek();
+        }
+
+        // 删除前 len byte 数据
+        virtual void retrieve(size_t len) override
+        {
+            _buf->retrieve(len);
+        }
+
         // 尝试取出 4 byte, 但是不删除
         virtual int32_t peekInt32()override
         {
@@ -58,6 +79,33 @@ namespace JsonRpc
             return _buf->retrieveAsString(len);
         }
 
+        virtual void append(const char* data, size_t len) override
+        {
+            _buf->append(data, len);
+        }
+
+        virtual char* prepareWrite(size_t len) override
+        {
+            _buf->ensureWritableBytes(len);
+            return _buf->beginWrite();
+        }
+
+        virtual void commitWrite(size_t len) override
+        {
+            _buf->hasWritten(len);
+        }
+
+        // muduo 的缓冲区头部预留了 8 byte，回填长度不需要移动数据
+        virtual void prependInt32(int32_t x) override
+        {
+            _buf->prependInt32(x);
+        }
+
+        virtual void prepend(const char* data, size_t len) override
+        {
+            _buf->prepend(data, len);
+        }
+
     private:
         muduo::net::Buffer* _buf;
     };
@@ -76,10 +124,27 @@ namespace JsonRpc
     {
         // | len | value |
         // | len | mtype | idlen | id | body |
+        // 帧头的格式固定，正文按构造时指定的编码解析，握手消息的正文总是 JSON
+        // 关联 id 以十进制字符串放在 id 中(见 BaseProtocol::textId)
+        // 协商了压缩算法时，正文达到阈值的帧压缩发送，mtype 中置位 compressFlag(见 compress.hpp)
+        // CODEC_BINARY_DICT: 正文为二进制编码，引用了连接键字典的帧在 mtype 中置位 keysFlag
+        //   共享帧、转发的原始正文不依赖任何连接的状态，不置位，接收方按普通二进制正文解析
     
     public:
         using s_ptr = std::shared_ptr<LVProtocol>;
 
+        LVProtocol(BodyCodec codec = BodyCodec::CODEC_JSON, const CompressPolicy& compress = CompressPolicy())
+            : _codec(codec)
+            , _compressor(CompressorFactory::create(compress.type))
+            , _threshold(compress.threshold)
+            , _max_raw(compress.max_raw)
+        {}
+
+        virtual BodyCodec codec() override
+        {
+            return _codec;
+        }
+
         // 缓冲区是否可转化为消息
         virtual bool canProcessed(const BaseBuffer::s_ptr& buf) override
         {
@@ -91,16 +156,30 @@ namespace JsonRpc
         }
 
         // 将缓冲区转化为消息
-        virtual bool onMessage(const BaseBuffer::s_ptr& buf, BaseMessage::s_ptr& msg) override
+        // 直接在缓冲区上按指针范围解析帧头和正文，不先拷贝为 string，解析成功后才从缓冲区删除这一帧
+        virtual bool onMessage(const BaseBuffer::s_ptr& buf, BaseMessage::s_ptr& msg, KeyDictionary* keys = nullptr) override
         {
             // | len | mtype | idlen | id | body |
-            int32_t totalLen = buf->readInt32();
-            MType mtype = (MType)buf->readInt32();
-            int32_t idLen = buf->readInt32();
-            std::string id = buf->retrieveAsString(idLen);
+            const char* data = buf->peek();
+            int32_t totalLen = toInt32(data);
+            int32_t type = toInt32(data + totalLenfieldsize);
+            MType mtype = (MType)(type & ~(compressFlag | keysFlag));
+            int32_t idLen = toInt32(data + totalLenfieldsize + mtypefieldsize);
+            int32_t bodySize = totalLen - mtypefieldsize - idLenfieldsize - idLen;
+            if (idLen < 0 || bodySize < 0)
+            {
+                E_LOG("帧长度字段错误!");
+                return false;
+            }
 
-            int32_t bodyLen = totalLen - mtypefieldsize - idLenfieldsize - idLen;
-            std::string body = buf->retrieveAsString(bodyLen);
+            const char* id = data + totalLenfieldsize + mtypefieldsize + idLenfieldsize;
+            const char* body = id + idLen;
+            size_t bodyLen = bodySize;
+            ScratchRelease release;
+            if ((type & compressFlag) && !unpackBody(body, bodyLen))
+                return false;
+            if (!checkKeys(mtype, type & keysFlag, keys))
+                return false;
 
             msg = MessageFactory::create(mtype);
             if (msg.get() == nullptr)
@@ -109,27 +188,221 @@ namespace JsonRpc
                 return false;
             }
 
-            if (!msg->unSerialize(body))
+            BodyCodec codec = bodyCodec(mtype);
+            if (!msg->unSerialize(body, body + bodyLen, codec, keys))
             {
                 E_LOG("消息正文反序列化失败!");
                 return false;
             }
 
             msg->setMtype(mtype);
-            msg->setRid(id);
+            setTextId(msg, id, idLen);
+            if (msg->keepRawBody() && !keys) // 保留原始正文，转发给相同编码的连接时不必重新序列化(引用了键字典的正文不能转发)
+                msg->setRawBody(std::string(body, bodyLen), codec);
+
+            buf->retrieve(totalLenfieldsize + totalLen);
             return true;
         }
 
-        // 序列化
+        // 序列化，在线程局部的缓冲区中编码后取出一次
         virtual std::string serialize(const BaseMessage::s_ptr& msg) override
+        {
+            static thread_local muduo::net::Buffer buffer;
+            static thread_local MuduoBuffer out(&buffer);
+            buffer.retrieveAll();
+            serializeTo(msg, out);
+            return buffer.retrieveAllAsString();
+        }
+
+        // | mtype | idlen | id | body | 依次写入，再在前面回填 len
+        // 未协商压缩时正文直接编码到 out，否则先编码到线程局部的缓冲区，决定是否压缩后再写入
+        virtual void serializeTo(const BaseMessage::s_ptr& msg, BaseBuffer& out, KeyDictionary* keys = nullptr) override
+        {
+            keys = keysFor(msg->mtype(), keys);
+            const char* body = nullptr;
+            size_t bodyLen = 0;
+            bool compressed = _compressor && encodeBody(msg, keys, body, bodyLen);
+
+            int32_t mtype = htonl((int32_t)msg->mtype() | (compressed ? compressFlag : 0) | (keys ? keysFlag : 0));
+            std::string id = textId(msg);
+            int32_t idLen = htonl(id.size());
+            out.append((char*)&mtype, mtypefieldsize);
+            out.append((char*)&idLen, idLenfieldsize);
+            out.append(id.data(), id.size());
+            if (_compressor)
+                out.append(body, bodyLen);
+            else
+                msg->serializeTo(bodyCodec(msg->mtype()), out, keys);
+            out.prependInt32(out.readableSize());
+        }
+
+        // 编码一次，多个连接共享
+        virtual SharedFrame sharedFrame(const BaseMessage::s_ptr& msg, bool forward) override
+        {
+            BodyCodec codec = bodyCodec(msg->mtype());
+            if (forward && !msg->rawBody().empty() && msg->rawCodec() == codec)
+                return std::make_shared<const std::string>(frame(msg, msg->rawBody())); // 原始正文 + 新帧头
+
+            return std::make_shared<const std::string>(serialize(msg));
+        }
+
+        // | len | REQ_TOPIC_BUNDLE | 0 | frame1 | frame2 | ... |
+        virtual SharedFrame bundle(const std::vector<SharedFrame>& frames) override
+        {
+            size_t bodyLen = 0;
+            for (auto& f : frames)
+                bodyLen += f->size();
+
+            int32_t totalLen = htonl(mtypefieldsize + idLenfieldsize + bodyLen);
+            int32_t mtype = htonl((int32_t)MType::REQ_TOPIC_BUNDLE);
+            int32_t idLen = 0;
+
+            auto result = std::make_shared<std::string>();
+            result->reserve(totalLenfieldsize + mtypefieldsize + idLenfieldsize + bodyLen);
+            result->append((char*)&totalLen, totalLenfieldsize);
+            result->append((char*)&mtype, mtypefieldsize);
+            result->append((char*)&idLen, idLenfieldsize);
+            for (auto& f : frames)
+                result->append(*f);
+            return result;
+        }
+
+        // 正文中的帧按普通帧逐个解析，任意一帧不完整或解析失败时返回 false
+        virtual bool unbundle(const BaseMessage::s_ptr& bundle, std::vector<BaseMessage::s_ptr>& msgs) override
+        {
+            const std::string& body = bundle->rawBody();
+            muduo::net::Buffer buffer;
+            buffer.append(body.data(), body.size());
+            BaseBuffer::s_ptr buf = BufferFactory::create(&buffer);
+
+            while (buf->readableSize() > 0)
+            {
+                BaseMessage::s_ptr msg;
+                if (!canProcessed(buf) || !onMessage(buf, msg))
+                {
+                    E_LOG("合并推送帧格式错误!");
+                    return false;
+                }
+                msgs.push_back(msg);
+            }
+            return true;
+        }
+        
+    protected:
+        // 正文编码到线程局部的缓冲区，达到阈值且压缩后更小时换成压缩数据
+        // 返回是否压缩，body、len 指向要写入帧的正文，在当前线程下一次编码前有效
+        bool encodeBody(const BaseMessage::s_ptr& msg, KeyDictionary* keys, const char*& body, size_t& len)
+        {
+            static thread_local muduo::net::Buffer buffer;
+            static thread_local MuduoBuffer out(&buffer);
+            buffer.retrieveAll();
+            msg->serializeTo(bodyCodec(msg->mtype()), out, keys);
+            body = buffer.peek();
+            len = buffer.readableBytes();
+            return msg->mtype() != MType::REQ_CHUNK && packBody(body, len); // 分片的正文是已编码(可能已压缩)的帧，不再压缩
+        }
+
+        bool packBody(const char*& body, size_t& len)
+        {
+            static thread_local std::string packed;
+            if (!_compressor || !_compressor->pack(body, len, _threshold, packed))
+                return false;
+            body = packed.data();
+            len = packed.size();
+            return true;
+        }
+
+        // 解压用的线程局部缓冲区
+        static std::string& rawScratch()
+        {
+            static thread_local std::string raw;
+            return raw;
+        }
+
+        // 一帧解析完成后，释放解压大帧时扩张的缓冲区，不让偶发的大帧一直占用 I/O 线程的内存
+        struct ScratchRelease
+        {
+            ~ScratchRelease()
+            {
+                std::string& raw = rawScratch();
+                if (raw.capacity() > keepScratchSize)
+                    std::string().swap(raw);
+            }
+        };
+
+        // 压缩帧的正文解压到线程局部的缓冲区，body、len 改为指向解压后的数据，在当前帧解析完成前有效
+        // 解压后的长度不能超过连接接收方向的内存上限
+        bool unpackBody(const char*& body, size_t& len)
+        {
+            std::string& raw = rawScratch();
+            if (!_compressor)
+            {
+                E_LOG("连接未协商压缩算法，收到了压缩帧!");
+                return false;
+            }
+            if (!_compressor->unpack(body, len, _max_raw, raw))
+                return false;
+            body = raw.data();
+            len = raw.size();
+            return true;
+        }
+
+        // 网络字节序的 4 byte 整数
+        static int32_t toInt32(const char* data)
+        {
+            int32_t be32 = 0;
+            memcpy(&be32, data, sizeof(be32));
+            return ntohl(be32);
+        }
+
+        // 握手消息在协商完成之前收发，正文固定为 JSON
+        // 键字典只改变键的编码方式，正文仍按二进制解析
+        BodyCodec bodyCodec(MType mtype)
+        {
+            if (mtype == MType::REQ_HANDSHAKE || mtype == MType::RSP_HANDSHAKE)
+                return BodyCodec::CODEC_JSON;
+            if (_codec == BodyCodec::CODEC_BINARY_DICT)
+                return BodyCodec::CODEC_BINARY;
+            return _codec;
+        }
+
+        // 编码时实际使用的键字典: 只有协商了键字典且正文为二进制时使用
+        KeyDictionary* keysFor(MType mtype, KeyDictionary* keys)
+        {
+            if (_codec != BodyCodec::CODEC_BINARY_DICT || bodyCodec(mtype) != BodyCodec::CODEC_BINARY)
+                return nullptr;
+            return keys;
+        }
+
+        // 解码时的键字典: 帧没有置位标志时不使用，置位了但连接没有键字典时报错
+        bool checkKeys(MType mtype, bool keyed, KeyDictionary*& keys)
+        {
+            if (!keyed)
+            {
+                keys = nullptr;
+                return true;
+            }
+            if (!keysFor(mtype, keys))
+            {
+                E_LOG("连接未协商键字典，收到了引用键字典的帧!");
+                return false;
+            }
+            return true;
+        }
+
+        // 按消息的 mtype、rid 生成帧头，拼接正文
+        virtual std::string frame(const BaseMessage::s_ptr& msg, const std::string& body)
         {
             // | len | mtype | idlen | id | body |
-            int32_t mtype = htonl((int32_t)msg->mtype());
-            std::string id = msg->rid();
+            const char* data = body.data();
+            size_t bodyLen = body.size();
+            bool compressed = packBody(data, bodyLen);
+
+            int32_t mtype = htonl((int32_t)msg->mtype() | (compressed ? compressFlag : 0));
+            std::string id = textId(msg);
             int32_t idLen = htonl(id.size());
 
-            std::string body = msg->serialize();
-            int32_t totalLen = mtypefieldsize + idLenfieldsize + id.size() + body.size();
+            int32_t totalLen = mtypefieldsize + idLenfieldsize + id.size() + bodyLen;
 
             std::string result;
             result.reserve(totalLen + totalLenfieldsize);
@@ -138,28 +411,235 @@ namespace JsonRpc
             result.append((char*)&mtype, mtypefieldsize);
             result.append((char*)&idLen, idLenfieldsize);
             result.append(id);
-            result.append(body);
+            result.append(data, bodyLen);
 
             return result;
         }
-        
+
     private:
         static const int32_t totalLenfieldsize = 4;
         static const int32_t mtypefieldsize = 4;
         static const int32_t idLenfieldsize = 4;
+        static const int32_t compressFlag = 0x40000000; // mtype 中的压缩标志
+        static const int32_t keysFlag = 0x20000000;     // mtype 中的键字典标志
+
+        BodyCodec _codec;
+
+    protected:
+        static const size_t keepScratchSize = 256 * 1024; // 解压缓冲区超过该容量时在帧解析完成后释放
+
+        Compressor::s_ptr _compressor; // 未协商压缩时为空
+        size_t _threshold; // 正文达到该长度才压缩
+        size_t _max_raw; // 解压后正文的上限
+    };
+
+    class LVProtocolV2 : public LVProtocol
+    {
+        // | len | mtype | id | body |
+        // len:   varint，之后所有数据的长度
+        // mtype: 1 byte，最高位为 1 时 id 为 varint 整数关联 id，为 0 时 id 为 varint(长度) + 字符串 rid
+        //        次高位为 1 时正文是压缩数据，第三位为 1 时正文引用了连接的键字典
+        // 请求的固定开销从 v1 的 12 byte + 36 byte uuid 降为 3~5 byte，通过握手协商后使用
+        // 同时带有关联 id 和 rid 时只编码关联 id
+
+    public:
+        using s_ptr = std::shared_ptr<LVProtocolV2>;
+
+        LVProtocolV2(BodyCodec codec = BodyCodec::CODEC_JSON, const CompressPolicy& compress = CompressPolicy())
+            : LVProtocol(codec, compress)
+        {}
+
+        // 缓冲区是否可转化为消息
+        virtual bool canProcessed(const BaseBuffer::s_ptr& buf) override
+        {
+            const char* begin = buf->peek();
+            const char* pos = begin;
+            uint64_t len = 0;
+            if (!BinaryCodec::getVarint(pos, begin + std::min(buf->readableSize(), (size_t)maxLenfieldsize), len))
+                return buf->readableSize() >= maxLenfieldsize; // 长度字段非法时交给 onMessage 报错
+
+            return buf->readableSize() - (pos - begin) >= len;
+        }
+
+        // 将缓冲区转化为消息，与 v1 一样在缓冲区上直接解析，成功后才删除这一帧
+        virtual bool onMessage(const BaseBuffer::s_ptr& buf, BaseMessage::s_ptr& msg, KeyDictionary* keys = nullptr) override
+        {
+            const char* begin = buf->peek();
+            const char* pos = begin;
+            uint64_t len = 0;
+            if (!BinaryCodec::getVarint(pos, begin + std::min(buf->readableSize(), (size_t)maxLenfieldsize), len)
+                || len < minFrameLen || len > buf->readableSize() - (pos - begin))
+            {
+                E_LOG("帧长度字段错误!");
+                return false;
+            }
+
+            const char* end = pos + len;
+            uint8_t tag = (uint8_t)*pos++;
+            MType mtype = (MType)(tag & ~(cidFlag | compressFlag | keysFlag));
+            uint64_t cid = 0;
+            uint64_t idLen = 0;
+            const char* id = pos;
+            bool ret = (tag & cidFlag) ? BinaryCodec::getVarint(pos, end, cid)
+                : BinaryCodec::getVarint(pos, end, idLen) && idLen <= (uint64_t)(end - pos);
+            if (!ret)
+            {
+                E_LOG("帧 id 字段错误!");
+                return false;
+            }
+            if (!(tag & cidFlag))
+            {
+                id = pos;
+                pos += idLen;
+            }
+
+            const char* body = pos;
+            size_t bodyLen = end - pos;
+            ScratchRelease release;
+            if ((tag & compressFlag) && !unpackBody(body, bodyLen))
+                return false;
+            if (!checkKeys(mtype, tag & keysFlag, keys))
+                return false;
+
+            msg = MessageFactory::create(mtype);
+            if (msg.get() == nullptr)
+            {
+                E_LOG("消息类型错误，构造消息对象失败!");
+                return false;
+            }
+
+            BodyCodec codec = bodyCodec(mtype);
+            if (!msg->unSerialize(body, body + bodyLen, codec, keys))
+            {
+                E_LOG("消息正文反序列化失败!");
+                return false;
+            }
+
+            msg->setMtype(mtype);
+            if (tag & cidFlag)
+                msg->setCid(cid);
+            else if (idLen > 0)
+                msg->setRid(std::string(id, idLen));
+            if (msg->keepRawBody() && !keys)
+                msg->setRawBody(std::string(body, bodyLen), codec);
+
+            buf->retrieve(end - begin);
+            return true;
+        }
+
+        // | mtype | id | body | 依次写入，再在前面回填 varint 长度(muduo 缓冲区头部预留的 8 byte 足够)
+        virtual void serializeTo(const BaseMessage::s_ptr& msg, BaseBuffer& out, KeyDictionary* keys = nullptr) override
+        {
+            keys = keysFor(msg->mtype(), keys);
+            const char* body = nullptr;
+            size_t bodyLen = 0;
+            bool compressed = _compressor && encodeBody(msg, keys, body, bodyLen);
+
+            appendHeader(msg, (compressed ? compressFlag : 0) | (keys ? keysFlag : 0), out);
+            if (_compressor)
+                out.append(body, bodyLen);
+            else
+                msg->serializeTo(bodyCodec(msg->mtype()), out, keys);
+
+            char len[BinaryCodec::maxVarintSize];
+            out.prepend(len, BinaryCodec::encodeVarint(len, out.readableSize()));
+        }
+
+        // | len | REQ_TOPIC_BUNDLE | 0 | frame1 | frame2 | ... |
+        virtual SharedFrame bundle(const std::vector<SharedFrame>& frames) override
+        {
+            size_t bodyLen = 0;
+            for (auto& f : frames)
+                bodyLen += f->size();
+
+            auto result = std::make_shared<std::string>();
+            result->reserve(maxLenfieldsize + 2 + bodyLen);
+            BinaryCodec::putVarint(*result, 2 + bodyLen);
+            result->push_back((char)MType::REQ_TOPIC_BUNDLE);
+            result->push_back(0); // 空 rid
+            for (auto& f : frames)
+                result->append(*f);
+            return result;
+        }
+
+    protected:
+        virtual std::string frame(const BaseMessage::s_ptr& msg, const std::string& body) override
+        {
+            const char* data = body.data();
+            size_t bodyLen = body.size();
+            bool compressed = packBody(data, bodyLen);
+
+            std::string header;
+            appendHeader(msg, compressed ? compressFlag : 0, header);
+
+            std::string result;
+            result.reserve(maxLenfieldsize + header.size() + bodyLen);
+            BinaryCodec::putVarint(result, header.size() + bodyLen);
+            result.append(header);
+            result.append(data, bodyLen);
+            return result;
+        }
+
+    private:
+        // | mtype | id |，flags: 压缩、键字典标志
+        template <typename Out>
+        static void appendHeader(const BaseMessage::s_ptr& msg, uint8_t flags, Out& out)
+        {
+            uint64_t cid = msg->cid();
+            char tag = (char)((uint8_t)msg->mtype() | (cid != 0 ? cidFlag : 0) | flags);
+            out.append(&tag, 1);
+            if (cid != 0)
+            {
+                BinaryCodec::putVarint(out, cid);
+                return;
+            }
+
+            std::string id = msg->rid();
+            BinaryCodec::putVarint(out, id.size());
+            out.append(id.data(), id.size());
+        }
+
+    private:
+        static const size_t maxLenfieldsize = 5; // 帧长度不超过 32 位
+        static const uint64_t minFrameLen = 2;   // mtype + 空 id
+        static const uint8_t cidFlag = 0x80;
+        static const uint8_t compressFlag = 0x40;
+        static const uint8_t keysFlag = 0x20;
     };
 
     class ProtocolFactory
     {
     public:
-        template <typename ...Args>
-        static BaseProtocol::s_ptr create(Args&& ...args)
+        // 按正文编码选择协议: JSON、二进制使用 LVProtocol/LVProtocolV2，protobuf 使用 ProtobufProtocol(忽略帧头版本和压缩)
+        static BaseProtocol::s_ptr create(BodyCodec codec = BodyCodec::CODEC_JSON, FrameVersion frame = FrameVersion::FRAME_V1,
+            const CompressPolicy& compress = CompressPolicy())
         {
-            return std::make_shared<LVProtocol>(std::forward<Args>(args)...);
+            if (codec == BodyCodec::CODEC_PROTOBUF)
+            {
+#ifdef JSONRPC_WITH_PROTOBUF
+                return std::make_shared<ProtobufProtocol>();
+#else
+                E_LOG("未启用 protobuf 协议(JSONRPC_WITH_PROTOBUF)，使用 JSON!");
+                codec = BodyCodec::CODEC_JSON;
+#endif
+            }
+            if (frame == FrameVersion::FRAME_V2)
+                return std::make_shared<LVProtocolV2>(codec, compress);
+            return std::make_shared<LVProtocol>(codec, compress);
+        }
+
+        // 当前编译支持的编码
+        static bool supported(BodyCodec codec)
+        {
+#ifdef JSONRPC_WITH_PROTOBUF
+            if (codec == BodyCodec::CODEC_PROTOBUF)
+                return true;
+#endif
+            return codec == BodyCodec::CODEC_JSON || codec == BodyCodec::CODEC_BINARY || codec == BodyCodec::CODEC_BINARY_DICT;
         }
     };
 
-    class MuduoConnection : public BaseConnection
+    class MuduoConnection : public BaseConnection, public std::enable_shared_from_this<MuduoConnection>
     {
     public:
         using s_ptr = std::shared_ptr<MuduoConnection>;
@@ -167,12 +647,152 @@ namespace JsonRpc
         MuduoConnection(muduo::net::TcpConnectionPtr conn, BaseProtocol::s_ptr proto)
             : _proto(proto)
             , _conn(conn)
+            , _input(BufferFactory::create(conn->inputBuffer()))
+            , _chunk_size(0)
+            , _next_stream(0)
+            , _stream_bytes(0)
+            , _shared_active(false)
+            , _congested(false)
+            , _cid(0)
         {}
 
+        // 包装连接输入缓冲区，连接建立时创建一次，消息到达时不再为每次回调分配
+        const BaseBuffer::s_ptr& input()
+        {
+            return _input;
+        }
+
+        // 接收方向的键字典，只在 I/O 线程中解析消息时使用
+        KeyDictionary* receiveKeys()
+        {
+            return &_receive_keys;
+        }
+
+        // 协商的分片长度，0 表示不分片，握手后由网络层在 I/O 线程中设置
+        void setChunkSize(size_t size)
+        {
+            _chunk_size.store(size, std::memory_order_relaxed);
+        }
+
+        // 连接接收方向占用的内存: 输入缓冲区中未解析的数据 + 拼接中的分片 (I/O 线程)
+        size_t inputBytes()
+        {
+            return _input->readableSize() + _stream_bytes;
+        }
+
+        // 拼接收到的分片 (I/O 线程)
+        // 收齐最后一片时按连接的协议解析出完整的消息放入 msg，否则 msg 为空
+        // 分片或拼接出的帧格式错误、连接占用的内存超过 limit 时返回 false
+        bool onChunk(const BaseProtocol::s_ptr& proto, const BaseMessage::s_ptr& chunk, BaseMessage::s_ptr& msg, size_t limit)
+        {
+            uint64_t stream = 0;
+            bool last = false;
+            const char* data = nullptr;
+            size_t len = 0;
+            msg.reset();
+            if (!std::static_pointer_cast<ChunkMessage>(chunk)->chunk(stream, last, data, len))
+            {
+                E_LOG("分片格式错误!");
+                return false;
+            }
+
+            auto it = _in_streams.find(stream);
+            if (it == _in_streams.end())
+            {
+                // 空的非末尾分片不占数据，却会新增一个流，不拒绝时对端可以无限增加拼接中的流
+                if (!last && len == 0)
+                {
+                    E_LOG("收到空的非末尾分片!");
+                    return false;
+                }
+                if (_in_streams.size() >= maxOpenStreams)
+                {
+                    E_LOG("拼接中的流超过上限: %zu!", maxOpenStreams);
+                    return false;
+                }
+                it = _in_streams.emplace(stream, muduo::net::Buffer()).first;
+                _stream_bytes += streamOverhead;
+            }
+
+            muduo::net::Buffer& frame = it->second;
+            frame.append(data, len);
+            _stream_bytes += len;
+            if (inputBytes() > limit)
+            {
+                E_LOG("连接占用的内存超过上限: %zu bytes!", inputBytes());
+                return false;
+            }
+            if (!last)
+                return true;
+
+            muduo::net::Buffer buffer;
+            buffer.swap(frame);
+            _in_streams.erase(it);
+            _stream_bytes -= buffer.readableBytes() + streamOverhead;
+
+            // 分片发送的帧不引用键字典(见 sendFrame)
+            BaseBuffer::s_ptr buf = BufferFactory::create(&buffer);
+            if (!proto->canProcessed(buf) || !proto->onMessage(buf, msg) || buf->readableSize() != 0
+                || msg->mtype() == MType::REQ_CHUNK || msg->mtype() == MType::REQ_HANDSHAKE || msg->mtype() == MType::RSP_HANDSHAKE)
+            {
+                E_LOG("分片拼接出的帧格式错误!");
+                return false;
+            }
+            return true;
+        }
+
         // 发送消息
+        // 帧直接编码到线程局部的缓冲区，不生成中间的 string
+        // 在 I/O 线程中 TcpConnection 直接从该缓冲区写 socket，写不完的部分才拷贝进输出缓冲区
+        // 在其它线程中 TcpConnection 取出一份拷贝投递到 I/O 线程
+        // 协商了键字典时，字典的更新顺序必须与帧的发送顺序一致，编码和发送都放到 I/O 线程中执行
         virtual void send(const BaseMessage::s_ptr& msg) override
         {
-            _conn->send(_proto->serialize(msg));
+            BaseProtocol::s_ptr proto = protocol();
+            if (proto->codec() != BodyCodec::CODEC_BINARY_DICT)
+            {
+                sendFrame(proto, msg, nullptr);
+                return;
+            }
+
+            std::shared_ptr<MuduoConnection> self = shared_from_this();
+            runInLoop([self, proto, msg]() { self->sendFrame(proto, msg, &self->_send_keys); });
+        }
+
+        // 发送共享帧(推送、转发、合并推送)
+        // 跨线程时 TcpConnection::send 会先拷贝一份数据，这里改为把帧的引用投递到 I/O 线程，只在写入输出缓冲区时拷贝一次
+        // 超过分片长度的帧同样分片发送；共享帧之间必须保持顺序(同一主题的推送按序号到达)，见 sendShared
+        virtual void send(const SharedFrame& frame) override
+        {
+            size_t chunk_size = _chunk_size.load(std::memory_order_relaxed);
+            if (chunk_size == 0)
+            {
+                muduo::net::TcpConnectionPtr conn = _conn;
+                _conn->getLoop()->runInLoop([conn, frame]() {
+                    conn->send(frame->data(), frame->size());
+                });
+                return;
+            }
+
+            std::shared_ptr<MuduoConnection> self = shared_from_this();
+            runInLoop([self, frame]() { self->sendShared(frame); });
+        }
+
+        // 握手后协议会被替换，其他线程(推送、可靠订阅)可能同时读取
+        virtual BaseProtocol::s_ptr protocol() override
+        {
+            return std::atomic_load(&_proto);
+        }
+
+        virtual void setProtocol(const BaseProtocol::s_ptr& proto) override
+        {
+            std::atomic_store(&_proto, proto);
+        }
+
+        // 握手请求的关联 id，其余请求的关联 id 由 Requestor 分配
+        uint64_t nextCid()
+        {
+            return _cid.fetch_add(1, std::memory_order_relaxed) + 1;
         }
 
         // 关闭连接
@@ -181,15 +801,224 @@ namespace JsonRpc
             _conn->shutdown();
         }
 
+        // 强制关闭连接
+        virtual void forceClose() override
+        {
+            _conn->forceClose();
+        }
+
         // 检查连接
         virtual bool connected() override
         {
             return _conn->connected();
         }
 
+        // 输出缓冲区是否积压
+        virtual bool congested() override
+        {
+            return _congested.load(std::memory_order_relaxed);
+        }
+
+        // 回调只在 I/O 线程中读写，这里投递过去设置
+        virtual void setDrainCallback(const std::function<void()>& cb) override
+        {
+            std::shared_ptr<MuduoConnection> self = shared_from_this();
+            runInLoop([self, cb]() { self->_cb_drain = cb; });
+        }
+
+        // 输出缓冲区超过高水位 (I/O 线程)
+        void onHighWaterMark()
+        {
+            _congested.store(true, std::memory_order_relaxed);
+        }
+
+        // 输出缓冲区写空 (I/O 线程)
+        // 共享帧分片发送期间保持积压状态，发送完成后才通知写空
+        void onWriteComplete()
+        {
+            sendChunks();
+            if (!_congested.load(std::memory_order_relaxed) || _shared_active || !_shared_queue.empty())
+                return;
+
+            _congested.store(false, std::memory_order_relaxed);
+            if (_cb_drain) _cb_drain();
+        }
+
+        // 在连接所属的 I/O 线程中执行任务
+        virtual void runInLoop(const std::function<void()>& task) override
+        {
+            _conn->getLoop()->runInLoop(task);
+        }
+
+        virtual void runAfter(double delay, const std::function<void()>& task) override
+        {
+            _conn->getLoop()->runAfter(delay, task);
+        }
+
+        virtual void queueInLoop(const std::function<void()>& task) override
+        {
+            _conn->getLoop()->queueInLoop(task);
+        }
+
+    private:
+        // 待分片发送的帧，只在 I/O 线程中访问
+        struct OutStream
+        {
+            using s_ptr = std::shared_ptr<OutStream>;
+
+            uint64_t id;       // 流编号
+            std::string rid;   // 被切分的消息的 id，每个分片都带上，共享帧为空
+            uint64_t cid;
+            SharedFrame frame; // 完整的帧
+            size_t offset;     // 已发送的长度
+            bool shared;       // 共享帧，与其它共享帧保持顺序
+        };
+
+        // 编码到线程局部的缓冲区，在当前线程下一次编码前有效
+        static muduo::net::Buffer& encode(const BaseProtocol::s_ptr& proto, const BaseMessage::s_ptr& msg, KeyDictionary* keys)
+        {
+            static thread_local muduo::net::Buffer buffer;
+            static thread_local MuduoBuffer out(&buffer);
+            buffer.retrieveAll();
+            proto->serializeTo(msg, out, keys);
+            return buffer;
+        }
+
+        // 编码并发送，超过分片长度的帧交给 I/O 线程分片发送
+        void sendFrame(const BaseProtocol::s_ptr& proto, const BaseMessage::s_ptr& msg, KeyDictionary* keys)
+        {
+            size_t mark = keys ? keys->size() : 0;
+            muduo::net::Buffer* buffer = &encode(proto, msg, keys);
+            size_t chunk_size = _chunk_size.load(std::memory_order_relaxed);
+            if (chunk_size == 0 || buffer->readableBytes() <= chunk_size)
+            {
+                _conn->send(buffer);
+                return;
+            }
+
+            // 分片期间后发的小消息可能先到达对端，不能引用只在这一帧中出现的键: 撤销字典的更新，不使用字典重新编码
+            if (keys)
+            {
+                keys->truncate(mark);
+                buffer = &encode(proto, msg, nullptr);
+            }
+
+            auto stream = std::make_shared<OutStream>();
+            stream->rid = msg->rid();
+            stream->cid = msg->cid();
+            stream->frame = std::make_shared<const std::string>(buffer->retrieveAllAsString());
+            stream->offset = 0;
+            stream->shared = false;
+            std::shared_ptr<MuduoConnection> self = shared_from_this();
+            runInLoop([self, stream]() {
+                stream->id = ++self->_next_stream;
+                self->_wait_streams.push_back(stream);
+                self->sendChunks();
+            });
+        }
+
+        // 发送共享帧 (I/O 线程)
+        // 共享帧按到达顺序逐个发送: 同一时刻最多一个共享帧在分片发送，之后到达的共享帧(无论大小)排队等它发完
+        // 分片期间把连接标记为积压，订阅者的新推送先进入自己的投递队列(按主题的慢消费者策略处理)，发送完成后再补发
+        // 普通消息(RPC 请求与响应)不受影响，与正在发送的分片轮流发送
+        void sendShared(const SharedFrame& frame)
+        {
+            size_t chunk_size = _chunk_size.load(std::memory_order_relaxed);
+            if (!_shared_active && _shared_queue.empty() && (chunk_size == 0 || frame->size() <= chunk_size))
+            {
+                _conn->send(frame->data(), frame->size());
+                return;
+            }
+
+            auto stream = std::make_shared<OutStream>();
+            stream->cid = 0;
+            stream->frame = frame;
+            stream->offset = 0;
+            stream->shared = true;
+            _shared_queue.push_back(stream);
+            pumpShared();
+            sendChunks();
+        }
+
+        // 依次取出排队的共享帧: 不超过分片长度的直接发送，遇到大帧时开始分片发送并停止 (I/O 线程)
+        void pumpShared()
+        {
+            size_t chunk_size = _chunk_size.load(std::memory_order_relaxed);
+            while (!_shared_active && !_shared_queue.empty())
+            {
+                OutStream::s_ptr stream = _shared_queue.front();
+                _shared_queue.pop_front();
+                if (chunk_size == 0 || stream->frame->size() <= chunk_size)
+                {
+                    _conn->send(stream->frame->data(), stream->frame->size());
+                    continue;
+                }
+
+                stream->id = ++_next_stream;
+                _shared_active = true;
+                _congested.store(true, std::memory_order_relaxed);
+                _wait_streams.push_back(stream);
+            }
+        }
+
+        // 发送下一个分片 (I/O 线程)
+        // 输出缓冲区中的数据少于一个分片时才发送，之后在写空回调中继续，多个流轮流发送
+        // 其它消息不必等整个大消息发完，最多排在一个分片之后
+        // 同时发送的流不超过 maxOpenStreams，其余的流排队，等前面的流发完再开始
+        void sendChunks()
+        {
+            while (_out_streams.size() < maxOpenStreams && !_wait_streams.empty())
+            {
+                _out_streams.push_back(_wait_streams.front());
+                _wait_streams.pop_front();
+            }
+
+            size_t chunk_size = _chunk_size.load(std::memory_order_relaxed);
+            if (_out_streams.empty() || _conn->outputBuffer()->readableBytes() >= chunk_size)
+                return;
+
+            OutStream::s_ptr stream = _out_streams.front();
+            _out_streams.pop_front();
+            size_t len = std::min(chunk_size, stream->frame->size() - stream->offset);
+            bool last = stream->offset + len == stream->frame->size();
+
+            auto chunk = MessageFactory::create<ChunkMessage>();
+            chunk->setMtype(MType::REQ_CHUNK);
+            chunk->setRid(stream->rid);
+            chunk->setCid(stream->cid);
+            chunk->setChunk(stream->id, last, stream->frame->data() + stream->offset, len);
+            stream->offset += len;
+            if (!last)
+                _out_streams.push_back(stream);
+
+            _conn->send(&encode(protocol(), chunk, nullptr));
+            if (last && stream->shared) // 共享帧发送完成，继续发送排在它后面的共享帧
+            {
+                _shared_active = false;
+                pumpShared();
+            }
+        }
+
     private:
+        static const size_t maxOpenStreams = 16; // 每个方向同时拼接(发送)中的流的上限
+        static const size_t streamOverhead = 256; // 每个拼接中的流按该长度额外计入内存占用
+
         BaseProtocol::s_ptr _proto;
         muduo::net::TcpConnectionPtr _conn;
+        BaseBuffer::s_ptr _input; // 只在 I/O 线程中使用
+        KeyDictionary _send_keys; // 协商了键字典时使用，只在 I/O 线程中使用
+        KeyDictionary _receive_keys;
+        std::atomic<size_t> _chunk_size; // 协商的分片长度，0 表示不分片
+        std::deque<OutStream::s_ptr> _out_streams; // 正在分片发送的帧，只在 I/O 线程中使用
+        std::deque<OutStream::s_ptr> _wait_streams; // 等待开始分片发送的帧，只在 I/O 线程中使用
+        std::deque<OutStream::s_ptr> _shared_queue; // 排在分片发送中的共享帧之后的共享帧，只在 I/O 线程中使用
+        uint64_t _next_stream; // 最近分配的流编号
+        std::unordered_map<uint64_t, muduo::net::Buffer> _in_streams; // 流编号 -> 拼接中的帧，只在 I/O 线程中使用
+        size_t _stream_bytes; // _in_streams 中的数据总长度，每个流另计 streamOverhead
+        bool _shared_active; // 有共享帧正在分片发送，只在 I/O 线程中使用
+        std::atomic<bool> _congested; // 高水位或共享帧分片发送时置位，写空且共享帧发送完成时清除
+        std::function<void()> _cb_drain;
+        std::atomic<uint64_t> _cid; // 最近分配的握手关联 id
     };
 
     class ConnectionFactory
@@ -209,30 +1038,57 @@ namespace JsonRpc
     public:
         using s_ptr = std::shared_ptr<MuduoServer>;
 
-        MuduoServer(int32_t port)
-            : _server(&_baseloop, muduo::net::InetAddress("0.0.0.0", port), 
+        // thread_num: I/O 线程数量
+        //   0: 单 reactor，监听和所有连接的读写都在 _baseloop 中
+        //   N: 主从 reactor，_baseloop 只负责 accept，新连接轮询分配到 N 个 I/O 线程(EventLoopThreadPool)
+        MuduoServer(int32_t port, int thread_num = 0)
+            : _proto(ProtocolFactory::create())
+            , _server(&_baseloop, muduo::net::InetAddress("0.0.0.0", port), 
                     "MuduoServer", muduo::net::TcpServer::kReusePort)
-            , _proto(ProtocolFactory::create())
         {
+            _protos[protoKey(BodyCodec::CODEC_JSON, FrameVersion::FRAME_V1, CompressType::COMPRESS_NONE)] = _proto;
+
+            _server.setThreadNum(thread_num);
             // 触发连接回调
             _server.setConnectionCallback(std::bind(&MuduoServer::onConnection, this, std::placeholders::_1));
             // 触发消息回调
             _server.setMessageCallback(std::bind(&MuduoServer::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+            // 输出缓冲区写空回调
+            _server.setWriteCompleteCallback(std::bind(&MuduoServer::onWriteComplete, this, std::placeholders::_1));
         }
 
+        // 回调函数需要在 start 之前设置，start 之后会被多个 I/O 线程并发调用
         virtual void start() override
         {
-            _server.start();
+            _server.start(); // 启动 I/O 线程池，开始监听
             _baseloop.loop();
         }
 
+        // 线程安全，退出 _baseloop 后 start 返回
+        // 析构时 TcpServer 会在各自的 I/O 线程中关闭剩余连接，再回收线程池
+        virtual void stop() override
+        {
+            _baseloop.quit();
+        }
+
+        // 当前连接数量
+        size_t connectionCount()
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            return _conns.size();
+        }
+
     private:
+        // 同一个连接的建立、消息、断开回调总是在该连接所属的 I/O 线程中串行执行
         void onConnection(const muduo::net::TcpConnectionPtr& conn)
         {
             if (conn->connected())
             {
                 I_LOG("连接建立成功!");
                 BaseConnection::s_ptr muduo_conn = ConnectionFactory::create(conn, _proto);
+                conn->setContext(muduo_conn); // 消息到达时直接从连接上下文取出，不再查全局表
+                conn->setHighWaterMarkCallback(std::bind(&MuduoServer::onHighWaterMark, this, 
+                    std::placeholders::_1, std::placeholders::_2), _high_water_mark);
                 {
                     std::unique_lock<std::mutex> lock(_mtx);
                     _conns[conn] = muduo_conn;
@@ -248,43 +1104,61 @@ namespace JsonRpc
                     auto it = _conns.find(conn);
                     if (it == _conns.end()) return;
                     muduo_conn = it->second;
-                    _conns.erase(conn);
+                    _conns.erase(it);
                 }
+                conn->setContext(boost::any()); // 打破 TcpConnection 与 MuduoConnection 的循环引用
                 if (_cb_close) _cb_close(muduo_conn);
             }
         }
 
+        // 从连接上下文中取出 MuduoConnection
+        static std::shared_ptr<MuduoConnection> context(const muduo::net::TcpConnectionPtr& conn)
+        {
+            const BaseConnection::s_ptr* ctx = boost::any_cast<BaseConnection::s_ptr>(&conn->getContext());
+            return ctx ? std::static_pointer_cast<MuduoConnection>(*ctx) : std::shared_ptr<MuduoConnection>();
+        }
+
+        void onHighWaterMark(const muduo::net::TcpConnectionPtr& conn, size_t len)
+        {
+            I_LOG("连接输出缓冲区积压: %zu bytes!", len);
+            auto muduo_conn = context(conn);
+            if (muduo_conn) muduo_conn->onHighWaterMark();
+        }
+
+        void onWriteComplete(const muduo::net::TcpConnectionPtr& conn)
+        {
+            auto muduo_conn = context(conn);
+            if (muduo_conn) muduo_conn->onWriteComplete();
+        }
+
         void onMessage(const muduo::net::TcpConnectionPtr& conn, muduo::net::Buffer* buffer, muduo::Timestamp)
         {
-            BaseBuffer::s_ptr base_buf = BufferFactory::create(buffer);
-            BaseConnection::s_ptr base_conn;
+            std::shared_ptr<MuduoConnection> muduo_conn = context(conn);
+            if (!muduo_conn)
             {
-                std::unique_lock<std::mutex> lock(_mtx);
-                auto it = _conns.find(conn);
-                if (it == _conns.end())
-                {
-                    E_LOG("服务不存在!");
-                    conn->shutdown();
-                    return;
-                }
-                base_conn = it->second;
+                E_LOG("连接不存在!");
+                conn->shutdown();
+                return;
             }
+            BaseConnection::s_ptr base_conn = muduo_conn;
+            const BaseBuffer::s_ptr& base_buf = muduo_conn->input(); // 包装的就是 buffer
 
-            // 循环处理消息
+            // 循环处理消息，握手后同一缓冲区中的后续消息按新的编码解析
             while (true)
             {
-                if (!_proto->canProcessed(base_buf))
+                BaseProtocol::s_ptr proto = base_conn->protocol();
+                if (!proto->canProcessed(base_buf))
                 {
-                    if (base_buf->readableSize() > _maxBufferSize)
+                    if (muduo_conn->inputBytes() > _connection_memory_limit)
                     {
-                        E_LOG("数据载荷过大!");
+                        E_LOG("连接占用的内存超过上限: %zu bytes!", muduo_conn->inputBytes());
                         conn->shutdown();
                     }
                     break;
                 }
 
                 BaseMessage::s_ptr base_msg;
-                bool ret = _proto->onMessage(base_buf, base_msg);
+                bool ret = proto->onMessage(base_buf, base_msg, muduo_conn->receiveKeys());
                 if (!ret)
                 {
                     conn->shutdown();
@@ -292,18 +1166,118 @@ namespace JsonRpc
                     break;
                 }
 
+                if (base_msg->mtype() == MType::REQ_HANDSHAKE)
+                {
+                    onHandshake(base_conn, base_msg);
+                    continue;
+                }
+
+                if (base_msg->mtype() == MType::REQ_CHUNK)
+                {
+                    BaseMessage::s_ptr chunk = base_msg;
+                    if (!muduo_conn->onChunk(proto, chunk, base_msg, _connection_memory_limit))
+                    {
+                        conn->shutdown();
+                        break;
+                    }
+                    if (!base_msg) // 还没有收齐
+                        continue;
+                }
+
                 if (_cb_message) _cb_message(base_conn, base_msg);
             }
         }
 
+        static int protoKey(BodyCodec codec, FrameVersion frame, CompressType compress)
+        {
+            return (int)codec << 16 | (int)compress << 8 | (int)frame;
+        }
+
+        // 每种协商结果一个协议对象，在第一次协商出时创建，结果相同的连接共享，推送时只编码一次
+        BaseProtocol::s_ptr protocol(BodyCodec codec, FrameVersion frame, CompressType compress)
+        {
+            std::unique_lock<std::mutex> lock(_protos_mtx);
+            BaseProtocol::s_ptr& proto = _protos[protoKey(codec, frame, compress)];
+            if (!proto)
+            {
+                CompressPolicy policy;
+                policy.type = compress;
+                policy.threshold = _compress_threshold;
+                policy.max_raw = _connection_memory_limit;
+                proto = ProtocolFactory::create(codec, frame, policy);
+            }
+            return proto;
+        }
+
+        // 选出客户端列表中第一个支持的编码、压缩算法和双方都支持的最高帧头版本，先按 v1 + JSON 回复，再切换连接的协议
+        // 分片长度取双方中较小的值
+        // 未握手的连接(旧版本客户端)一直使用 v1 + JSON，不压缩，不分片
+        // protobuf 协议有自己的帧格式，不使用帧头版本、压缩和分片
+        void onHandshake(const BaseConnection::s_ptr& conn, const BaseMessage::s_ptr& msg)
+        {
+            auto req = std::static_pointer_cast<HandshakeRequest>(msg);
+            auto rsp = MessageFactory::create<HandshakeResponse>();
+            rsp->setMtype(MType::RSP_HANDSHAKE);
+            rsp->setRid(req->rid());
+            rsp->setCid(req->cid());
+
+            BodyCodec codec = BodyCodec::CODEC_JSON;
+            FrameVersion frame = FrameVersion::FRAME_V1;
+            CompressType compress = CompressType::COMPRESS_NONE;
+            size_t chunk = 0;
+            if (!req->check())
+            {
+                rsp->setRcode(RetCode::RCODE_INVALID_MSG);
+            }
+            else
+            {
+                rsp->setRcode(RetCode::RCODE_OK);
+                for (auto c : req->codecs())
+                {
+                    if (ProtocolFactory::supported(c))
+                    {
+                        codec = c;
+                        break;
+                    }
+                }
+                if (codec != BodyCodec::CODEC_PROTOBUF)
+                {
+                    if (req->frameVersion() >= FrameVersion::FRAME_V2)
+                        frame = FrameVersion::FRAME_V2;
+                    for (auto c : req->compresses())
+                    {
+                        if (CompressorFactory::supported(c))
+                        {
+                            compress = c;
+                            break;
+                        }
+                    }
+                    chunk = std::min(req->chunkSize(), _chunk_size);
+                }
+            }
+            rsp->setCodec(codec);
+            rsp->setFrameVersion(frame);
+            rsp->setCompress(compress);
+            rsp->setChunkSize(chunk);
+
+            conn->send(rsp);
+            conn->setProtocol(protocol(codec, frame, compress));
+            std::static_pointer_cast<MuduoConnection>(conn)->setChunkSize(chunk);
+            I_LOG("连接协商正文编码: %d, 帧头版本: %d, 压缩算法: %d, 分片长度: %zu", (int)codec, (int)frame, (int)compress, chunk);
+        }
+
     private:
-        static const int _maxBufferSize = (1 << 16);
-        muduo::net::TcpServer _server;
+        // 成员按依赖顺序声明: _server 最后构造、最先析构
+        // 析构时 TcpServer 会回调 onConnection 关闭剩余连接，此时其余成员仍然有效
         muduo::net::EventLoop _baseloop;
-        BaseProtocol::s_ptr _proto;
+        BaseProtocol::s_ptr _proto; // JSON 正文，新连接默认使用
+        std::mutex _protos_mtx; // 保护 _protos，只在握手时加锁
+        std::unordered_map<int, BaseProtocol::s_ptr> _protos; // protoKey(编码, 帧头版本, 压缩算法) -> 协议
 
-        std::mutex _mtx;
+        std::mutex _mtx; // 保护 _conns，只在连接建立/断开时加锁
         std::unordered_map<muduo::net::TcpConnectionPtr, BaseConnection::s_ptr> _conns;
+
+        muduo::net::TcpServer _server;
     };
 
     class ServerFactory
@@ -322,8 +1296,18 @@ namespace JsonRpc
     public:
         using s_ptr = std::shared_ptr<MuduoClient>;
 
-        MuduoClient(const std::string& ip, int32_t port)
+        // codec、frame、compress: 连接建立后通过握手协商的正文编码、帧头版本和压缩算法
+        // JSON + v1 + 不压缩时不握手，可以连接旧版本的服务端，也不分片
+        MuduoClient(const std::string& ip, int32_t port, BodyCodec codec = BodyCodec::CODEC_JSON,
+            FrameVersion frame = FrameVersion::FRAME_V1, const CompressPolicy& compress = CompressPolicy())
             : _proto(ProtocolFactory::create())
+            , _codec(codec)
+            , _frame(frame)
+            , _compress(compress)
+            , _chunk_size(64 * 1024)
+            , _memory_limit(16 * 1024 * 1024)
+            , _handshaked(false)
+            , _handshake_waiting(false)
             , _loop(_loopthread.startLoop())
             , _downLatch(1)
             , _client(_loop, muduo::net::InetAddress(ip, port), "MuduoClient")
@@ -332,6 +1316,20 @@ namespace JsonRpc
 
             _client.setMessageCallback(std::bind(&MuduoClient::onMessage, this, 
                 std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+
+            _client.setWriteCompleteCallback(std::bind(&MuduoClient::onWriteComplete, this, std::placeholders::_1));
+        }
+
+        // 握手时请求的分片长度，0 表示不分片，需要在 connect 之前设置
+        void setChunkSize(size_t bytes)
+        {
+            _chunk_size = bytes;
+        }
+
+        // 连接接收方向占用内存的上限(未收完的帧 + 拼接中的分片)，超过后关闭连接，需要在 connect 之前设置
+        void setMemoryLimit(size_t bytes)
+        {
+            _memory_limit = bytes;
         }
 
         // 连接服务端
@@ -339,6 +1337,20 @@ namespace JsonRpc
         {
             _client.connect();
             _downLatch.wait();
+            if (!ProtocolFactory::supported(_codec))
+            {
+                E_LOG("不支持的正文编码 %d，使用 JSON!", (int)_codec);
+                _codec = BodyCodec::CODEC_JSON;
+            }
+            if (!CompressorFactory::supported(_compress.type))
+            {
+                E_LOG("不支持的压缩算法 %d，不压缩!", (int)_compress.type);
+                _compress.type = CompressType::COMPRESS_NONE;
+            }
+            if (_codec == BodyCodec::CODEC_JSON && _frame == FrameVersion::FRAME_V1
+                && _compress.type == CompressType::COMPRESS_NONE)
+                return;
+            handshake();
         }
 
         // 关闭连接
@@ -371,14 +1383,74 @@ namespace JsonRpc
         }
 
     private:
+        // 发送握手请求并等待响应，响应在 I/O 线程中处理，收到后连接已切换为协商的编码
+        // 旧版本的服务端不认识握手消息，会关闭连接
+        // 超时后服务端可能已经切换了协议，两端无法再按同一种格式解析，关闭连接按连接失败处理，之后到达的响应被忽略
+        void handshake()
+        {
+            auto req = MessageFactory::create<HandshakeRequest>();
+            req->setMtype(MType::REQ_HANDSHAKE);
+            req->setCid(std::static_pointer_cast<MuduoConnection>(_conn)->nextCid());
+            if (_codec == BodyCodec::CODEC_BINARY_DICT) // 服务端不支持键字典时退回普通二进制
+                req->setCodecs({_codec, BodyCodec::CODEC_BINARY, BodyCodec::CODEC_JSON});
+            else
+                req->setCodecs({_codec, BodyCodec::CODEC_JSON});
+            req->setFrameVersion(_frame);
+            if (_compress.type != CompressType::COMPRESS_NONE)
+                req->setCompresses({_compress.type});
+            req->setChunkSize(_chunk_size);
+
+            std::unique_lock<std::mutex> lock(_mtx);
+            _handshaked = false;
+            _handshake_waiting = true;
+            if (!send(req))
+            {
+                _handshake_waiting = false;
+                return;
+            }
+
+            if (!_cond.wait_for(lock, std::chrono::seconds(3), [this]() { return _handshaked; }))
+            {
+                _handshake_waiting = false;
+                E_LOG("正文编码握手超时，关闭连接!");
+                _conn->forceClose();
+            }
+        }
+
+        void onHandshake(const BaseMessage::s_ptr& msg)
+        {
+            auto rsp = std::static_pointer_cast<HandshakeResponse>(msg);
+            std::unique_lock<std::mutex> lock(_mtx);
+            if (!_handshake_waiting) // 超时之后到达的响应，连接已关闭，不能再切换协议
+            {
+                E_LOG("握手响应在超时之后到达，忽略!");
+                return;
+            }
+
+            if (rsp->check() && rsp->rcode() == RetCode::RCODE_OK)
+            {
+                CompressPolicy compress = _compress; // 使用本端的阈值
+                compress.type = rsp->compress();
+                compress.max_raw = _memory_limit;
+                _conn->setProtocol(ProtocolFactory::create(rsp->codec(), rsp->frameVersion(), compress));
+                std::static_pointer_cast<MuduoConnection>(_conn)->setChunkSize(rsp->chunkSize());
+                I_LOG("连接协商正文编码: %d, 帧头版本: %d, 压缩算法: %d, 分片长度: %zu",
+                    (int)rsp->codec(), (int)rsp->frameVersion(), (int)compress.type, rsp->chunkSize());
+            }
+
+            _handshake_waiting = false;
+            _handshaked = true;
+            _cond.notify_all();
+        }
+
         //连接处理函数  
         void onConnection(const muduo::net::TcpConnectionPtr& conn)
         {
             if (conn->connected())
             {
                 I_LOG("建立连接成功");
-                _downLatch.countDown(); // 计数自减,此时变为0,不再阻塞
                 _conn = ConnectionFactory::create(conn, _proto);
+                _downLatch.countDown(); // 计数自减,此时变为0,不再阻塞，之后 connect 可以直接使用 _conn
             }
             else
             {
@@ -387,17 +1459,26 @@ namespace JsonRpc
             }
         }
 
+        // 输出缓冲区写空，继续发送分片
+        void onWriteComplete(const muduo::net::TcpConnectionPtr& conn)
+        {
+            if (_conn)
+                std::static_pointer_cast<MuduoConnection>(_conn)->onWriteComplete();
+        }
+
         // 消息处理函数
         void onMessage(const muduo::net::TcpConnectionPtr& conn, muduo::net::Buffer* buf, muduo::Timestamp)
         {
-            BaseBuffer::s_ptr base_buf = BufferFactory::create(buf);
+            auto muduo_conn = std::static_pointer_cast<MuduoConnection>(_conn);
+            const BaseBuffer::s_ptr& base_buf = muduo_conn->input(); // 包装的就是 buf
             while (true)
             {
-                if (!_proto->canProcessed(base_buf))
+                BaseProtocol::s_ptr proto = _conn->protocol();
+                if (!proto->canProcessed(base_buf))
                 {
-                    if (base_buf->readableSize() > _maxBufferSize)
+                    if (muduo_conn->inputBytes() > _memory_limit)
                     {
-                        E_LOG("数据载荷过大!");
+                        E_LOG("连接占用的内存超过上限: %zu bytes!", muduo_conn->inputBytes());
                         conn->shutdown();
                     }
                     I_LOG("数据量不足,当前 %ld", base_buf->readableSize());
@@ -405,21 +1486,44 @@ namespace JsonRpc
                 }
 
                 BaseMessage::s_ptr msg;
-                bool ret = _proto->onMessage(base_buf, msg);
+                bool ret = proto->onMessage(base_buf, msg, muduo_conn->receiveKeys());
                 if (!ret)
                 {
                     conn->shutdown();
                     E_LOG("缓冲区数据错误!");
                     break;
                 }
+                if (msg->mtype() == MType::RSP_HANDSHAKE)
+                {
+                    onHandshake(msg);
+                    continue;
+                }
+                if (msg->mtype() == MType::REQ_CHUNK)
+                {
+                    BaseMessage::s_ptr chunk = msg;
+                    if (!muduo_conn->onChunk(proto, chunk, msg, _memory_limit))
+                    {
+                        conn->shutdown();
+                        break;
+                    }
+                    if (!msg) // 还没有收齐
+                        continue;
+                }
                 if (_cb_message) _cb_message(_conn, msg);
             }
         }
 
     private:
-        static const int _maxBufferSize = (1 << 16);
-
         BaseProtocol::s_ptr _proto;
+        BodyCodec _codec; // 期望的正文编码
+        FrameVersion _frame; // 期望的帧头版本
+        CompressPolicy _compress; // 期望的压缩算法和本端的压缩阈值
+        size_t _chunk_size; // 期望的分片长度
+        size_t _memory_limit; // 连接接收方向占用内存的上限
+        std::mutex _mtx;  // 保护 _handshaked、_handshake_waiting
+        std::condition_variable _cond;
+        bool _handshaked;
+        bool _handshake_waiting; // 握手请求已发送且未超时，只在此期间接受握手响应
         BaseConnection::s_ptr _conn;
         muduo::net::EventLoopThread _loopthread;
         muduo::net::EventLoop* _loop;
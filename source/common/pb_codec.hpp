@@ -0,0 +1,384 @@
+/*
+ *  消息正文与 protobuf 类型化消息的相互转换(rpc_message.proto)
+ *  消息对象仍以 Json::Value 保存正文，协议层按 mtype 选择对应的 protobuf 类型编码，不经过 JSON 文本
+ *    REQ_RPC/RSP_RPC、REQ_TOPIC/RSP_TOPIC、REQ_SERVICE/RSP_SERVICE 使用类型化消息
+ *    参数、结果、过滤条件等动态内容使用 google.protobuf.Value，数值统一为 double，整数值解码后恢复为整数
+ *    其它消息整体编码为一个 google.protobuf.Value
+ *  字段缺失或类型不符时不写入，与 check() 中视为缺失的处理一致
+ *  需要 -DJSONRPC_WITH_PROTOBUF，并链接 protoc 生成的 rpc_message.pb.cc 和 libprotobuf
+ */
+#pragma once
+
+#include "util.hpp"
+#include "fields.hpp"
+#include "rpc_message.pb.h"
+
+#include <cmath>
+#include <string>
+
+namespace JsonRpc
+{
+    class PbCodec
+    {
+    public:
+        static bool serialize(MType mtype, const Json::Value& body, std::string& out)
+        {
+            switch (mtype)
+            {
+                case MType::REQ_RPC:
+                {
+                    pb::RpcRequest msg;
+                    setString(body, KEY_METHOD, [&](const std::string& v) { msg.set_method(v); });
+                    if (body.isMember(KEY_PARAMS))
+                        toValue(body[KEY_PARAMS], msg.mutable_parameters());
+                    return msg.SerializeToString(&out);
+                }
+                case MType::RSP_RPC:
+                {
+                    pb::RpcResponse msg;
+                    setInt(body, KEY_RCODE, [&](int v) { msg.set_retcode(v); });
+                    if (body.isMember(KEY_RESULT))
+                        toValue(body[KEY_RESULT], msg.mutable_result());
+                    return msg.SerializeToString(&out);
+                }
+                case MType::REQ_TOPIC:
+                {
+                    pb::TopicRequest msg;
+                    toTopicRequest(body, msg);
+                    return msg.SerializeToString(&out);
+                }
+                case MType::RSP_TOPIC:
+                {
+                    pb::TopicResponse msg;
+                    setInt(body, KEY_RCODE, [&](int v) { msg.set_retcode(v); });
+                    return msg.SerializeToString(&out);
+                }
+                case MType::REQ_SERVICE:
+                {
+                    pb::ServiceRequest msg;
+                    setString(body, KEY_METHOD, [&](const std::string& v) { msg.set_method(v); });
+                    setInt(body, KEY_OPTYPE, [&](int v) { msg.set_optype(v); });
+                    if (body.isMember(KEY_HOST) && body[KEY_HOST].isObject())
+                        toHost(body[KEY_HOST], msg.mutable_host());
+                    return msg.SerializeToString(&out);
+                }
+                case MType::RSP_SERVICE:
+                {
+                    pb::ServiceResponse msg;
+                    setInt(body, KEY_RCODE, [&](int v) { msg.set_retcode(v); });
+                    setInt(body, KEY_OPTYPE, [&](int v) { msg.set_optype(v); });
+                    setString(body, KEY_METHOD, [&](const std::string& v) { msg.set_method(v); });
+                    if (body.isMember(KEY_HOST) && body[KEY_HOST].isArray())
+                    {
+                        for (auto& host : body[KEY_HOST])
+                        {
+                            if (host.isObject())
+                                toHost(host, msg.add_host());
+                        }
+                    }
+                    return msg.SerializeToString(&out);
+                }
+                default:
+                {
+                    google::protobuf::Value msg;
+                    toValue(body, &msg);
+                    return msg.SerializeToString(&out);
+                }
+            }
+        }
+
+        static bool unSerialize(MType mtype, const std::string& in, Json::Value& body)
+        {
+            return unSerialize(mtype, in.data(), in.data() + in.size(), body);
+        }
+
+        static bool unSerialize(MType mtype, const char* begin, const char* end, Json::Value& body)
+        {
+            int size = (int)(end - begin);
+            body = Json::Value(Json::objectValue);
+            switch (mtype)
+            {
+                case MType::REQ_RPC:
+                {
+                    pb::RpcRequest msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    if (msg.has_method())
+                        body[KEY_METHOD] = msg.method();
+                    if (msg.has_parameters())
+                        fromValue(msg.parameters(), body[KEY_PARAMS]);
+                    return true;
+                }
+                case MType::RSP_RPC:
+                {
+                    pb::RpcResponse msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    if (msg.has_retcode())
+                        body[KEY_RCODE] = msg.retcode();
+                    if (msg.has_result())
+                        fromValue(msg.result(), body[KEY_RESULT]);
+                    return true;
+                }
+                case MType::REQ_TOPIC:
+                {
+                    pb::TopicRequest msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    fromTopicRequest(msg, body);
+                    return true;
+                }
+                case MType::RSP_TOPIC:
+                {
+                    pb::TopicResponse msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    if (msg.has_retcode())
+                        body[KEY_RCODE] = msg.retcode();
+                    return true;
+                }
+                case MType::REQ_SERVICE:
+                {
+                    pb::ServiceRequest msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    if (msg.has_method())
+                        body[KEY_METHOD] = msg.method();
+                    if (msg.has_optype())
+                        body[KEY_OPTYPE] = msg.optype();
+                    if (msg.has_host())
+                        fromHost(msg.host(), body[KEY_HOST]);
+                    return true;
+                }
+                case MType::RSP_SERVICE:
+                {
+                    pb::ServiceResponse msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    if (msg.has_retcode())
+                        body[KEY_RCODE] = msg.retcode();
+                    if (msg.has_optype())
+                        body[KEY_OPTYPE] = msg.optype();
+                    if (msg.has_method())
+                        body[KEY_METHOD] = msg.method();
+                    for (auto& host : msg.host())
+                        fromHost(host, body[KEY_HOST].append(Json::Value()));
+                    return true;
+                }
+                default:
+                {
+                    google::protobuf::Value msg;
+                    if (!msg.ParseFromArray(begin, size))
+                        break;
+                    fromValue(msg, body);
+                    return true;
+                }
+            }
+
+            E_LOG("protobuf 正文解析失败!");
+            return false;
+        }
+
+        // Json::Value -> google.protobuf.Value
+        static void toValue(const Json::Value& val, google::protobuf::Value* out)
+        {
+            switch (val.type())
+            {
+                case Json::nullValue:
+                    out->set_null_value(google::protobuf::NULL_VALUE);
+                    break;
+                case Json::booleanValue:
+                    out->set_bool_value(val.asBool());
+                    break;
+                case Json::intValue:
+                case Json::uintValue:
+                case Json::realValue:
+                    out->set_number_value(val.asDouble());
+                    break;
+                case Json::stringValue:
+                    out->set_string_value(val.asString());
+                    break;
+                case Json::arrayValue:
+                {
+                    auto list = out->mutable_list_value();
+                    for (auto& item : val)
+                        toValue(item, list->add_values());
+                    break;
+                }
+                case Json::objectValue:
+                {
+                    auto fields = out->mutable_struct_value()->mutable_fields();
+                    for (auto it = val.begin(); it != val.end(); ++it)
+                        toValue(*it, &(*fields)[it.name()]);
+                    break;
+                }
+            }
+        }
+
+        // google.protobuf.Value -> Json::Value，整数值恢复为整数，与 JSON 文本解析的结果一致
+        static void fromValue(const google::protobuf::Value& val, Json::Value& out)
+        {
+            switch (val.kind_case())
+            {
+                case google::protobuf::Value::kNumberValue:
+                {
+                    double d = val.number_value();
+                    if (std::floor(d) == d && d >= -9007199254740992.0 && d <= 9007199254740992.0) // 2^53 以内的整数
+                        out = (Json::Int64)d;
+                    else
+                        out = d;
+                    break;
+                }
+                case google::protobuf::Value::kStringValue:
+                    out = val.string_value();
+                    break;
+                case google::protobuf::Value::kBoolValue:
+                    out = val.bool_value();
+                    break;
+                case google::protobuf::Value::kStructValue:
+                    out = Json::Value(Json::objectValue);
+                    for (auto& field : val.struct_value().fields())
+                        fromValue(field.second, out[field.first]);
+                    break;
+                case google::protobuf::Value::kListValue:
+                    out = Json::Value(Json::arrayValue);
+                    for (auto& item : val.list_value().values())
+                        fromValue(item, out.append(Json::Value()));
+                    break;
+                default:
+                    out = Json::Value();
+                    break;
+            }
+        }
+
+    private:
+        template <typename F>
+        static void setString(const Json::Value& body, const std::string& key, F set)
+        {
+            if (body.isMember(key) && body[key].isString())
+                set(body[key].asString());
+        }
+
+        template <typename F>
+        static void setInt(const Json::Value& body, const std::string& key, F set)
+        {
+            if (body.isMember(key) && body[key].isInt())
+                set(body[key].asInt());
+        }
+
+        template <typename F>
+        static void setUInt64(const Json::Value& body, const std::string& key, F set)
+        {
+            if (body.isMember(key) && body[key].isUInt64())
+                set(body[key].asUInt64());
+        }
+
+        template <typename F>
+        static void setBool(const Json::Value& body, const std::string& key, F set)
+        {
+            if (body.isMember(key) && body[key].isBool())
+                set(body[key].asBool());
+        }
+
+        static void toTopicRequest(const Json::Value& body, pb::TopicRequest& msg)
+        {
+            setString(body, KEY_TOPIC_KEY, [&](const std::string& v) { msg.set_topic_key(v); });
+            setInt(body, KEY_OPTYPE, [&](int v) { msg.set_optype(v); });
+            setString(body, KEY_TOPIC_MSG, [&](const std::string& v) { msg.set_topic_msg(v); });
+            setUInt64(body, KEY_TOPIC_SEQ, [&](uint64_t v) { msg.set_topic_seq(v); });
+            setUInt64(body, KEY_REPLAY_FROM, [&](uint64_t v) { msg.set_replay_from(v); });
+            setUInt64(body, KEY_REPLAY_LAST, [&](uint64_t v) { msg.set_replay_last(v); });
+            setBool(body, KEY_NO_ACK, [&](bool v) { msg.set_no_ack(v); });
+            setString(body, KEY_GROUP, [&](const std::string& v) { msg.set_group(v); });
+            setInt(body, KEY_GROUP_BALANCE, [&](int v) { msg.set_group_balance(v); });
+            setBool(body, KEY_RELIABLE, [&](bool v) { msg.set_reliable(v); });
+            setString(body, KEY_CONSUMER, [&](const std::string& v) { msg.set_consumer(v); });
+            setUInt64(body, KEY_ACK_SEQ, [&](uint64_t v) { msg.set_ack_seq(v); });
+
+            if (body.isMember(KEY_TOPIC_BATCH) && body[KEY_TOPIC_BATCH].isArray())
+            {
+                auto batch = msg.mutable_topic_batch();
+                for (auto& item : body[KEY_TOPIC_BATCH])
+                {
+                    auto pb_item = batch->add_items();
+                    setString(item, KEY_TOPIC_KEY, [&](const std::string& v) { pb_item->set_topic_key(v); });
+                    setString(item, KEY_TOPIC_MSG, [&](const std::string& v) { pb_item->set_topic_msg(v); });
+                }
+            }
+
+            if (body.isMember(KEY_TOPIC_KEYS) && body[KEY_TOPIC_KEYS].isArray())
+            {
+                auto keys = msg.mutable_topic_keys();
+                for (auto& key : body[KEY_TOPIC_KEYS])
+                    keys->add_keys(key.isString() ? key.asString() : std::string());
+            }
+
+            if (body.isMember(KEY_FILTER))
+                toValue(body[KEY_FILTER], msg.mutable_filter());
+        }
+
+        static void fromTopicRequest(const pb::TopicRequest& msg, Json::Value& body)
+        {
+            if (msg.has_topic_key())
+                body[KEY_TOPIC_KEY] = msg.topic_key();
+            if (msg.has_optype())
+                body[KEY_OPTYPE] = msg.optype();
+            if (msg.has_topic_msg())
+                body[KEY_TOPIC_MSG] = msg.topic_msg();
+            if (msg.has_topic_seq())
+                body[KEY_TOPIC_SEQ] = (Json::UInt64)msg.topic_seq();
+            if (msg.has_replay_from())
+                body[KEY_REPLAY_FROM] = (Json::UInt64)msg.replay_from();
+            if (msg.has_replay_last())
+                body[KEY_REPLAY_LAST] = (Json::UInt64)msg.replay_last();
+            if (msg.has_no_ack())
+                body[KEY_NO_ACK] = msg.no_ack();
+            if (msg.has_group())
+                body[KEY_GROUP] = msg.group();
+            if (msg.has_group_balance())
+                body[KEY_GROUP_BALANCE] = msg.group_balance();
+            if (msg.has_reliable())
+                body[KEY_RELIABLE] = msg.reliable();
+            if (msg.has_consumer())
+                body[KEY_CONSUMER] = msg.consumer();
+            if (msg.has_ack_seq())
+                body[KEY_ACK_SEQ] = (Json::UInt64)msg.ack_seq();
+
+            if (msg.has_topic_batch())
+            {
+                Json::Value& batch = body[KEY_TOPIC_BATCH] = Json::Value(Json::arrayValue);
+                for (auto& pb_item : msg.topic_batch().items())
+                {
+                    Json::Value& item = batch.append(Json::Value());
+                    item[KEY_TOPIC_KEY] = pb_item.topic_key();
+                    item[KEY_TOPIC_MSG] = pb_item.topic_msg();
+                }
+            }
+
+            if (msg.has_topic_keys())
+            {
+                Json::Value& keys = body[KEY_TOPIC_KEYS] = Json::Value(Json::arrayValue);
+                for (auto& key : msg.topic_keys().keys())
+                    keys.append(key);
+            }
+
+            if (msg.has_filter())
+                fromValue(msg.filter(), body[KEY_FILTER]);
+        }
+
+        static void toHost(const Json::Value& host, pb::Host* out)
+        {
+            setString(host, KEY_HOST_IP, [&](const std::string& v) { out->set_ip(v); });
+            setInt(host, KEY_HOST_PORT, [&](int v) { out->set_port(v); });
+        }
+
+        static void fromHost(const pb::Host& host, Json::Value& out)
+        {
+            out = Json::Value(Json::objectValue);
+            if (host.has_ip())
+                out[KEY_HOST_IP] = host.ip();
+            if (host.has_port())
+                out[KEY_HOST_PORT] = host.port();
+        }
+    };
+}
@@ -0,0 +1,165 @@
+/*
+ *  protobuf 协议: 帧由 muduo 的 ProtobufCodecLite 封装，正文为 rpc_message.proto 中的类型化消息
+ *    | size | "JRPC" | Envelope { mtype, rid, body } | adler32 |
+ *  消息对象、分发器、路由与注册中心不变，只替换连接上的协议
+ *  连接建立后先按 LVProtocol + JSON 握手，协商为 CODEC_PROTOBUF 后双方切换为本协议
+ *  需要 -DJSONRPC_WITH_PROTOBUF，链接 rpc_message.pb.cc、muduo_protobuf_codec、protobuf、z
+ */
+#pragma once
+
+#include "util.hpp"
+#include "fields.hpp"
+#include "abstract.hpp"
+#include "message.hpp"
+#include "rpc_message.pb.h"
+
+#include <muduo/net/Buffer.h>
+#include <muduo/net/protobuf/ProtobufCodecLite.h>
+
+namespace JsonRpc
+{
+    class ProtobufProtocol : public BaseProtocol
+    {
+    public:
+        using s_ptr = std::shared_ptr<ProtobufProtocol>;
+
+        ProtobufProtocol()
+            : _codec(&pb::Envelope::default_instance(), "JRPC",
+                [](const muduo::net::TcpConnectionPtr&, const muduo::net::MessagePtr&, muduo::Timestamp) {})
+        {}
+
+        virtual BodyCodec codec() override
+        {
+            return BodyCodec::CODEC_PROTOBUF;
+        }
+
+        // 缓冲区是否可转化为消息
+        virtual bool canProcessed(const BaseBuffer::s_ptr& buf) override
+        {
+            if (buf->readableSize() < headerLen)
+                return false;
+
+            int32_t len = buf->peekInt32();
+            return buf->readableSize() >= len + headerLen;
+        }
+
+        // 将缓冲区转化为消息，在缓冲区上直接解析，成功后才删除这一帧，不使用键字典
+        virtual bool onMessage(const BaseBuffer::s_ptr& buf, BaseMessage::s_ptr& msg, KeyDictionary* keys = nullptr) override
+        {
+            int32_t len = buf->peekInt32();
+            if (len < 0 || !decode(buf->peek() + headerLen, len, msg))
+                return false;
+
+            buf->retrieve(headerLen + len);
+            return true;
+        }
+
+        // 序列化
+        virtual std::string serialize(const BaseMessage::s_ptr& msg) override
+        {
+            return frame(msg->mtype(), textId(msg), msg->serialize(BodyCodec::CODEC_PROTOBUF));
+        }
+
+        // 类型化消息由 protobuf 先序列化为 string，再整帧追加
+        virtual void serializeTo(const BaseMessage::s_ptr& msg, BaseBuffer& out, KeyDictionary* keys = nullptr) override
+        {
+            std::string data = serialize(msg);
+            out.append(data.data(), data.size());
+        }
+
+        // 编码一次，多个连接共享，转发 protobuf 连接收到的消息时复用原始正文
+        virtual SharedFrame sharedFrame(const BaseMessage::s_ptr& msg, bool forward) override
+        {
+            if (forward && !msg->rawBody().empty() && msg->rawCodec() == BodyCodec::CODEC_PROTOBUF)
+                return std::make_shared<const std::string>(frame(msg->mtype(), textId(msg), msg->rawBody()));
+
+            return std::make_shared<const std::string>(serialize(msg));
+        }
+
+        // Envelope { REQ_TOPIC_BUNDLE, "", frame1 frame2 ... }
+        virtual SharedFrame bundle(const std::vector<SharedFrame>& frames) override
+        {
+            std::string body;
+            size_t bodyLen = 0;
+            for (auto& f : frames)
+                bodyLen += f->size();
+            body.reserve(bodyLen);
+            for (auto& f : frames)
+                body.append(*f);
+
+            return std::make_shared<const std::string>(frame(MType::REQ_TOPIC_BUNDLE, std::string(), body));
+        }
+
+        virtual bool unbundle(const BaseMessage::s_ptr& bundle, std::vector<BaseMessage::s_ptr>& msgs) override
+        {
+            const std::string& body = bundle->rawBody();
+            size_t pos = 0;
+            while (pos < body.size())
+            {
+                BaseMessage::s_ptr msg;
+                if (body.size() - pos < headerLen)
+                    return false;
+
+                int32_t len = muduo::net::ProtobufCodecLite::asInt32(body.data() + pos); // 已转为主机字节序
+                if (len < 0 || body.size() - pos - headerLen < (size_t)len || !decode(body.data() + pos + headerLen, len, msg))
+                {
+                    E_LOG("合并推送帧格式错误!");
+                    return false;
+                }
+                msgs.push_back(msg);
+                pos += headerLen + len;
+            }
+            return true;
+        }
+
+    private:
+        // data 指向帧头之后: | tag | Envelope | checksum |
+        bool decode(const char* data, int32_t len, BaseMessage::s_ptr& msg)
+        {
+            pb::Envelope env;
+            muduo::net::ProtobufCodecLite::ErrorCode err = _codec.parse(data, len, &env);
+            if (err != muduo::net::ProtobufCodecLite::kNoError)
+            {
+                E_LOG("protobuf 帧解析失败: %s", muduo::net::ProtobufCodecLite::errorCodeToString(err).c_str());
+                return false;
+            }
+
+            MType mtype = (MType)env.mtype();
+            msg = MessageFactory::create(mtype);
+            if (msg.get() == nullptr)
+            {
+                E_LOG("消息类型错误，构造消息对象失败!");
+                return false;
+            }
+
+            msg->setMtype(mtype); // 正文的 protobuf 类型由 mtype 决定，先设置
+            setTextId(msg, env.rid().data(), env.rid().size());
+            if (!msg->unSerialize(env.body(), BodyCodec::CODEC_PROTOBUF))
+            {
+                E_LOG("消息正文反序列化失败!");
+                return false;
+            }
+
+            if (msg->keepRawBody())
+                msg->setRawBody(std::move(*env.mutable_body()), BodyCodec::CODEC_PROTOBUF);
+            return true;
+        }
+
+        std::string frame(MType mtype, const std::string& rid, const std::string& body)
+        {
+            pb::Envelope env;
+            env.set_mtype((int32_t)mtype);
+            env.set_rid(rid);
+            env.set_body(body);
+
+            muduo::net::Buffer buf;
+            _codec.fillEmptyBuffer(&buf, env);
+            return buf.retrieveAllAsString();
+        }
+
+    private:
+        static const size_t headerLen = muduo::net::ProtobufCodecLite::kHeaderLen;
+
+        muduo::net::ProtobufCodecLite _codec; // 只使用其帧格式的编码与校验，不直接收发
+    };
+}
@@ -0,0 +1,157 @@
+/*
+ *  主题订阅的内容过滤条件
+ *  订阅时携带过滤条件，服务端编译一次，推送前对消息(JSON 对象)的顶层字段求值，不满足的订阅者不推送
+ *    等于:   { "field": "symbol", "op": FILTER_EQ,    "value": "600000" }
+ *    集合:   { "field": "symbol", "op": FILTER_IN,    "values": ["600000", "600036"] }
+ *    范围:   { "field": "price",  "op": FILTER_RANGE, "min": 10, "max": 20 }  闭区间，min/max 可省略
+ *  数值统一按 double 比较，1 与 1.0 相等
+ */
+#pragma once
+
+#include "util.hpp"
+#include "fields.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <unordered_set>
+
+namespace JsonRpc
+{
+    class TopicFilter
+    {
+    public:
+        using s_ptr = std::shared_ptr<TopicFilter>;
+
+        // 构造过滤条件描述，客户端订阅时使用
+        static Json::Value equal(const std::string& field, const Json::Value& value)
+        {
+            Json::Value spec;
+            spec[KEY_FILTER_FIELD] = field;
+            spec[KEY_FILTER_OP] = (int)FilterOp::FILTER_EQ;
+            spec[KEY_FILTER_VALUE] = value;
+            return spec;
+        }
+
+        static Json::Value in(const std::string& field, const std::vector<Json::Value>& values)
+        {
+            Json::Value spec;
+            spec[KEY_FILTER_FIELD] = field;
+            spec[KEY_FILTER_OP] = (int)FilterOp::FILTER_IN;
+            spec[KEY_FILTER_VALUES] = Json::Value(Json::arrayValue);
+            for (auto& value : values)
+                spec[KEY_FILTER_VALUES].append(value);
+            return spec;
+        }
+
+        static Json::Value range(const std::string& field, double min, double max)
+        {
+            Json::Value spec;
+            spec[KEY_FILTER_FIELD] = field;
+            spec[KEY_FILTER_OP] = (int)FilterOp::FILTER_RANGE;
+            spec[KEY_FILTER_MIN] = min;
+            spec[KEY_FILTER_MAX] = max;
+            return spec;
+        }
+
+        // 编译过滤条件，描述无效时返回 nullptr
+        static s_ptr compile(const Json::Value& spec)
+        {
+            if (!spec.isObject() || !spec[KEY_FILTER_FIELD].isString() || !spec[KEY_FILTER_OP].isInt())
+                return s_ptr();
+
+            s_ptr filter(new TopicFilter(spec[KEY_FILTER_FIELD].asString(), (FilterOp)spec[KEY_FILTER_OP].asInt()));
+            switch (filter->_op)
+            {
+            case FilterOp::FILTER_EQ:
+                if (!canonical(spec[KEY_FILTER_VALUE], filter->_value))
+                    return s_ptr();
+                break;
+            case FilterOp::FILTER_IN:
+                if (!spec[KEY_FILTER_VALUES].isArray())
+                    return s_ptr();
+                for (auto& value : spec[KEY_FILTER_VALUES])
+                {
+                    std::string key;
+                    if (!canonical(value, key))
+                        return s_ptr();
+                    filter->_values.insert(key);
+                }
+                break;
+            case FilterOp::FILTER_RANGE:
+                if ((spec.isMember(KEY_FILTER_MIN) && !spec[KEY_FILTER_MIN].isNumeric())
+                    || (spec.isMember(KEY_FILTER_MAX) && !spec[KEY_FILTER_MAX].isNumeric()))
+                    return s_ptr();
+                if (spec.isMember(KEY_FILTER_MIN))
+                    filter->_min = spec[KEY_FILTER_MIN].asDouble();
+                if (spec.isMember(KEY_FILTER_MAX))
+                    filter->_max = spec[KEY_FILTER_MAX].asDouble();
+                break;
+            default:
+                return s_ptr();
+            }
+            return filter;
+        }
+
+        // 对消息求值，消息不是 JSON 对象或没有该字段时不满足
+        bool match(const Json::Value& doc) const
+        {
+            if (!doc.isObject() || !doc.isMember(_field))
+                return false;
+
+            const Json::Value& value = doc[_field];
+            switch (_op)
+            {
+            case FilterOp::FILTER_EQ:
+            {
+                std::string key;
+                return canonical(value, key) && key == _value;
+            }
+            case FilterOp::FILTER_IN:
+            {
+                std::string key;
+                return canonical(value, key) && _values.count(key) > 0;
+            }
+            case FilterOp::FILTER_RANGE:
+                return value.isNumeric() && value.asDouble() >= _min && value.asDouble() <= _max;
+            default:
+                return false;
+            }
+        }
+
+    private:
+        TopicFilter(const std::string& field, FilterOp op)
+            : _field(field)
+            , _op(op)
+            , _min(-std::numeric_limits<double>::infinity())
+            , _max(std::numeric_limits<double>::infinity())
+        {}
+
+        // 标量转为可以直接比较的字符串，类型不同的值不会相等
+        static bool canonical(const Json::Value& value, std::string& key)
+        {
+            if (value.isString())
+                key = "s" + value.asString();
+            else if (value.isBool()) // jsoncpp 中 bool 也是 numeric，先判断
+                key = value.asBool() ? "b1" : "b0";
+            else if (value.isNumeric())
+            {
+                std::ostringstream ss;
+                ss << std::setprecision(17) << value.asDouble();
+                key = "n" + ss.str();
+            }
+            else
+                return false;
+            return true;
+        }
+
+    private:
+        std::string _field;
+        FilterOp _op;
+        std::string _value;                      // FILTER_EQ
+        std::unordered_set<std::string> _values; // FILTER_IN
+        double _min;                             // FILTER_RANGE
+        double _max;
+    };
+}
@@ -0,0 +1,146 @@
+/*
+ *  层级主题的通配符索引
+ *  主题名称以 '.' 分隔为若干段，例如 market.sh.600000
+ *  订阅模式中的整段 '*' 匹配恰好一段，整段 '#' 匹配零或多段
+ *    market.*.600000  匹配 market.sh.600000
+ *    market.#         匹配 market、market.sh、market.sh.600000
+ *  按段建立前缀树，匹配一个主题只需沿主题的各段向下查找，与模式的数量无关
+ */
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+
+namespace JsonRpc
+{
+    template <typename T>
+    class TopicTrie
+    {
+    public:
+        // 是否为通配符模式
+        static bool isPattern(const std::string& key)
+        {
+            for (auto& seg : split(key))
+            {
+                if (seg == "*" || seg == "#")
+                    return true;
+            }
+            return false;
+        }
+
+        static std::vector<std::string> split(const std::string& key)
+        {
+            std::vector<std::string> segs;
+            size_t start = 0;
+            while (true)
+            {
+                size_t pos = key.find('.', start);
+                segs.push_back(key.substr(start, pos - start));
+                if (pos == std::string::npos)
+                    break;
+                start = pos + 1;
+            }
+            return segs;
+        }
+
+        // 添加模式，同一模式下的值已存在时返回 false
+        bool insert(const std::string& pattern, const T& value)
+        {
+            Node* node = &_root;
+            for (auto& seg : split(pattern))
+            {
+                std::unique_ptr<Node>& child = node->children[seg];
+                if (!child)
+                    child.reset(new Node());
+                node = child.get();
+            }
+
+            if (std::find(node->values.begin(), node->values.end(), value) != node->values.end())
+                return false;
+
+            node->values.push_back(value);
+            _size++;
+            return true;
+        }
+
+        // 删除模式下的值，并清理空的节点
+        bool remove(const std::string& pattern, const T& value)
+        {
+            std::vector<std::string> segs = split(pattern);
+            return remove(&_root, segs, 0, value);
+        }
+
+        // 匹配主题的所有值，多个模式下的同一个值会出现多次
+        void match(const std::string& topic, std::vector<T>& out) const
+        {
+            std::vector<std::string> segs = split(topic);
+            match(&_root, segs, 0, out);
+        }
+
+        // 模式的总数
+        size_t size() const
+        {
+            return _size;
+        }
+
+    private:
+        struct Node
+        {
+            std::unordered_map<std::string, std::unique_ptr<Node>> children; // 段 -> 子节点，包括 "*" 与 "#"
+            std::vector<T> values;
+        };
+
+        bool remove(Node* node, const std::vector<std::string>& segs, size_t i, const T& value)
+        {
+            if (i == segs.size())
+            {
+                auto it = std::find(node->values.begin(), node->values.end(), value);
+                if (it == node->values.end())
+                    return false;
+
+                node->values.erase(it);
+                _size--;
+                return true;
+            }
+
+            auto it = node->children.find(segs[i]);
+            if (it == node->children.end() || !remove(it->second.get(), segs, i + 1, value))
+                return false;
+
+            if (it->second->values.empty() && it->second->children.empty())
+                node->children.erase(it);
+            return true;
+        }
+
+        void match(const Node* node, const std::vector<std::string>& segs, size_t i, std::vector<T>& out) const
+        {
+            auto hash = node->children.find("#");
+            if (hash != node->children.end()) // '#' 吞掉剩余的 0 ~ n 段
+            {
+                for (size_t j = i; j <= segs.size(); j++)
+                    match(hash->second.get(), segs, j, out);
+            }
+
+            if (i == segs.size())
+            {
+                out.insert(out.end(), node->values.begin(), node->values.end());
+                return;
+            }
+
+            auto exact = node->children.find(segs[i]);
+            if (exact != node->children.end() && segs[i] != "#")
+                match(exact->second.get(), segs, i + 1, out);
+
+            auto star = node->children.find("*");
+            if (star != node->children.end() && segs[i] != "*")
+                match(star->second.get(), segs, i + 1, out);
+        }
+
+    private:
+        Node _root;
+        size_t _size = 0;
+    };
+}
@@ -23,7 +23,9 @@ namespace JsonRpc
     #define LOG_DEBUG 0
     #define LOG_INFO 1
     #define LOG_ERROR 2
+    #ifndef LOG_LINE // 允许编译时通过 -DLOG_LINE=... 调整输出等级(压测时关闭调试日志)
     #define LOG_LINE LOG_DEBUG
+    #endif
 
     // 日志宏
     #define LOG(level, format, ...) {\
@@ -49,26 +51,40 @@ namespace JsonRpc
         static bool serialize(const Json::Value& val, std::string& body)
         {
             std::stringstream ss;
-            Json::StreamWriterBuilder swb;
-            std::unique_ptr<Json::StreamWriter> sw(swb.newStreamWriter());
-            int ret = sw->write(val, &ss);
+            if (!serialize(val, ss))
+                return false;
+
+            body = ss.str();
+            return true;
+        }
+
+        // 序列化到输出流，写入缓冲区的流可以省去中间的 string(见 BufferStreamBuf)
+        // 与解析器一样，StreamWriter 按线程缓存复用
+        static bool serialize(const Json::Value& val, std::ostream& os)
+        {
+            static thread_local std::unique_ptr<Json::StreamWriter> sw(Json::StreamWriterBuilder().newStreamWriter());
+            int ret = sw->write(val, &os);
             if (ret != 0)
             {
                 E_LOG("json serialize error!");
                 return false;
             }
-
-            body = ss.str();
             return true;
         }
 
         // 反序列化
         static bool unSerialize(const std::string& body, Json::Value& val)
         {
-            Json::CharReaderBuilder crb;
-            std::unique_ptr<Json::CharReader> cr(crb.newCharReader());
+            return unSerialize(body.data(), body.data() + body.size(), val);
+        }
+
+        // 直接解析一段内存，不要求以 '\0' 结尾
+        // CharReaderBuilder 每次构造都要生成一份配置对象，解析器按线程缓存复用，每次解析前会重置状态
+        static bool unSerialize(const char* begin, const char* end, Json::Value& val)
+        {
+            static thread_local std::unique_ptr<Json::CharReader> cr(Json::CharReaderBuilder().newCharReader());
             std::string errs;
-            bool ret = cr->parse(body.c_str(), body.c_str() + body.size(), &val, &errs);
+            bool ret = cr->parse(begin, end, &val, &errs);
             if (!ret)
                 E_LOG("json deserialize error: %s", errs.c_str());
 
@@ -79,44 +95,32 @@ namespace JsonRpc
     class UUID
     {
     public:
+        // 请求之间用连接上的整数关联 id 匹配响应(见 BaseMessage::cid)，uuid 只用于需要全局唯一的标识，例如消费者名称
         static std::string uuid()
         {
             // uuid: 8字节随机数 + 8字节自增序号
             //       以 8-4-4-4-12 形式组织起来
 
-            std::stringstream ss;
-
-            // 机器随机数，通过硬件实现，随机性强，但是慢
-            std::random_device rd; 
-
+            // 机器随机数，通过硬件实现，随机性强，但是慢，每个线程只用一次作为种子
             // 以机器随机数为种子，构造伪随机数对象(此处不使用时间，防止短时间内多次生成随机数一样)
-            std::mt19937 generator(rd());
-
-            // 限定随机数范围，指定 0-255 也就是一次生成一个字节
-            std::uniform_int_distribution<int> distribution(0, 255); 
-
-            for (int i = 0; i < 8; i++)
-            {
-                if (i == 4 || i == 6)
-                    ss << "-";
-                //    限制两位宽度     不足的位置填充 0     转为十六进制   限定范围    生成随机数 
-                ss << std::setw(2) << std::setfill('0') << std::hex << distribution(generator);
-            }
-
-            ss << "-";
+            static thread_local std::mt19937_64 generator(std::random_device{}());
 
             static std::atomic<size_t> seq(1); // 全局自增变量
-            size_t cur = seq.fetch_add(1);
+            uint64_t high = generator();
+            uint64_t low = seq.fetch_add(1);
 
-            for (int i = 7; i >=0 ; i--) // 从高位到低位拼接
+            static const char hex[] = "0123456789abcdef";
+            std::string result;
+            result.reserve(36);
+            for (int i = 0; i < 16; i++) // 从高位到低位拼接，每字节两位十六进制
             {
-                if (i == 5)
-                    ss << "-";
-                //                                                 当前数字右移i*8位，按位与 0xff
-                ss << std::setw(2) << std::setfill('0') << std::hex << ((cur >> (i*8)) & 0xFF);
+                if (i == 4 || i == 6 || i == 8 || i == 10)
+                    result.push_back('-');
+                uint8_t byte = i < 8 ? (uint8_t)(high >> ((7 - i) * 8)) : (uint8_t)(low >> ((15 - i) * 8));
+                result.push_back(hex[byte >> 4]);
+                result.push_back(hex[byte & 0xf]);
             }
-
-            return ss.str();
+            return result;
         }
     };
 };
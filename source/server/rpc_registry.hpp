@@ -30,7 +30,7 @@ namespace JsonRpc
 
                 void appendMethod(const std::string& method)
                 {
-                    std::unique_lock<std::mutex> lock;
+                    std::unique_lock<std::mutex> lock(mtx);
                     methods.push_back(method);
                 }
             };
@@ -39,7 +39,7 @@ namespace JsonRpc
             {
                 Provider::s_ptr provider;
                 {
-                    std::unique_lock<std::mutex> lock;
+                    std::unique_lock<std::mutex> lock(_mtx);
 
                     // 获取/创建 provider
                     if (_conns.count(conn))
@@ -61,13 +61,13 @@ namespace JsonRpc
 
             Provider::s_ptr getProvider(const BaseConnection::s_ptr& conn)
             {
-                std::unique_lock<std::mutex> lock;
+                std::unique_lock<std::mutex> lock(_mtx);
                 return _conns.count(conn) ? _conns[conn] : nullptr;
             }
 
             void delProvider(const BaseConnection::s_ptr& conn)
             {
-                std::unique_lock<std::mutex> lock;
+                std::unique_lock<std::mutex> lock(_mtx);
                 auto con_it = _conns.find(conn);
                 if (con_it == _conns.end())
                     return;
@@ -123,7 +123,7 @@ namespace JsonRpc
 
                 void appendMethod(const std::string& method)
                 {
-                    std::unique_lock<std::mutex> lock;
+                    std::unique_lock<std::mutex> lock(mtx);
                     methods.push_back(method);
                 }
             };
@@ -132,7 +132,7 @@ namespace JsonRpc
             {
                 Discover::s_ptr discover;
                 {
-                    std::unique_lock<std::mutex> lock;
+                    std::unique_lock<std::mutex> lock(_mtx);
 
                     // 获取/创建 discover
                     if (_conns.count(conn))
@@ -155,7 +155,7 @@ namespace JsonRpc
 
             void delDiscover(const BaseConnection::s_ptr& conn)
             {
-                std::unique_lock<std::mutex> lock;
+                std::unique_lock<std::mutex> lock(_mtx);
                 auto con_it = _conns.find(conn);
                 if (con_it == _conns.end())
                     return;
@@ -187,7 +187,7 @@ namespace JsonRpc
         private:
             void notify(const std::string& method, const Address& addr, ServiceOpType op)
             {
-                std::unique_lock<std::mutex> lock;
+                std::unique_lock<std::mutex> lock(_mtx);
                 if (!_discovers.count(method))
                     return;
 
@@ -267,6 +267,7 @@ namespace JsonRpc
             {
                 ServiceResponse::s_ptr msg_rsp = MessageFactory::create<ServiceResponse>();
                 msg_rsp->setRid(msg->rid());
+                msg_rsp->setCid(msg->cid());
                 msg_rsp->setMtype(MType::RSP_SERVICE);
                 msg_rsp->setRcode(RetCode::RCODE_OK);
                 msg_rsp->setOptype(ServiceOpType::SERVICE_REGISTRY);
@@ -278,6 +279,7 @@ namespace JsonRpc
             {
                 ServiceResponse::s_ptr msg_rsp = MessageFactory::create<ServiceResponse>();
                 msg_rsp->setRid(msg->rid());
+                msg_rsp->setCid(msg->cid());
                 msg_rsp->setMtype(MType::RSP_SERVICE);
                 msg_rsp->setOptype(ServiceOpType::SERVICE_DISCOVER);
 
@@ -303,6 +305,7 @@ namespace JsonRpc
             {
                 ServiceResponse::s_ptr msg_rsp = MessageFactory::create<ServiceResponse>();
                 msg_rsp->setRid(msg->rid());
+                msg_rsp->setCid(msg->cid());
                 msg_rsp->setMtype(MType::RSP_SERVICE);
                 msg_rsp->setRcode(RetCode::RCODE_OK);
                 msg_rsp->setOptype(ServiceOpType::SERVICE_UNKNOW);
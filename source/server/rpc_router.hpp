@@ -2,6 +2,9 @@
 
 #include "../common/net.hpp"
 #include "../common/message.hpp"
+#include "../common/executor.hpp"
+
+#include <thread>
 
 namespace JsonRpc
 {
@@ -17,6 +20,14 @@ namespace JsonRpc
             OBJECT  
         };
 
+        // 业务回调的执行方式
+        enum class ExecPolicy
+        {
+            INLINE = 0,  // 在连接的 I/O 线程中直接执行(默认)
+            SHARED_POOL, // 投递到 RpcRouter 的共享线程池
+            BULKHEAD     // 投递到该方法独占的线程池，慢方法不会占满其它方法的线程
+        };
+
         // 服务描述类
         class ServiceDescriber
         {
@@ -26,11 +37,14 @@ namespace JsonRpc
             using paramDescriber = std::pair<std::string, VType>;
 
             ServiceDescriber(const std::string&& name, std::vector<paramDescriber>&& params_desc, 
-                VType return_type, ServiceCallback&& cb)
+                VType return_type, ServiceCallback&& cb, ExecPolicy policy = ExecPolicy::INLINE,
+                const BaseExecutor::s_ptr& executor = BaseExecutor::s_ptr())
                 : _name(std::move(name))
                 , _params_desc(std::move(params_desc))
                 , _return_type(return_type)
                 , _cb(std::move(cb))
+                , _policy(policy)
+                , _executor(executor)
             {}
 
             const std::string& method()
@@ -38,6 +52,23 @@ namespace JsonRpc
                 return _name; 
             }
 
+            ExecPolicy execPolicy()
+            {
+                return _policy;
+            }
+
+            // 执行业务回调的执行器，为空表示在 I/O 线程中直接执行
+            const BaseExecutor::s_ptr& executor()
+            {
+                return _executor;
+            }
+
+            // 注册到 RpcRouter 时设置，之后只读
+            void setExecutor(const BaseExecutor::s_ptr& executor)
+            {
+                _executor = executor;
+            }
+
             // 检查参数是否合法
             bool checkParam(const Json::Value& params)
             {
@@ -102,6 +133,8 @@ namespace JsonRpc
             ServiceCallback _cb; // 业务回调函数
             std::vector<paramDescriber> _params_desc; // 参数类型描述
             VType _return_type; // 返回值类型描述
+            ExecPolicy _policy; // 执行方式
+            BaseExecutor::s_ptr _executor; // 执行器
         };
 
         // 建造者模式
@@ -112,7 +145,12 @@ namespace JsonRpc
         public:
             ServiceDescriber::s_ptr build()
             {
-                return std::make_shared<ServiceDescriber>(std::move(_name), std::move(_params_desc), std::move(_return_type), std::move(_cb));
+                BaseExecutor::s_ptr executor;
+                if (_policy == ExecPolicy::BULKHEAD) // 独占线程池随方法一起创建
+                    executor = ExecutorFactory::create<ThreadPoolExecutor>("Bulkhead-" + _name, _thread_num);
+
+                return std::make_shared<ServiceDescriber>(std::move(_name), std::move(_params_desc), std::move(_return_type), 
+                    std::move(_cb), _policy, executor);
             }
 
             void setName(const std::string name)
@@ -135,11 +173,20 @@ namespace JsonRpc
                 _return_type = return_type;
             }
 
+            // thread_num 只对 BULKHEAD 生效，为该方法独占线程池的大小
+            void setExecPolicy(ExecPolicy policy, int thread_num = 1)
+            {
+                _policy = policy;
+                _thread_num = thread_num;
+            }
+
         private:
             std::string _name; // 方法名称
             ServiceDescriber::ServiceCallback _cb; // 业务回调函数
             std::vector<ServiceDescriber::paramDescriber> _params_desc; // 参数类型描述
             VType _return_type; // 返回值类型描述
+            ExecPolicy _policy = ExecPolicy::INLINE; // 执行方式
+            int _thread_num = 1; // 独占线程池大小
         };
         
         // 服务管理类 -> 将管理与使用区分开，在业务层面不考虑加锁问题
@@ -202,6 +249,7 @@ namespace JsonRpc
 
             RpcRouter()
                 : _service_manager(std::make_shared<ServiceManager>())
+                , _shared_thread_num(std::thread::hardware_concurrency())
             {}
 
             // 注册给dispatcher的回调
@@ -218,6 +266,44 @@ namespace JsonRpc
                     return;
                 }
 
+                const BaseExecutor::s_ptr& executor = service->executor();
+                if (!executor)
+                {
+                    process(conn, req, service);
+                    return;
+                }
+
+                // 交给工作线程执行，I/O 线程继续处理其它连接
+                executor->submit(std::bind(&RpcRouter::process, this, conn, req, service));
+            }
+            
+            // 注册服务
+            void registerMethod(ServiceDescriber::s_ptr service)
+            {
+                if (service->execPolicy() == ExecPolicy::SHARED_POOL)
+                    service->setExecutor(sharedExecutor());
+
+                _service_manager->insert(service);
+            }
+
+            // 共享线程池大小，需要在注册 SHARED_POOL 方法之前设置，默认为 CPU 核数
+            void setSharedThreadNum(int thread_num)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _shared_thread_num = thread_num;
+            }
+
+            // 替换共享执行器，需要在注册 SHARED_POOL 方法之前设置
+            void setSharedExecutor(const BaseExecutor::s_ptr& executor)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _shared_executor = executor;
+            }
+        
+        private:
+            // 检查参数、调用业务回调并响应，INLINE 方法在 I/O 线程执行，其余在工作线程执行
+            void process(const BaseConnection::s_ptr& conn, const RpcRequest::s_ptr& req, const ServiceDescriber::s_ptr& service)
+            {
                 // 检查参数类型
                 if (!service->checkParam(req->params()))
                 {
@@ -239,27 +325,36 @@ namespace JsonRpc
                 // 返回结果
                 response(conn, req, res, RetCode::RCODE_OK);
             }
-            
-            // 注册服务
-            void registerMethod(ServiceDescriber::s_ptr service)
-            {
-                _service_manager->insert(service);
-            }
-        
-        private:
+
             void response(const BaseConnection::s_ptr& conn, const RpcRequest::s_ptr& req, 
                 const Json::Value& res, RetCode rcode)
             {
                 std::shared_ptr<JsonRpc::RpcResponse> response = MessageFactory::create<RpcResponse>();
                 response->setRid(req->rid());
+                response->setCid(req->cid());
                 response->setRcode(rcode);
                 response->setMtype(MType::RSP_RPC);
                 response->setResult(res);
-                conn->send(response);
+
+                // 响应投递回连接所属的 I/O 线程发送
+                conn->runInLoop([conn, response]() { conn->send(response); });
+            }
+
+            BaseExecutor::s_ptr sharedExecutor()
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                if (!_shared_executor) // 第一次注册 SHARED_POOL 方法时创建
+                    _shared_executor = ExecutorFactory::create<ThreadPoolExecutor>("RpcShared", _shared_thread_num);
+
+                return _shared_executor;
             }
 
         private:
             ServiceManager::s_ptr _service_manager;
+
+            std::mutex _mtx; // 保护共享执行器的创建
+            int _shared_thread_num;
+            BaseExecutor::s_ptr _shared_executor;
         };
     }
 }
\ No newline at end of file
@@ -16,10 +16,11 @@ namespace JsonRpc
         public:
             using s_ptr = std::shared_ptr<RegistryServer>;
             
-            RegistryServer(int port)
+            // thread_num: I/O 线程数量，0 表示单 reactor
+            RegistryServer(int port, int thread_num = 0)
                 : _pd_manager(std::make_shared<PDManager>())
                 , _dispatcher(std::make_shared<Dispatcher>())
-                , _server(ServerFactory::create(port))
+                , _server(ServerFactory::create(port, thread_num))
             {
                 auto service_cb = std::bind(&PDManager::onServiceRequest, _pd_manager.get(),
                                     std::placeholders::_1, std::placeholders::_2);
@@ -38,6 +39,17 @@ namespace JsonRpc
             {
                 _server->start();
             }
+
+            void stop()
+            {
+                _server->stop();
+            }
+
+            // 协商了压缩的连接上，正文达到该长度的帧才压缩(服务发现响应中的主机列表)，需要在 start 之前设置
+            void setCompressThreshold(size_t bytes)
+            {
+                _server->setCompressThreshold(bytes);
+            }
         
         private:
             void onShutDown(const BaseConnection::s_ptr& conn)
@@ -60,12 +72,14 @@ namespace JsonRpc
             //rpc——server端有两套地址信息：
             //  1. rpc服务提供端地址信息--必须是rpc服务器对外访问地址（云服务器---监听地址和访问地址不同）
             //  2. 注册中心服务端地址信息 -- 启用服务注册后，连接注册中心进行服务注册用的
-            RpcServer(const Address &access_addr, bool enableRegistry = false, const Address &registry_server_addr = Address())
+            // thread_num: I/O 线程数量，0 表示单 reactor
+            RpcServer(const Address &access_addr, bool enableRegistry = false, const Address &registry_server_addr = Address(),
+                int thread_num = 0)
                 : _enableRegistry(enableRegistry)
                 , _access_addr(access_addr)
                 , _router(std::make_shared<RpcRouter>())
                 , _dispatcher(std::make_shared<Dispatcher>()) 
-                , _server(ServerFactory::create(access_addr.second))
+                , _server(ServerFactory::create(access_addr.second, thread_num))
             {
                 if (enableRegistry) // 如果启动了服务注册，则实例化注册客户端
                 {
@@ -90,6 +104,11 @@ namespace JsonRpc
                 _server->start();
             }
 
+            void stop()
+            {
+                _server->stop();
+            }
+
             void registerMethod(const ServiceDescriber::s_ptr& service)
             {
                 if (_enableRegistry)
@@ -98,6 +117,36 @@ namespace JsonRpc
                 _router->registerMethod(service);
             }
 
+            // SHARED_POOL 方法使用的共享线程池大小，需要在 registerMethod 之前调用
+            void setSharedThreadNum(int thread_num)
+            {
+                _router->setSharedThreadNum(thread_num);
+            }
+
+            // 自定义 SHARED_POOL 方法使用的执行器，需要在 registerMethod 之前调用
+            void setSharedExecutor(const BaseExecutor::s_ptr& executor)
+            {
+                _router->setSharedExecutor(executor);
+            }
+
+            // 协商了压缩的连接上，正文达到该长度的帧才压缩(rpc 结果)，需要在 start 之前设置
+            void setCompressThreshold(size_t bytes)
+            {
+                _server->setCompressThreshold(bytes);
+            }
+
+            // 超过该长度的响应帧分片发送，不阻塞同一连接上的其它调用，0 表示不分片，需要在 start 之前设置
+            void setChunkSize(size_t bytes)
+            {
+                _server->setChunkSize(bytes);
+            }
+
+            // 每个连接接收方向占用内存的上限，限制单个请求的大小，需要在 start 之前设置
+            void setConnectionMemoryLimit(size_t bytes)
+            {
+                _server->setConnectionMemoryLimit(bytes);
+            }
+
         private:
             bool _enableRegistry;
             Address _access_addr;
@@ -113,10 +162,11 @@ namespace JsonRpc
         public:
             using s_ptr = std::shared_ptr<TopicServer>;
             
-            TopicServer(int port)
+            // thread_num: I/O 线程数量，0 表示单 reactor
+            TopicServer(int port, int thread_num = 0)
                 : _topic_manager(std::make_shared<TopicManager>())
                 , _dispatcher(std::make_shared<Dispatcher>())
-                , _server(ServerFactory::create(port))
+                , _server(ServerFactory::create(port, thread_num))
             {
                 auto topic_cb = std::bind(&TopicManager::onTopicRequest, _topic_manager.get(),
                                     std::placeholders::_1, std::placeholders::_2);
@@ -135,6 +185,122 @@ namespace JsonRpc
             {
                 _server->start();
             }
+
+            void stop()
+            {
+                _server->stop();
+            }
+
+            // 主题分片数量，每个分片一个线程，同一主题的请求只在所属分片中串行处理，需要在 start 之前设置
+            // 0 表示不分片，在连接所在的 I/O 线程中处理
+            void setShardNum(int shard_num)
+            {
+                _topic_manager->setShardNum(shard_num);
+            }
+
+            // 订阅者连接输出缓冲区的高水位，超过后推送消息进入投递队列，需要在 start 之前设置
+            void setHighWaterMark(size_t bytes)
+            {
+                _server->setHighWaterMark(bytes);
+            }
+
+            // 协商了压缩的连接上，正文达到该长度的帧才压缩(推送与批量发布)，需要在 start 之前设置
+            void setCompressThreshold(size_t bytes)
+            {
+                _server->setCompressThreshold(bytes);
+            }
+
+            // 超过该长度的响应帧分片发送，0 表示不分片，需要在 start 之前设置
+            // 推送使用多个连接共享的帧，不分片
+            void setChunkSize(size_t bytes)
+            {
+                _server->setChunkSize(bytes);
+            }
+
+            // 每个连接接收方向占用内存的上限，限制单条发布消息的大小，需要在 start 之前设置
+            void setConnectionMemoryLimit(size_t bytes)
+            {
+                _server->setConnectionMemoryLimit(bytes);
+            }
+
+            // 默认的慢消费者策略
+            void setDefaultPolicy(const DeliveryPolicy& policy)
+            {
+                _topic_manager->setDefaultPolicy(policy);
+            }
+
+            // 指定主题的慢消费者策略
+            void setTopicPolicy(const std::string& topicName, const DeliveryPolicy& policy)
+            {
+                _topic_manager->setTopicPolicy(topicName, policy);
+            }
+
+            // 默认的消息保留策略
+            void setDefaultRetention(const RetentionPolicy& retention)
+            {
+                _topic_manager->setDefaultRetention(retention);
+            }
+
+            // 指定主题的消息保留策略
+            void setTopicRetention(const std::string& topicName, const RetentionPolicy& retention)
+            {
+                _topic_manager->setTopicRetention(topicName, retention);
+            }
+
+            // 指定主题按消息中的子键合并，缓存每个子键的最新值
+            void setTopicKeyed(const std::string& topicName, const KeyedPolicy& keyed)
+            {
+                _topic_manager->setTopicKeyed(topicName, keyed);
+            }
+
+            // 开启持久化存储，恢复目录中已有的主题，需要在 start 之前调用
+            // flush_interval_ms / flush_bytes: 组提交刷盘的时间间隔与字节阈值，持久化主题的发布在刷盘后才响应
+            void setStorage(const std::string& path, int flush_interval_ms = 5, size_t flush_bytes = 1024 * 1024)
+            {
+                _topic_manager->setStore(std::make_shared<TopicStore>(path, flush_interval_ms, flush_bytes));
+            }
+
+            // 使用已创建的持久化存储(例如替换了刷盘函数的存储)，需要在 start 之前调用
+            void setStorage(const TopicStore::s_ptr& store)
+            {
+                _topic_manager->setStore(store);
+            }
+
+            // 默认的持久化策略
+            void setDefaultDurable(const DurablePolicy& durable)
+            {
+                _topic_manager->setDefaultDurable(durable);
+            }
+
+            // 指定主题的持久化策略
+            void setTopicDurable(const std::string& topicName, const DurablePolicy& durable)
+            {
+                _topic_manager->setTopicDurable(topicName, durable);
+            }
+
+            // 各订阅者的积压与丢弃统计
+            std::vector<TopicManager::SubscriberStats> subscriberStats()
+            {
+                return _topic_manager->subscriberStats();
+            }
+
+            // 推送合并: 同一订阅者连接在 linger 时间内的推送打包成一帧发送，需要在 start 之前设置
+            void setCoalescePolicy(const CoalescePolicy& coalesce)
+            {
+                _topic_manager->setCoalescePolicy(coalesce);
+            }
+
+            // 可靠订阅的确认窗口与重发超时
+            void setReliablePolicy(const ReliablePolicy& policy)
+            {
+                _topic_manager->setReliablePolicy(policy);
+            }
+
+            // 各可靠订阅会话的未确认、重发与丢弃统计
+            std::vector<TopicManager::ReliableStats> reliableStats()
+            {
+                return _topic_manager->reliableStats();
+            }
         
         private:
             void onShutDown(const BaseConnection::s_ptr& conn)
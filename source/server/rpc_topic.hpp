@@ -2,8 +2,15 @@
 
 #include "../common/net.hpp"
 #include "../common/message.hpp"
+#include "../common/topic_trie.hpp"
+#include "../common/executor.hpp"
+#include "topic_store.hpp"
 
 #include <vector>
+#include <deque>
+#include <list>
+#include <algorithm>
+#include <chrono>
 #include <unordered_set>
 #include <unordered_map>
 
@@ -11,43 +18,278 @@ namespace JsonRpc
 {
     namespace Server
     {
+        // 慢消费者策略: 订阅者连接积压、投递队列已满时的处理方式
+        enum class SlowPolicy
+        {
+            DROP_OLDEST = 0, // 丢弃队列中最早的消息
+            DROP_NEWEST,     // 丢弃新到达的消息
+            CONFLATE,        // 同一主题在队列中只保留最新一条，队列满时丢弃最早的消息
+            DISCONNECT       // 断开该订阅者连接
+        };
+
+        // 主题的投递策略
+        struct DeliveryPolicy
+        {
+            SlowPolicy policy = SlowPolicy::DROP_OLDEST;
+            size_t max_queue = 1024; // 每个订阅者积压时最多缓存的消息数
+        };
+
+        // 主题消息保留策略，三个上限任意一个超出就淘汰最早的消息，全部为 0 表示不保留
+        struct RetentionPolicy
+        {
+            size_t max_count = 0;  // 最多保留的消息条数
+            size_t max_bytes = 0;  // 最多保留的正文字节数
+            double max_age = 0;    // 最长保留时间(秒)
+
+            bool enabled() const
+            {
+                return max_count > 0 || max_bytes > 0 || max_age > 0;
+            }
+        };
+
+        // 按键合并策略，适用于行情、状态等只关心最新值的主题
+        // key_field 为消息(JSON 对象)中作为子键的顶层字段(字符串或数值)，为空表示不按键合并:
+        //   主题缓存每个子键的最新一条消息，新订阅者订阅后立即收到当前所有子键的最新值
+        //   订阅者积压时，投递队列中同一子键的消息只保留最新一条
+        // 没有该字段的消息照常推送，但不缓存、不合并
+        // max_keys 限制缓存的子键数量，超出时淘汰最久没有更新的子键(LRU)，被淘汰子键的最新值不再发给新订阅者，
+        // 之后该子键再有消息时重新缓存；0 表示不限制，子键来自发布者的消息，不限制时缓存随不同子键的数量无限增长
+        struct KeyedPolicy
+        {
+            std::string key_field;
+            size_t max_keys = 65536; // 最多缓存的子键数
+
+            bool enabled() const
+            {
+                return !key_field.empty();
+            }
+        };
+
+        // 可靠订阅(至少一次)的确认窗口
+        struct ReliablePolicy
+        {
+            size_t window = 256;           // 每个消费者在一个主题上最多同时等待确认的消息数，超出的消息等确认后再发送
+            double redeliver_timeout = 5;  // 发送后超过该时间(秒)仍未确认则重发
+            size_t max_unacked = 65536;    // 每个消费者在一个主题上最多缓存的未确认消息数，超出时丢弃最早的消息
+        };
+
+        // 推送合并策略: 同一订阅者连接在 linger 时间内到达的多条推送打包成一个合并帧，一次写入
+        // 打包只拼接已编码的共享帧，不重新编码；只有一条时照常发送单帧
+        struct CoalescePolicy
+        {
+            bool enabled = false;
+            int linger_us = 0;            // 0: 在连接 I/O 线程的下一轮循环中发送；N: 第一条到达后最多等待 N 微秒
+            size_t max_bytes = 32 * 1024; // 合并帧的最大字节数，累计达到后立即发送，需要小于客户端连接协商的接收内存上限(默认 16MB)
+        };
+
         // 主题管理类
+        // 主题按名称哈希到若干分片，每个分片有独立的主题表与锁
+        // 设置分片数后，每个分片由一个专属线程处理，同一主题的请求(创建、订阅、发布...)只在所属分片的线程中串行执行:
+        //   同一主题的消息保持发布顺序，不同分片之间没有共享锁，可以并行处理
+        // 分片数为 0 时只有一个分片，请求在连接所在的 I/O 线程中直接处理
         class TopicManager
         {
         public:
             using s_ptr = std::shared_ptr<TopicManager>;
 
-            TopicManager() = default;
+            // 订阅者投递统计
+            struct SubscriberStats
+            {
+                BaseConnection::s_ptr conn;
+                size_t lag;         // 投递队列中等待发送的消息数
+                uint64_t delivered; // 已发送的消息数
+                uint64_t dropped;   // 因积压被丢弃的消息数
+            };
+
+            // 可靠订阅会话统计
+            struct ReliableStats
+            {
+                std::string topic;
+                std::string consumer;
+                bool attached;        // 是否绑定了连接
+                size_t unacked;       // 等待确认的消息数
+                uint64_t redelivered; // 超时重发的消息数
+                uint64_t dropped;     // 超出 max_unacked 被丢弃的消息数
+            };
+
+            TopicManager()
+            {
+                _shards.emplace_back(new Shard());
+            }
+
+            // 设置分片数量，需要在 start 之前调用，已有的主题重新分配到新的分片
+            void setShardNum(int shard_num)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                std::vector<std::unique_ptr<Shard>> shards;
+                for (int i = 0; i < std::max(shard_num, 1); i++)
+                {
+                    shards.emplace_back(new Shard());
+                    if (shard_num > 0)
+                        shards.back()->executor = ExecutorFactory::create<ThreadPoolExecutor>("topic-shard-" + std::to_string(i), 1);
+                }
+
+                for (auto& shard : _shards)
+                {
+                    for (auto& it : shard->topics)
+                        shards[std::hash<std::string>()(it.first) % shards.size()]->topics.insert(it);
+                }
+                _shards.swap(shards);
+            }
+
+            // 未单独设置策略的主题使用的默认策略
+            void setDefaultPolicy(const DeliveryPolicy& policy)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _default_policy = policy;
+            }
+
+            // 设置指定主题的投递策略，主题已存在时立即生效
+            void setTopicPolicy(const std::string& topicName, const DeliveryPolicy& policy)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _policies[topicName] = policy;
+
+                auto topic = findTopic(topicName);
+                if (topic)
+                    topic->setPolicy(policy);
+            }
+
+            // 未单独设置保留策略的主题使用的默认策略
+            void setDefaultRetention(const RetentionPolicy& retention)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _default_retention = retention;
+            }
+
+            // 设置指定主题的保留策略，主题已存在时立即生效
+            void setTopicRetention(const std::string& topicName, const RetentionPolicy& retention)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _retentions[topicName] = retention;
+
+                auto topic = findTopic(topicName);
+                if (topic)
+                    topic->setRetention(retention);
+            }
+
+            // 设置指定主题的按键合并策略，主题已存在时立即生效(已缓存的最新值被清空)
+            void setTopicKeyed(const std::string& topicName, const KeyedPolicy& keyed)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _keyeds[topicName] = keyed;
+
+                auto topic = findTopic(topicName);
+                if (topic)
+                    topic->setKeyed(keyed);
+            }
+
+            // 未单独设置持久化策略的主题使用的默认策略，只对之后创建的主题生效
+            void setDefaultDurable(const DurablePolicy& durable)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _default_durable = durable;
+            }
+
+            // 设置指定主题的持久化策略，只对之后创建的主题生效
+            void setTopicDurable(const std::string& topicName, const DurablePolicy& durable)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _durables[topicName] = durable;
+            }
+
+            // 设置持久化存储，并恢复存储中已有的主题
+            void setStore(const TopicStore::s_ptr& store)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                std::atomic_store(&_store, store);
+
+                for (auto& name : store->topics())
+                {
+                    DurablePolicy durable = durablePolicy(name);
+                    durable.durable = true; // 磁盘上已有的主题总是持久化的
+                    auto log = store->open(name, durable);
+                    if (!log)
+                        continue;
+
+                    Shard& shard = shardOf(name);
+                    std::unique_lock<std::mutex> shard_lock(shard.mtx);
+                    shard.topics[name] = makeTopic(name, log);
+                }
+            }
+
+            // 可靠订阅的确认窗口，只对之后建立的可靠订阅生效
+            void setReliablePolicy(const ReliablePolicy& policy)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _reliable_policy = policy;
+            }
+
+            // 推送合并策略，只对之后建立的订阅者连接生效
+            void setCoalescePolicy(const CoalescePolicy& coalesce)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _coalesce = coalesce;
+            }
+
+            // 所有订阅者的投递统计
+            std::vector<SubscriberStats> subscriberStats()
+            {
+                std::vector<SubscriberStats> stats;
+                std::unique_lock<std::mutex> lock(_mtx);
+                for (auto& it : _subscribes)
+                {
+                    auto& sub = it.second;
+                    stats.push_back({ sub->conn(), sub->lag(), sub->delivered(), sub->dropped() });
+                }
+                return stats;
+            }
+
+            // 所有可靠订阅会话的统计
+            std::vector<ReliableStats> reliableStats()
+            {
+                std::vector<ReliableStats> stats;
+                for (auto& shard : _shards)
+                {
+                    std::vector<Topic::s_ptr> topics;
+                    {
+                        std::unique_lock<std::mutex> lock(shard->mtx);
+                        for (auto& it : shard->topics)
+                            topics.push_back(it.second);
+                    }
+
+                    for (auto& topic : topics)
+                    {
+                        Topic::ReliableSnapshot reliables = topic->reliables();
+                        for (auto& it : *reliables)
+                        {
+                            auto& session = it.second;
+                            stats.push_back({ topic->topicName(), session->consumer(), session->subscriber() != nullptr,
+                                session->unacked(), session->redelivered(), session->dropped() });
+                        }
+                    }
+                }
+                return stats;
+            }
 
             void onTopicRequest(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
             {
                 TopicOpType op = msg->topicOpType();
                 I_LOG("收到主题消息，类型 %d!", (int)op);
 
-                bool ret = true;
                 switch(op)
                 {
-                case TopicOpType::TOPIC_CREATE:    // 主题创建
-                    topicCreate(conn, msg);
-                    break;
-                case TopicOpType::TOPIC_REMOVE:    // 主题删除
-                    topicRemove(conn, msg);
-                    break;
-                case TopicOpType::TOPIC_SUBSCRIBE: // 主题订阅
-                    ret = topicSubscribe(conn, msg);
-                    break;
-                case TopicOpType::TOPIC_CANCEL:    // 主题取消订阅
-                    topicCancel(conn, msg);
-                    break;
-                case TopicOpType::TOPIC_PUBLISH:   // 主题消息发布
-                    ret = topicPublish(conn, msg);
-                    break;
-                default:
-                    E_LOG("不存在的主题类型: %d", (int)op);
-                    return errorResponse(conn, msg, RetCode::RCODE_INVALID_OPTYPE);
+                case TopicOpType::TOPIC_PUBLISH_BATCH:   // 批量发布
+                    return topicPublishBatch(conn, msg);
+                case TopicOpType::TOPIC_SUBSCRIBE_BATCH: // 批量订阅
+                    return topicSubscribeBatch(conn, msg);
+                case TopicOpType::TOPIC_CANCEL_BATCH:    // 批量取消订阅
+                    return topicCancelBatch(conn, msg);
+                default: // 单个主题的请求在主题所属的分片中处理
+                    return runInShard(shardIndex(msg->topicKey()), [this, conn, msg]() {
+                        onShardRequest(conn, msg);
+                    });
                 }
-
-                return ret ? topicResponse(conn, msg) : errorResponse(conn, msg, RetCode::RCODE_NOT_FOUND_TOPIC);
             }
 
             void onShutdown(const BaseConnection::s_ptr& conn)
@@ -56,6 +298,7 @@ namespace JsonRpc
                 // 消息订阅者退出: 删除相关数据
                 std::vector<Topic::s_ptr> topics;
                 Subscriber::s_ptr sub;
+                std::vector<std::string> patterns;
                 
                 {
                     std::unique_lock<std::mutex> lock(_mtx);
@@ -64,111 +307,348 @@ namespace JsonRpc
 
                     sub = _subscribes[conn];
                     for (auto& name : sub->topics())
-                        topics.push_back(_topics[name]);
+                    {
+                        auto topic = findTopic(name);
+                        if (topic) // 主题可能已被删除
+                            topics.push_back(topic);
+                    }
+                    patterns = sub->patterns();
 
                     _subscribes.erase(conn);
                 }
 
                 for (auto& topic : topics)
                     topic->removeSubscriber(sub);
+                for (auto& pattern : patterns)
+                    _wildcards->cancel(pattern, sub);
             }
 
         private:
+            // 单个主题的请求，在主题所属分片的线程中执行
+            void onShardRequest(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            {
+                RetCode rcode = RetCode::RCODE_OK;
+                switch(msg->topicOpType())
+                {
+                case TopicOpType::TOPIC_CREATE:    // 主题创建
+                    topicCreate(conn, msg);
+                    break;
+                case TopicOpType::TOPIC_REMOVE:    // 主题删除
+                    topicRemove(conn, msg);
+                    break;
+                case TopicOpType::TOPIC_SUBSCRIBE: // 主题订阅
+                    rcode = subscribe(conn, msg->topicKey(), msg);
+                    break;
+                case TopicOpType::TOPIC_CANCEL:    // 主题取消订阅
+                    cancel(conn, msg->topicKey());
+                    break;
+                case TopicOpType::TOPIC_PUBLISH:   // 主题消息发布，由 topicPublish 响应
+                    return topicPublish(conn, msg);
+                case TopicOpType::TOPIC_ACK:       // 可靠订阅的确认，成功时不响应
+                    rcode = topicAck(conn, msg);
+                    if (rcode == RetCode::RCODE_OK)
+                        return;
+                    break;
+                default:
+                    E_LOG("不存在的主题类型: %d", (int)msg->topicOpType());
+                    return errorResponse(conn, msg, RetCode::RCODE_INVALID_OPTYPE);
+                }
+
+                return rcode == RetCode::RCODE_OK ? topicResponse(conn, msg) : errorResponse(conn, msg, rcode);
+            }
+
             // 主题创建
             void topicCreate(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
             {
-                std::unique_lock<std::mutex> lock(_mtx);
-                auto topic = std::make_shared<Topic>(msg->topicKey());
-                _topics.emplace(msg->topicKey(), topic);
+                const std::string& topicName = msg->topicKey();
+                std::unique_lock<std::mutex> lock(_mtx); // 保护各主题的策略
+                Shard& shard = shardOf(topicName);
+                std::unique_lock<std::mutex> shard_lock(shard.mtx);
+                if (shard.topics.count(topicName)) // 主题已存在(包括从存储中恢复的主题)
+                    return;
+
+                TopicLog::s_ptr log;
+                DurablePolicy durable = durablePolicy(topicName);
+                TopicStore::s_ptr store = std::atomic_load(&_store);
+                if (durable.durable && store)
+                {
+                    log = store->open(topicName, durable);
+                    if (!log)
+                        E_LOG("主题 %s 无法持久化，以非持久化方式创建!", topicName.c_str());
+                }
+
+                shard.topics.emplace(topicName, makeTopic(topicName, log));
             }
 
             // 主题删除
             void topicRemove(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
             {
                 const std::string& topicName = msg->topicKey();
-                std::unordered_set<Subscriber::s_ptr> subs;
+                Topic::SubscriberSet subs;
 
                 {
-                    std::unique_lock<std::mutex> lock(_mtx);
-                    if (_topics.count(topicName) == 0)
+                    Shard& shard = shardOf(topicName);
+                    std::unique_lock<std::mutex> lock(shard.mtx);
+                    auto it = shard.topics.find(topicName);
+                    if (it == shard.topics.end())
                         return;
 
                     // 删获取该主题的所有订阅者
-                    subs = _topics[topicName]->subscribers();
+                    subs = it->second->subscribers();
 
-                    // 删除主题
-                    _topics.erase(topicName);
+                    // 删除主题，持久化的主题同时删除日志文件
+                    if (it->second->durable())
+                        std::atomic_load(&_store)->remove(topicName);
+                    shard.topics.erase(it);
                 }
 
                 for (auto& sub : subs) // 每个 sub 本身删除，不需要manager的mutex保护，减少锁的占用时间
                     sub->removeTopic(topicName); // 取消订阅
             }
 
-            // 主题订阅
-            bool topicSubscribe(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            // 主题订阅，通配符模式不要求主题已存在，之后创建的匹配主题同样生效
+            // req 中带有回放参数时回放保留的消息，带有过滤条件时只推送满足条件的消息(只对精确订阅有效)
+            // req 中带有组名时加入该主题的共享订阅组，组内成员分担消息
+            // req 为可靠订阅时按消费者标识建立(或续订)确认会话，续订时重发所有未确认的消息
+            RetCode subscribe(const BaseConnection::s_ptr& conn, const std::string& topicName, const TopicRequest::s_ptr& req)
             {
-                const std::string& topicName = msg->topicKey();
+                bool pattern = TopicTrie<Subscriber::s_ptr>::isPattern(topicName);
                 // 获取主题对象和订阅者对象
                 Topic::s_ptr topic;
                 Subscriber::s_ptr subscriber;
 
+                // 过滤条件在订阅时编译一次
+                std::string group = req->group();
+                TopicFilter::s_ptr filter;
+                if (req->hasFilter())
+                {
+                    filter = TopicFilter::compile(req->filter());
+                    if (!filter || pattern || !group.empty())
+                    {
+                        E_LOG("%s 订阅的过滤条件无效(通配符订阅与共享订阅不支持过滤)!", topicName.c_str());
+                        return RetCode::RCODE_INVALID_MSG;
+                    }
+                }
+
+                if (pattern && !group.empty())
+                {
+                    E_LOG("%s 通配符模式不支持共享订阅!", topicName.c_str());
+                    return RetCode::RCODE_INVALID_MSG;
+                }
+
+                bool reliable = req->reliable();
+                if (reliable && (pattern || !group.empty() || filter))
+                {
+                    E_LOG("%s 可靠订阅只支持精确订阅，不支持通配符、共享订阅与过滤!", topicName.c_str());
+                    return RetCode::RCODE_INVALID_MSG;
+                }
+
+                if (!pattern)
+                {
+                    topic = findTopic(topicName);
+                    if (!topic)
+                        return RetCode::RCODE_NOT_FOUND_TOPIC;
+                }
+
+                ReliablePolicy reliable_policy;
                 {
                     std::unique_lock<std::mutex> lock(_mtx);
-                    if (_topics.count(topicName) == 0)
-                        return false;
+                    if (!conn->connected()) // 分片线程中处理时，连接可能已经断开并清理过
+                        return RetCode::RCODE_DISCONNECTED;
 
-                    topic = _topics[topicName];
+                    reliable_policy = _reliable_policy;
 
                     if (_subscribes.count(conn) == 0) // 第一次进行订阅
-                        _subscribes.emplace(conn, std::make_shared<Subscriber>(conn));
+                    {
+                        auto sub = std::make_shared<Subscriber>(conn, _coalesce);
+                        std::weak_ptr<Subscriber> weak_sub = sub;
+                        conn->setDrainCallback([weak_sub]() { // 连接写空后补发积压的消息
+                            auto sub = weak_sub.lock();
+                            if (sub) sub->onDrain();
+                        });
+                        _subscribes.emplace(conn, sub);
+                    }
 
                     subscriber = _subscribes[conn];
                 }
 
-                // 订阅添加主题， 主题添加订阅
-                topic->appendSubscriber(subscriber);
+                if (pattern)
+                {
+                    subscriber->appendPattern(topicName);
+                    _wildcards->subscribe(topicName, subscriber);
+                    if (!conn->connected())
+                        _wildcards->cancel(topicName, subscriber);
+                    return RetCode::RCODE_OK;
+                }
+
+                // 订阅添加主题， 主题添加订阅(并按请求回放保留的消息)
                 subscriber->appendTopic(topicName);
-                return true;
+                if (reliable)
+                    topic->attachReliable(subscriber, req->consumer(), reliable_policy);
+                else if (!group.empty())
+                    topic->joinGroup(subscriber, group, req->groupBalance());
+                else
+                    topic->appendSubscriber(subscriber, req, filter);
+                if (!conn->connected()) // 与 onShutdown 并发时，补做清理
+                    topic->removeSubscriber(subscriber);
+                return RetCode::RCODE_OK;
             }
 
-            // 取消订阅
-            void topicCancel(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            // 取消订阅，同时退出该主题上的所有共享订阅组，并关闭该连接上的可靠订阅会话(丢弃未确认的消息)
+            void cancel(const BaseConnection::s_ptr& conn, const std::string& topicName)
             {
-                const std::string& topicName = msg->topicKey();
+                bool pattern = TopicTrie<Subscriber::s_ptr>::isPattern(topicName);
                 // 获取主题对象和订阅者对象
                 Topic::s_ptr topic;
                 Subscriber::s_ptr subscriber;
 
                 {
                     std::unique_lock<std::mutex> lock(_mtx);
-                    if (_topics.count(topicName) == 0        // 没有主题
-                            || _subscribes.count(conn) == 0) // 没有订阅
+                    if (_subscribes.count(conn) == 0) // 没有订阅
                         return;
-
-                    topic = _topics[topicName];
                     subscriber = _subscribes[conn];
                 }
 
+                if (!pattern)
+                {
+                    topic = findTopic(topicName);
+                    if (!topic) // 没有主题
+                        return;
+                }
+
+                if (pattern)
+                {
+                    _wildcards->cancel(topicName, subscriber);
+                    subscriber->removePattern(topicName);
+                    return;
+                }
+
                 // 订阅删除主题， 主题删除订阅
+                topic->closeReliable(subscriber);
                 topic->removeSubscriber(subscriber);
                 subscriber->removeTopic(topicName);
             }
 
+            // 可靠订阅的累计确认，只接受会话当前绑定的连接发来的确认
+            RetCode topicAck(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            {
+                Topic::s_ptr topic = findTopic(msg->topicKey());
+                if (!topic)
+                    return RetCode::RCODE_NOT_FOUND_TOPIC;
+
+                Subscriber::s_ptr sub;
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    auto it = _subscribes.find(conn);
+                    if (it == _subscribes.end())
+                        return RetCode::RCODE_INVALID_MSG;
+                    sub = it->second;
+                }
+                return topic->ack(msg->consumer(), msg->ackSeq(), sub);
+            }
+
             // 主题消息发布
-            bool topicPublish(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            void topicPublish(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            {
+                bool durable = false;
+                RetCode rcode = publishMessage(msg, durable);
+                publishResponse(conn, msg, rcode, durable);
+            }
+
+            // 批量发布，一个请求帧中包含多条消息(可以属于不同主题)，只响应一次
+            // 消息按主题分到各分片中发布，全部完成后响应
+            // 其中任意消息发布失败(主题不存在、日志写入失败)时响应其中一个错误码，其余消息照常发布
+            void topicPublishBatch(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            {
+                using Item = std::pair<std::string, std::string>;
+                auto durable = std::make_shared<std::atomic<bool>>(false);
+                auto result = std::make_shared<std::atomic<int>>((int)RetCode::RCODE_OK);
+
+                runSharded(msg->topicBatch(), 
+                    [](const Item& item) -> const std::string& { return item.first; },
+                    [this, msg, durable, result](const Item& item) {
+                        auto pub = MessageFactory::create<TopicRequest>();
+                        pub->setMtype(MType::REQ_TOPIC);
+                        pub->setRid(msg->rid());
+                        pub->setCid(msg->cid());
+                        pub->setTopicKey(item.first);
+                        pub->setTopicOpType(TopicOpType::TOPIC_PUBLISH);
+                        pub->setTopicMsg(item.second);
+
+                        bool is_durable = false;
+                        RetCode rcode = publishMessage(pub, is_durable);
+                        if (rcode != RetCode::RCODE_OK)
+                            *result = (int)rcode;
+                        if (is_durable)
+                            *durable = true;
+                    },
+                    [this, conn, msg, durable, result]() {
+                        publishResponse(conn, msg, (RetCode)result->load(), *durable);
+                    });
+            }
+
+            // 批量订阅，各主题在所属分片中订阅，全部完成后响应，任意主题订阅失败时响应其中一个错误码
+            void topicSubscribeBatch(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            {
+                auto result = std::make_shared<std::atomic<int>>((int)RetCode::RCODE_OK);
+                runSharded(msg->topicKeys(),
+                    [](const std::string& key) -> const std::string& { return key; },
+                    [this, conn, msg, result](const std::string& key) {
+                        RetCode rcode = subscribe(conn, key, msg);
+                        if (rcode != RetCode::RCODE_OK)
+                            *result = (int)rcode;
+                    },
+                    [this, conn, msg, result]() {
+                        RetCode rcode = (RetCode)result->load();
+                        rcode == RetCode::RCODE_OK ? topicResponse(conn, msg) : errorResponse(conn, msg, rcode);
+                    });
+            }
+
+            // 批量取消订阅
+            void topicCancelBatch(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg)
+            {
+                runSharded(msg->topicKeys(),
+                    [](const std::string& key) -> const std::string& { return key; },
+                    [this, conn](const std::string& key) { cancel(conn, key); },
+                    [this, conn, msg]() { topicResponse(conn, msg); });
+            }
+
+            // 推送一条消息，durable 记录是否写入了持久化的主题
+            // 主题不存在返回 RCODE_NOT_FOUND_TOPIC，持久化日志写入失败返回 RCODE_INHTERNAL_ERROR(消息不推送)
+            RetCode publishMessage(const TopicRequest::s_ptr& msg, bool& durable)
             {
                 const std::string& topicName = msg->topicKey();
-                Topic::s_ptr topic;
+                Topic::s_ptr topic = findTopic(topicName);
+                if (!topic)
+                    return RetCode::RCODE_NOT_FOUND_TOPIC;
+
+                if (!topic->pushMessage(msg))
+                    return RetCode::RCODE_INHTERNAL_ERROR;
+                if (topic->durable())
                 {
-                    std::unique_lock<std::mutex> lock(_mtx);
-                    if (_topics.count(topicName) == 0)
-                        return false;
+                    std::atomic_load(&_store)->written(msg->rawBody().size());
+                    durable = true;
+                }
+                return RetCode::RCODE_OK;
+            }
 
-                    topic = _topics[topicName];
+            // 发布的响应: no_ack 的请求不响应，持久化的主题在消息刷盘(组提交)之后才响应发布者，刷盘失败时响应 RCODE_INHTERNAL_ERROR
+            void publishResponse(const BaseConnection::s_ptr& conn, const TopicRequest::s_ptr& msg, RetCode rcode, bool durable)
+            {
+                if (msg->noAck())
+                {
+                    if (rcode != RetCode::RCODE_OK)
+                        E_LOG("%s 主题发布失败: %s!", msg->topicKey().c_str(), errReason(rcode).c_str());
+                    return;
                 }
 
-                topic->pushMessage(msg);
-                return true;
+                if (!durable)
+                    return rcode == RetCode::RCODE_OK ? topicResponse(conn, msg) : errorResponse(conn, msg, rcode);
+
+                std::atomic_load(&_store)->onCommit([this, conn, msg, rcode](bool ok) {
+                    RetCode ret = (rcode == RetCode::RCODE_OK && !ok) ? RetCode::RCODE_INHTERNAL_ERROR : rcode; // 刷盘失败
+                    ret == RetCode::RCODE_OK ? topicResponse(conn, msg) : errorResponse(conn, msg, ret);
+                });
             }
 
             // 发生错误的响应
@@ -176,6 +656,7 @@ namespace JsonRpc
             {
                 TopicResponse::s_ptr msg_rsp = MessageFactory::create<TopicResponse>();
                 msg_rsp->setRid(msg->rid());
+                msg_rsp->setCid(msg->cid());
                 msg_rsp->setMtype(MType::RSP_TOPIC);
                 msg_rsp->setRcode(rcode);
                 conn->send(msg_rsp);
@@ -186,6 +667,7 @@ namespace JsonRpc
             {
                 TopicResponse::s_ptr msg_rsp = MessageFactory::create<TopicResponse>();
                 msg_rsp->setRid(msg->rid());
+                msg_rsp->setCid(msg->cid());
                 msg_rsp->setMtype(MType::RSP_TOPIC);
                 msg_rsp->setRcode(RetCode::RCODE_OK);
                 conn->send(msg_rsp);
@@ -193,13 +675,32 @@ namespace JsonRpc
 
         private:
             // 订阅者描述类
-            class Subscriber 
+            // 连接输出缓冲区积压(超过高水位)时，推送的消息先进入有界投递队列，按主题策略处理溢出
+            // 连接写空后，在 I/O 线程中把队列中的消息补发出去
+            // 开启推送合并时，未积压的消息先进入合并批次，由 I/O 线程在 linger 到期后打包发送，补发积压的消息时同样打包
+            class Subscriber : public std::enable_shared_from_this<Subscriber>
             {
             public:
                 using s_ptr = std::shared_ptr<Subscriber>;
 
-                Subscriber(const BaseConnection::s_ptr& conn)
+                // 一条待投递的消息
+                struct Pending
+                {
+                    std::string key;         // 积压时合并使用的键: 普通主题为主题名称，按键合并的主题为 主题名称 + 子键
+                    SharedFrame frame;
+                    std::string group;       // 共享订阅组的标识，普通订阅为空
+                    TopicRequest::s_ptr msg; // 共享订阅的消息，成员离开时重新分配给组内其它成员
+                    bool conflate = false;   // 入队时是否登记在合并键索引中
+                };
+
+                Subscriber(const BaseConnection::s_ptr& conn, const CoalescePolicy& coalesce = CoalescePolicy())
                     : _conn(conn)
+                    , _coalesce(coalesce)
+                    , _batch_bytes(0)
+                    , _flush_pending(false)
+                    , _queued(0)
+                    , _delivered(0)
+                    , _dropped(0)
                 {}
 
                 BaseConnection::s_ptr& conn()
@@ -207,8 +708,9 @@ namespace JsonRpc
                     return _conn;
                 }
 
-                std::unordered_set<std::string>& topics()
+                std::unordered_set<std::string> topics()
                 {
+                    std::unique_lock<std::mutex> lock(_mtx);
                     return _topics;
                 }
 
@@ -226,64 +728,1414 @@ namespace JsonRpc
                     _topics.erase(topic);
                 }
 
-            private:
-                std::mutex _mtx;
-                BaseConnection::s_ptr _conn;
-                std::unordered_set<std::string> _topics; // 订阅者订阅的主题
-            };  
-            
-            // 主题类
-            class Topic
-            {
-            public:
-                using s_ptr = std::shared_ptr<Topic>;
+                std::vector<std::string> patterns()
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    return std::vector<std::string>(_patterns.begin(), _patterns.end());
+                }
 
-                Topic(const std::string& name)
-                    : _name(name)
-                {}
+                // 订阅通配符模式
+                void appendPattern(const std::string& pattern)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    _patterns.insert(pattern);
+                }
 
-                std::string& topicName()
+                void removePattern(const std::string& pattern)
                 {
-                    return _name;
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    _patterns.erase(pattern);
+                }
+
+                // 投递消息，任意线程调用
+                // keyed 为 true 时无论主题的慢消费者策略如何，队列中同一个键都只保留最新一条
+                void deliver(Pending item, const DeliveryPolicy& policy, bool keyed = false)
+                {
+                    std::unique_lock<std::mutex> lock(_queue_mtx);
+                    if (_queue.empty() && !_conn->congested()) // 没有积压，直接发送
+                    {
+                        sendFrame(item.frame);
+                        _delivered++;
+                        return;
+                    }
+
+                    enqueue(std::move(item), policy, keyed || policy.policy == SlowPolicy::CONFLATE);
                 }
 
-                std::unordered_set<Subscriber::s_ptr>& subscribers()
+                // 不经过投递队列发送(可靠订阅自行控制窗口)，开启推送合并时同样进入合并批次
+                void send(const SharedFrame& frame)
                 {
-                    return _subscribers;
+                    std::unique_lock<std::mutex> lock(_queue_mtx);
+                    sendFrame(frame);
                 }
 
-                // 订阅主题
-                void appendSubscriber(const Subscriber::s_ptr& sub)
+                // 取出队列中尚未发送的共享订阅消息，成员离开共享订阅组时调用
+                std::vector<TopicRequest::s_ptr> takeGroupPending(const std::string& group)
                 {
-                    std::unique_lock<std::mutex> lock(_mtx);
-                    _subscribers.insert(sub);
+                    std::vector<TopicRequest::s_ptr> msgs;
+                    std::unique_lock<std::mutex> lock(_queue_mtx);
+                    std::deque<Pending> rest;
+                    for (auto& item : _queue)
+                    {
+                        if (item.group == group)
+                            msgs.push_back(item.msg);
+                        else
+                            rest.push_back(std::move(item));
+                    }
+
+                    if (msgs.empty())
+                        return msgs;
+
+                    // 重建合并键索引，只登记入队时可合并的消息
+                    _queue.swap(rest);
+                    _pending_keys.clear();
+                    _popped = 0;
+                    for (size_t i = 0; i < _queue.size(); i++)
+                    {
+                        if (_queue[i].conflate)
+                            _pending_keys[pendingKey(_queue[i])] = i;
+                    }
+                    _queued.store(_queue.size(), std::memory_order_relaxed);
+                    return msgs;
                 }
 
-                // 取消订阅
-                void removeSubscriber(const Subscriber::s_ptr& sub)
+                // 连接输出缓冲区写空，在 I/O 线程中补发积压的消息
+                // 队列有界，一次全部写入输出缓冲区，再次超过高水位时新消息重新进入队列
+                void onDrain()
                 {
-                    std::unique_lock<std::mutex> lock(_mtx);
-                    _subscribers.erase(sub);
+                    std::unique_lock<std::mutex> lock(_queue_mtx);
+                    if (!_coalesce.enabled)
+                    {
+                        while (!_queue.empty() && !_conn->congested())
+                        {
+                            _conn->send(_queue.front().frame);
+                            popFront();
+                            _delivered++;
+                        }
+                        return;
+                    }
+
+                    // 合并批次中的消息早于投递队列，先发送
+                    std::vector<SharedFrame> frames;
+                    frames.swap(_batch);
+                    _batch_bytes = 0;
+                    while (!_queue.empty() && !_conn->congested())
+                    {
+                        frames.push_back(_queue.front().frame);
+                        popFront();
+                        _delivered++;
+                    }
+                    sendBundled(frames);
                 }
 
-                // 推送消息
-                void pushMessage(const BaseMessage::s_ptr& msg)
+                // 投递队列中等待发送的消息数，不加锁
+                size_t lag()
                 {
-                    std::unique_lock<std::mutex> lock(_mtx);
-                    for (auto sub : _subscribers) // 遍历所有订阅者
-                        sub->conn()->send(msg);
+                    return _queued.load(std::memory_order_relaxed);
                 }
-            
+
+                uint64_t delivered()
+                {
+                    return _delivered.load(std::memory_order_relaxed);
+                }
+
+                uint64_t dropped()
+                {
+                    return _dropped.load(std::memory_order_relaxed);
+                }
+
             private:
-                std::string _name;
-                std::mutex _mtx;
-                std::unordered_set<Subscriber::s_ptr> _subscribers; // 该主题的订阅者连接
-            };
+                // 未开启推送合并时直接发送，否则加入合并批次，调用方持有 _queue_mtx
+                void sendFrame(const SharedFrame& frame)
+                {
+                    if (!_coalesce.enabled)
+                        return _conn->send(frame);
+
+                    _batch.push_back(frame);
+                    _batch_bytes += frame->size();
+                    if (_batch_bytes >= _coalesce.max_bytes) // 批次已满，立即发送
+                        return flushBatch();
+
+                    if (_flush_pending)
+                        return;
+
+                    _flush_pending = true;
+                    std::weak_ptr<Subscriber> weak_self = shared_from_this();
+                    auto task = [weak_self]() {
+                        auto self = weak_self.lock();
+                        if (!self)
+                            return;
+                        std::unique_lock<std::mutex> lock(self->_queue_mtx);
+                        self->_flush_pending = false;
+                        self->flushBatch();
+                    };
+
+                    if (_coalesce.linger_us > 0)
+                        _conn->runAfter(_coalesce.linger_us / 1e6, task);
+                    else
+                        _conn->queueInLoop(task);
+                }
+
+                // 发送当前合并批次，调用方持有 _queue_mtx
+                void flushBatch()
+                {
+                    if (_batch.empty())
+                        return;
+
+                    std::vector<SharedFrame> frames;
+                    frames.swap(_batch);
+                    _batch_bytes = 0;
+                    sendBundled(frames);
+                }
+
+                // 按 max_bytes 把多个帧分组打包发送，只有一帧的组照常发送单帧
+                void sendBundled(const std::vector<SharedFrame>& frames)
+                {
+                    std::vector<SharedFrame> group;
+                    size_t bytes = 0;
+                    auto emit = [this, &group, &bytes]() {
+                        if (group.size() == 1)
+                            _conn->send(group.front());
+                        else if (group.size() > 1)
+                            _conn->send(_conn->protocol()->bundle(group));
+                        group.clear();
+                        bytes = 0;
+                    };
+
+                    for (auto& frame : frames)
+                    {
+                        if (!group.empty() && bytes + frame->size() > _coalesce.max_bytes)
+                            emit();
+                        group.push_back(frame);
+                        bytes += frame->size();
+                    }
+                    emit();
+                }
+
+                // 连接积压时入队，调用方持有 _queue_mtx
+                // conflate 为 true 时同一个键只保留最新一条，通过 _pending_keys 直接定位，不需要遍历队列
+                void enqueue(Pending item, const DeliveryPolicy& policy, bool conflate)
+                {
+                    item.conflate = conflate;
+                    if (conflate)
+                    {
+                        auto it = _pending_keys.find(pendingKey(item));
+                        if (it != _pending_keys.end())
+                        {
+                            _queue[it->second - _popped] = std::move(item);
+                            _dropped++;
+                            return;
+                        }
+                    }
+
+                    if (_queue.size() >= policy.max_queue)
+                    {
+                        switch (policy.policy)
+                        {
+                        case SlowPolicy::DROP_OLDEST:
+                        case SlowPolicy::CONFLATE:
+                            popFront();
+                            _dropped++;
+                            break;
+                        case SlowPolicy::DROP_NEWEST:
+                            _dropped++;
+                            return;
+                        case SlowPolicy::DISCONNECT:
+                            E_LOG("订阅者积压 %zu 条消息，断开连接!", _queue.size());
+                            _dropped += _queue.size() + 1;
+                            _queue.clear();
+                            _pending_keys.clear();
+                            _popped = 0;
+                            _queued.store(0, std::memory_order_relaxed);
+                            _conn->forceClose(); // 积压的连接无法写空，不能等待 shutdown
+                            return;
+                        }
+                    }
+
+                    if (conflate)
+                        _pending_keys[pendingKey(item)] = _popped + _queue.size();
+                    _queue.push_back(std::move(item));
+                    _queued.store(_queue.size(), std::memory_order_relaxed);
+                }
+
+                // 合并键索引中的键: 共享订阅组的消息与普通消息、不同组的消息各自合并，互不覆盖
+                // 以组标识的长度作前缀，组标识与键中含有任何字符都不会冲突
+                static std::string pendingKey(const Pending& item)
+                {
+                    std::string key = std::to_string(item.group.size());
+                    key.push_back(':');
+                    key.append(item.group).append(item.key);
+                    return key;
+                }
+
+                // 移除队头的消息，调用方持有 _queue_mtx
+                void popFront()
+                {
+                    if (_queue.front().conflate)
+                    {
+                        auto it = _pending_keys.find(pendingKey(_queue.front()));
+                        if (it != _pending_keys.end() && it->second == _popped)
+                            _pending_keys.erase(it);
+                    }
+                    _queue.pop_front();
+                    _popped++;
+                    _queued.store(_queue.size(), std::memory_order_relaxed);
+                }
+
+            private:
+                std::mutex _mtx;
+                BaseConnection::s_ptr _conn;
+                std::unordered_set<std::string> _topics; // 订阅者订阅的主题
+                std::unordered_set<std::string> _patterns; // 订阅者订阅的通配符模式
+
+                CoalescePolicy _coalesce;
+                std::mutex _queue_mtx; // 保护投递队列与合并批次
+                std::vector<SharedFrame> _batch; // 等待合并发送的帧
+                size_t _batch_bytes;
+                bool _flush_pending; // 合并批次的发送任务已投递到 I/O 线程
+                std::deque<Pending> _queue; // 积压时的投递队列
+                std::unordered_map<std::string, uint64_t> _pending_keys; // 可合并的键(见 pendingKey) -> 在队列中的绝对位置
+                uint64_t _popped = 0; // 累计出队的消息数，绝对位置减去该值即为队列下标
+                std::atomic<size_t> _queued; // 队列长度，供共享订阅组无锁读取
+                std::atomic<uint64_t> _delivered;
+                std::atomic<uint64_t> _dropped;
+            };  
+            
+            // 通配符订阅索引，所有主题共享
+            // 订阅变更时版本号加一，主题在推送时比较版本号，只有变化后才重新匹配并缓存结果
+            class WildcardIndex
+            {
+            public:
+                using s_ptr = std::shared_ptr<WildcardIndex>;
+                using Matched = std::shared_ptr<const std::vector<Subscriber::s_ptr>>;
+
+                WildcardIndex()
+                    : _version(0)
+                {}
+
+                void subscribe(const std::string& pattern, const Subscriber::s_ptr& sub)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    if (_trie.insert(pattern, sub))
+                        _version.fetch_add(1);
+                }
+
+                void cancel(const std::string& pattern, const Subscriber::s_ptr& sub)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    if (_trie.remove(pattern, sub))
+                        _version.fetch_add(1);
+                }
+
+                uint64_t version()
+                {
+                    return _version.load();
+                }
+
+                // 匹配主题的订阅者(已去重)，耗时与主题的层数成正比
+                Matched match(const std::string& topic)
+                {
+                    auto subs = std::make_shared<std::vector<Subscriber::s_ptr>>();
+                    {
+                        std::unique_lock<std::mutex> lock(_mtx);
+                        if (_trie.size() == 0)
+                            return subs;
+                        _trie.match(topic, *subs);
+                    }
+
+                    std::sort(subs->begin(), subs->end());
+                    subs->erase(std::unique(subs->begin(), subs->end()), subs->end());
+                    return subs;
+                }
+
+            private:
+                std::mutex _mtx;
+                TopicTrie<Subscriber::s_ptr> _trie;
+                std::atomic<uint64_t> _version;
+            };
+
+            // 共享订阅组: 以同一组名订阅同一主题的连接分担该主题的消息，每条消息只投递给组内一个成员
+            // 成员列表为只读快照，选择成员时不加锁
+            //   轮询: 原子游标依次选择
+            //   积压最少: 选择投递队列最短的成员，长度相同时从轮询位置开始的第一个
+            // 已断开的成员在 onShutdown 清理之前就不再被选择
+            class ConsumerGroup
+            {
+            public:
+                using s_ptr = std::shared_ptr<ConsumerGroup>;
+                using Members = std::shared_ptr<const std::vector<Subscriber::s_ptr>>;
+
+                ConsumerGroup(const std::string& topic, const std::string& name, GroupBalance balance)
+                    : _name(name)
+                    , _tag(topic + '\0' + name)
+                    , _balance(balance)
+                    , _members(std::make_shared<const std::vector<Subscriber::s_ptr>>())
+                    , _next(0)
+                {}
+
+                const std::string& name()
+                {
+                    return _name;
+                }
+
+                // 组的唯一标识(主题名称 + 组名)，用于区分投递队列中属于该组的消息
+                const std::string& tag()
+                {
+                    return _tag;
+                }
+
+                // 加入组，已是成员时返回 false，调用方负责串行化成员变更
+                bool join(const Subscriber::s_ptr& sub)
+                {
+                    Members cur = std::atomic_load(&_members);
+                    if (std::find(cur->begin(), cur->end(), sub) != cur->end())
+                        return false;
+
+                    auto members = std::make_shared<std::vector<Subscriber::s_ptr>>(*cur);
+                    members->push_back(sub);
+                    std::atomic_store(&_members, Members(std::move(members)));
+                    return true;
+                }
+
+                // 离开组，不是成员时返回 false，调用方负责串行化成员变更
+                bool leave(const Subscriber::s_ptr& sub)
+                {
+                    Members cur = std::atomic_load(&_members);
+                    auto it = std::find(cur->begin(), cur->end(), sub);
+                    if (it == cur->end())
+                        return false;
+
+                    auto members = std::make_shared<std::vector<Subscriber::s_ptr>>(*cur);
+                    members->erase(members->begin() + (it - cur->begin()));
+                    std::atomic_store(&_members, Members(std::move(members)));
+                    return true;
+                }
+
+                bool empty()
+                {
+                    return std::atomic_load(&_members)->empty();
+                }
+
+                Members members()
+                {
+                    return std::atomic_load(&_members);
+                }
+
+                // 选择接收下一条消息的成员，没有可用成员时返回 nullptr
+                Subscriber::s_ptr pick()
+                {
+                    Members members = std::atomic_load(&_members);
+                    size_t num = members->size();
+                    if (num == 0)
+                        return Subscriber::s_ptr();
+
+                    size_t start = _next.fetch_add(1, std::memory_order_relaxed);
+                    Subscriber::s_ptr best;
+                    size_t best_lag = SIZE_MAX;
+                    for (size_t i = 0; i < num; i++)
+                    {
+                        const Subscriber::s_ptr& sub = (*members)[(start + i) % num];
+                        if (!sub->conn()->connected())
+                            continue;
+                        if (_balance == GroupBalance::GROUP_ROUND_ROBIN)
+                            return sub;
+
+                        size_t lag = sub->lag();
+                        if (lag < best_lag)
+                        {
+                            best = sub;
+                            best_lag = lag;
+                            if (lag == 0)
+                                break;
+                        }
+                    }
+                    return best;
+                }
+
+            private:
+                std::string _name;
+                std::string _tag;
+                GroupBalance _balance;
+                Members _members; // 只通过 atomic_load/atomic_store 访问
+                std::atomic<size_t> _next; // 轮询游标
+            };
+
+            // 可靠订阅会话: 一个消费者在一个主题上的未确认消息窗口
+            // 会话以消费者标识区分，连接断开后保留，同一标识重新订阅时绑定新连接，并按序号重发全部未确认的消息
+            // 消息在主题的 _retain_mtx 下按序号递增进入队列，队列前 window 条已发送、等待确认，其余的等确认后再发送
+            // 确认是累计的: 收到序号 N 的确认即删除 N 及之前的消息，一次确认可以覆盖一批消息
+            // 已发送超过 redeliver_timeout 仍未确认的消息，由绑定连接 I/O 线程中的定时器重发
+            class ReliableSession : public std::enable_shared_from_this<ReliableSession>
+            {
+            public:
+                using s_ptr = std::shared_ptr<ReliableSession>;
+
+                ReliableSession(const std::string& topic, const std::string& consumer, const ReliablePolicy& policy)
+                    : _topic(topic)
+                    , _consumer(consumer)
+                    , _policy(policy)
+                    , _inflight(0)
+                    , _redelivered(0)
+                    , _dropped(0)
+                {}
+
+                const std::string& consumer()
+                {
+                    return _consumer;
+                }
+
+                // 当前绑定的订阅者，连接断开后为空
+                Subscriber::s_ptr subscriber()
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    return _sub;
+                }
+
+                // 绑定订阅者连接，重发所有未确认的消息，首次绑定该连接时启动重发定时器
+                void attach(const Subscriber::s_ptr& sub)
+                {
+                    bool rebind;
+                    {
+                        std::unique_lock<std::mutex> lock(_mtx);
+                        rebind = _sub != sub;
+                        _sub = sub;
+                        if (!_pending.empty())
+                            I_LOG("主题 %s 消费者 %s 续订，重发 %zu 条未确认的消息!", _topic.c_str(), _consumer.c_str(), _pending.size());
+                        _inflight = 0;
+                        flush(std::chrono::steady_clock::now());
+                    }
+
+                    if (rebind)
+                        schedule(sub);
+                }
+
+                // 解除与订阅者连接的绑定，未确认的消息继续保留
+                bool detach(const Subscriber::s_ptr& sub)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    if (_sub != sub)
+                        return false;
+                    _sub.reset();
+                    _inflight = 0;
+                    return true;
+                }
+
+                // 追加一条已写入序号的消息，调用方持有主题的 _retain_mtx，保证序号递增
+                void push(const TopicRequest::s_ptr& msg, const SharedFrame& frame, const BaseProtocol::s_ptr& proto)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    if (_pending.size() >= _policy.max_unacked)
+                    {
+                        E_LOG("主题 %s 消费者 %s 未确认的消息超过 %zu 条，丢弃最早的消息!",
+                            _topic.c_str(), _consumer.c_str(), _policy.max_unacked);
+                        _pending.pop_front();
+                        if (_inflight > 0)
+                            _inflight--;
+                        _dropped++;
+                    }
+
+                    Entry entry;
+                    entry.seq = msg->topicSeq();
+                    entry.msg = msg;
+                    entry.frame = frame;
+                    entry.proto = proto;
+                    _pending.push_back(std::move(entry));
+                    flush(std::chrono::steady_clock::now());
+                }
+
+                // 累计确认: 删除序号不大于 seq 的消息，再发送进入窗口的消息
+                void ack(uint64_t seq)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    while (!_pending.empty() && _pending.front().seq <= seq)
+                    {
+                        _pending.pop_front();
+                        if (_inflight > 0)
+                            _inflight--;
+                    }
+                    flush(std::chrono::steady_clock::now());
+                }
+
+                // 等待确认(含尚未发送)的消息数
+                size_t unacked()
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    return _pending.size();
+                }
+
+                uint64_t redelivered()
+                {
+                    return _redelivered.load(std::memory_order_relaxed);
+                }
+
+                uint64_t dropped()
+                {
+                    return _dropped.load(std::memory_order_relaxed);
+                }
+
+            private:
+                // 一条等待确认的消息
+                struct Entry
+                {
+                    uint64_t seq;
+                    TopicRequest::s_ptr msg;
+                    SharedFrame frame;          // 推送时的编码结果，协议不同时重新编码
+                    BaseProtocol::s_ptr proto;
+                    std::chrono::steady_clock::time_point sent; // 最近一次发送的时间
+                };
+
+                // 发送窗口内尚未发送的消息，调用方持有 _mtx
+                void flush(std::chrono::steady_clock::time_point now)
+                {
+                    if (!_sub)
+                        return;
+
+                    while (_inflight < _pending.size() && _inflight < _policy.window)
+                        send(_pending[_inflight++], now);
+                }
+
+                // 调用方持有 _mtx
+                void send(Entry& entry, std::chrono::steady_clock::time_point now)
+                {
+                    const BaseProtocol::s_ptr& proto = _sub->conn()->protocol();
+                    if (!entry.frame || entry.proto != proto)
+                    {
+                        entry.frame = proto->sharedFrame(entry.msg, true);
+                        entry.proto = proto;
+                    }
+
+                    _sub->send(entry.frame);
+                    entry.sent = now;
+                }
+
+                // 每隔 redeliver_timeout 检查一次超时的消息，会话改绑其它连接或解绑后定时器不再继续
+                void schedule(const Subscriber::s_ptr& sub)
+                {
+                    std::weak_ptr<ReliableSession> weak_self = shared_from_this();
+                    sub->conn()->runAfter(_policy.redeliver_timeout, [weak_self, sub]() {
+                        auto self = weak_self.lock();
+                        if (self && self->redeliver(sub))
+                            self->schedule(sub);
+                    });
+                }
+
+                // 重发超时未确认的消息，会话已不再绑定 sub 时返回 false
+                bool redeliver(const Subscriber::s_ptr& sub)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    if (_sub != sub)
+                        return false;
+
+                    auto now = std::chrono::steady_clock::now();
+                    size_t count = 0;
+                    for (size_t i = 0; i < _inflight; i++)
+                    {
+                        if (std::chrono::duration<double>(now - _pending[i].sent).count() < _policy.redeliver_timeout)
+                            continue;
+                        send(_pending[i], now);
+                        count++;
+                    }
+
+                    if (count > 0)
+                    {
+                        _redelivered += count;
+                        I_LOG("主题 %s 消费者 %s 重发 %zu 条超时未确认的消息!", _topic.c_str(), _consumer.c_str(), count);
+                    }
+                    return true;
+                }
+
+            private:
+                std::string _topic;
+                std::string _consumer;
+                ReliablePolicy _policy;
+
+                std::mutex _mtx;
+                Subscriber::s_ptr _sub;     // 绑定的订阅者，连接断开后为空
+                std::deque<Entry> _pending; // 未确认的消息，按序号递增
+                size_t _inflight;           // _pending 中前 _inflight 条已发送
+                std::atomic<uint64_t> _redelivered;
+                std::atomic<uint64_t> _dropped;
+            };
+
+            // 主题类
+            // 订阅者集合为只读快照(copy-on-write):
+            //   订阅/取消订阅: 在 _mtx 保护下复制一份新集合修改，再原子替换快照
+            //   推送消息: 原子读取当前快照后遍历，不持有任何锁，订阅变更不会阻塞推送，多个发布者可以并发推送
+            // 推送过程中取消订阅的连接，仍可能收到该次推送中的消息
+            //
+            // 每条发布的消息分配一个递增序号，开启保留时:
+            //   消息写入序号后重新编码一次，保存到保留队列，订阅时可以从指定序号或最近 K 条开始回放
+            //   _retain_mtx 使 "分配序号 + 保留 + 读取订阅者快照" 与 "加入订阅者 + 回放" 互斥，回放与实时推送之间不丢不重
+            // 未开启保留且没有可靠订阅时不写入序号，发布者的原始正文直接转发
+            // 持久化的主题用磁盘上的段文件代替内存中的保留队列，回放直接读取映射内存
+            // 通配符订阅者按 WildcardIndex 的版本号缓存，与精确订阅者合并去重后投递
+            // 订阅者的过滤条件同样以只读快照保存，只有存在过滤条件时才解析消息内容，每条消息最多解析一次
+            // 按键合并的主题在 _retain_mtx 下更新每个子键的最新值，新订阅者加入后立即收到最新值快照
+            // 共享订阅组不在订阅者集合中，每条消息在普通订阅者之外，再为每个组选择一个成员投递
+            // 存在可靠订阅会话时，每条消息同样写入序号，并在 _retain_mtx 下按序号顺序追加到各会话的确认窗口
+            class Topic
+            {
+            public:
+                using s_ptr = std::shared_ptr<Topic>;
+                using SubscriberSet = std::unordered_set<Subscriber::s_ptr>;
+                using Snapshot = std::shared_ptr<const SubscriberSet>;
+                using FilterMap = std::unordered_map<Subscriber::s_ptr, TopicFilter::s_ptr>;
+                using FilterSnapshot = std::shared_ptr<const FilterMap>;
+                using GroupMap = std::unordered_map<std::string, ConsumerGroup::s_ptr>;
+                using GroupSnapshot = std::shared_ptr<const GroupMap>;
+                using ReliableMap = std::unordered_map<std::string, ReliableSession::s_ptr>;
+                using ReliableSnapshot = std::shared_ptr<const ReliableMap>;
+
+                Topic(const std::string& name, const DeliveryPolicy& policy, const RetentionPolicy& retention, 
+                    const KeyedPolicy& keyed, const TopicLog::s_ptr& log, const WildcardIndex::s_ptr& wildcards)
+                    : _name(name)
+                    , _subscribers(std::make_shared<const SubscriberSet>())
+                    , _filters(std::make_shared<const FilterMap>())
+                    , _groups(std::make_shared<const GroupMap>())
+                    , _reliables(std::make_shared<const ReliableMap>())
+                    , _policy(std::make_shared<const DeliveryPolicy>(policy))
+                    , _retain_enabled(retention.enabled() || log || keyed.enabled())
+                    , _retention(retention)
+                    , _seq(log ? log->lastSeq() : 0) // 重启后序号从日志中的最后一条继续
+                    , _retained_bytes(0)
+                    , _log(log)
+                    , _keyed(keyed)
+                    , _wildcards(wildcards)
+                {}
+
+                std::string& topicName()
+                {
+                    return _name;
+                }
+
+                void setPolicy(const DeliveryPolicy& policy)
+                {
+                    std::atomic_store(&_policy, std::make_shared<const DeliveryPolicy>(policy));
+                }
+
+                void setRetention(const RetentionPolicy& retention)
+                {
+                    std::unique_lock<std::mutex> lock(_retain_mtx);
+                    _retention = retention;
+                    _retain_enabled = retention.enabled() || _log || _keyed.enabled();
+                    evict(std::chrono::steady_clock::now());
+                }
+
+                void setKeyed(const KeyedPolicy& keyed)
+                {
+                    std::unique_lock<std::mutex> lock(_retain_mtx);
+                    _keyed = keyed;
+                    _retain_enabled = _retention.enabled() || _log || keyed.enabled();
+                    _last_values.clear();
+                    _lru.clear();
+                }
+
+                bool durable()
+                {
+                    return _log != nullptr;
+                }
+
+                // 当前所有订阅者，包括共享订阅组的成员与可靠订阅会话绑定的连接
+                SubscriberSet subscribers()
+                {
+                    SubscriberSet subs(*std::atomic_load(&_subscribers));
+                    GroupSnapshot groups = std::atomic_load(&_groups);
+                    for (auto& it : *groups)
+                    {
+                        ConsumerGroup::Members members = it.second->members();
+                        subs.insert(members->begin(), members->end());
+                    }
+
+                    ReliableSnapshot reliables = std::atomic_load(&_reliables);
+                    for (auto& it : *reliables)
+                    {
+                        Subscriber::s_ptr sub = it.second->subscriber();
+                        if (sub)
+                            subs.insert(sub);
+                    }
+                    return subs;
+                }
+
+                // 可靠订阅会话
+                ReliableSnapshot reliables()
+                {
+                    return std::atomic_load(&_reliables);
+                }
+
+                // 订阅主题，req 中带有回放参数时先回放保留的消息，按键合并的主题随后发送各子键的最新值
+                // filter 为空表示不过滤，重复订阅时以最后一次的过滤条件为准
+                void appendSubscriber(const Subscriber::s_ptr& sub, const TopicRequest::s_ptr& req, const TopicFilter::s_ptr& filter)
+                {
+                    std::unique_lock<std::mutex> retain_lock(_retain_mtx); // 与发布互斥
+                    {
+                        std::unique_lock<std::mutex> lock(_mtx); // 只串行化订阅变更
+                        FilterSnapshot cur = std::atomic_load(&_filters);
+                        if (filter || cur->count(sub)) // 先更新过滤条件，推送时看到订阅者就一定能看到它的过滤条件
+                        {
+                            auto filters = std::make_shared<FilterMap>(*cur);
+                            if (filter)
+                                (*filters)[sub] = filter;
+                            else
+                                filters->erase(sub);
+                            std::atomic_store(&_filters, FilterSnapshot(std::move(filters)));
+                        }
+
+                        auto subs = std::make_shared<SubscriberSet>(*std::atomic_load(&_subscribers));
+                        subs->insert(sub);
+                        std::atomic_store(&_subscribers, Snapshot(std::move(subs)));
+                    }
+
+                    replay(sub, req->replayFrom(), req->replayLast());
+                    snapshot(sub);
+                }
+
+                // 加入共享订阅组，组不存在时按 balance 创建
+                // 共享订阅不回放历史、不发送最新值快照，组内成员只分担之后发布的消息
+                void joinGroup(const Subscriber::s_ptr& sub, const std::string& name, GroupBalance balance)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    GroupSnapshot cur = std::atomic_load(&_groups);
+                    auto it = cur->find(name);
+                    if (it != cur->end())
+                    {
+                        it->second->join(sub);
+                        return;
+                    }
+
+                    auto group = std::make_shared<ConsumerGroup>(_name, name, balance);
+                    group->join(sub);
+                    auto groups = std::make_shared<GroupMap>(*cur);
+                    groups->emplace(name, group);
+                    std::atomic_store(&_groups, GroupSnapshot(std::move(groups)));
+                }
+
+                // 以消费者标识建立可靠订阅，会话已存在时改绑到 sub 并重发未确认的消息
+                // 与发布互斥: 会话创建之后发布的消息一定写入序号并进入该会话
+                void attachReliable(const Subscriber::s_ptr& sub, const std::string& consumer, const ReliablePolicy& policy)
+                {
+                    std::unique_lock<std::mutex> retain_lock(_retain_mtx);
+                    ReliableSession::s_ptr session;
+                    {
+                        std::unique_lock<std::mutex> lock(_mtx);
+                        ReliableSnapshot cur = std::atomic_load(&_reliables);
+                        auto it = cur->find(consumer);
+                        if (it != cur->end())
+                        {
+                            session = it->second;
+                        }
+                        else
+                        {
+                            session = std::make_shared<ReliableSession>(_name, consumer, policy);
+                            auto reliables = std::make_shared<ReliableMap>(*cur);
+                            reliables->emplace(consumer, session);
+                            std::atomic_store(&_reliables, ReliableSnapshot(std::move(reliables)));
+                        }
+                    }
+
+                    session->attach(sub);
+                }
+
+                // 关闭绑定在 sub 上的可靠订阅会话，丢弃未确认的消息
+                void closeReliable(const Subscriber::s_ptr& sub)
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    ReliableSnapshot cur = std::atomic_load(&_reliables);
+                    std::shared_ptr<ReliableMap> next;
+                    for (auto& it : *cur)
+                    {
+                        if (!it.second->detach(sub))
+                            continue;
+
+                        if (!next)
+                            next = std::make_shared<ReliableMap>(*cur);
+                        next->erase(it.first);
+                    }
+                    if (next)
+                        std::atomic_store(&_reliables, ReliableSnapshot(std::move(next)));
+                }
+
+                // 可靠订阅的累计确认，确认方不是会话当前绑定的订阅者时拒绝
+                RetCode ack(const std::string& consumer, uint64_t seq, const Subscriber::s_ptr& sub)
+                {
+                    ReliableSnapshot reliables = std::atomic_load(&_reliables);
+                    auto it = reliables->find(consumer);
+                    if (it == reliables->end() || it->second->subscriber() != sub)
+                    {
+                        E_LOG("主题 %s 消费者 %s 的确认不是来自当前订阅者，已拒绝!", _name.c_str(), consumer.c_str());
+                        return RetCode::RCODE_INVALID_MSG;
+                    }
+
+                    it->second->ack(seq);
+                    return RetCode::RCODE_OK;
+                }
+
+                // 取消订阅，包括该连接在本主题上的所有共享订阅
+                // 绑定在该连接上的可靠订阅会话只解除绑定，未确认的消息保留到同一消费者续订
+                // 离开共享订阅组的成员，投递队列中尚未发送的组消息重新分配给组内其它成员
+                void removeSubscriber(const Subscriber::s_ptr& sub)
+                {
+                    std::vector<ConsumerGroup::s_ptr> left;
+                    {
+                        std::unique_lock<std::mutex> lock(_mtx);
+                        Snapshot cur = std::atomic_load(&_subscribers);
+                        if (cur->count(sub))
+                        {
+                            auto subs = std::make_shared<SubscriberSet>(*cur);
+                            subs->erase(sub);
+                            std::atomic_store(&_subscribers, Snapshot(std::move(subs)));
+                        }
+
+                        FilterSnapshot filters = std::atomic_load(&_filters);
+                        if (filters->count(sub))
+                        {
+                            auto next = std::make_shared<FilterMap>(*filters);
+                            next->erase(sub);
+                            std::atomic_store(&_filters, FilterSnapshot(std::move(next)));
+                        }
+
+                        GroupSnapshot groups = std::atomic_load(&_groups);
+                        std::shared_ptr<GroupMap> next;
+                        for (auto& it : *groups)
+                        {
+                            if (!it.second->leave(sub))
+                                continue;
+
+                            left.push_back(it.second);
+                            if (it.second->empty()) // 最后一个成员离开，删除该组
+                            {
+                                if (!next)
+                                    next = std::make_shared<GroupMap>(*groups);
+                                next->erase(it.first);
+                            }
+                        }
+                        if (next)
+                            std::atomic_store(&_groups, GroupSnapshot(std::move(next)));
+                    }
+
+                    ReliableSnapshot reliables = std::atomic_load(&_reliables);
+                    for (auto& it : *reliables)
+                        it.second->detach(sub);
+
+                    for (auto& group : left)
+                    {
+                        std::vector<TopicRequest::s_ptr> msgs = sub->takeGroupPending(group->tag());
+                        if (msgs.empty())
+                            continue;
+
+                        I_LOG("主题 %s 共享订阅组 %s 重新分配 %zu 条消息!", _name.c_str(), group->name().c_str(), msgs.size());
+                        for (auto& msg : msgs)
+                        {
+                            Delivery delivery(msg);
+                            deliverGroup(*group, delivery);
+                        }
+                    }
+                }
+
+                // 推送消息
+                // 消息只编码一次(未开启保留时直接复用发布者的原始正文)，所有订阅者连接共享同一份帧数据
+                // 持久化日志写入失败时返回 false，消息不推送，序号不推进
+                bool pushMessage(const TopicRequest::s_ptr& msg)
+                {
+                    Delivery delivery(msg);
+                    Snapshot subs;
+                    if (_retain_enabled.load() || !std::atomic_load(&_reliables)->empty())
+                    {
+                        std::unique_lock<std::mutex> lock(_retain_mtx);
+                        if (!sequence(msg))
+                            return false;
+                        if (_retain_enabled.load())
+                        {
+                            retain(msg);
+                            updateLastValue(delivery);
+                        }
+                        subs = std::atomic_load(&_subscribers);
+                        deliverReliable(delivery);
+                    }
+                    else
+                    {
+                        _seq.fetch_add(1);
+                        subs = std::atomic_load(&_subscribers);
+                    }
+
+                    delivery.filters = std::atomic_load(&_filters); // 在订阅者快照之后读取
+                    deliver(*subs, delivery);
+
+                    WildcardIndex::Matched wild = wildcardSubscribers();
+                    if (!wild->empty())
+                        deliver(*wild, delivery, subs.get()); // 同时精确订阅了该主题的连接只投递一次
+
+                    GroupSnapshot groups = std::atomic_load(&_groups);
+                    for (auto& it : *groups)
+                        deliverGroup(*it.second, delivery);
+                    return true;
+                }
+
+                // 最新消息的序号
+                uint64_t lastSeq()
+                {
+                    return _seq.load();
+                }
+            
+            private:
+                // 一条消息的推送上下文
+                struct Delivery
+                {
+                    Delivery(const TopicRequest::s_ptr& m, const FilterSnapshot& f = FilterSnapshot())
+                        : msg(m), filters(f), keyed(false), parsed(false)
+                    {}
+
+                    // 解析后的消息内容，不是 JSON 时为 null，第一次使用时才解析
+                    const Json::Value& document()
+                    {
+                        if (parsed)
+                            return doc;
+
+                        parsed = true;
+                        if (msg->topicMsg().empty() && !msg->rawBody().empty()) // 从持久化日志回放的消息只有原始正文
+                            msg->unSerialize(msg->rawBody());
+
+                        std::string content = msg->topicMsg();
+                        Json::CharReaderBuilder crb;
+                        std::unique_ptr<Json::CharReader> cr(crb.newCharReader());
+                        std::string errs;
+                        if (!cr->parse(content.data(), content.data() + content.size(), &doc, &errs))
+                            doc = Json::Value();
+                        return doc;
+                    }
+
+                    TopicRequest::s_ptr msg;
+                    std::vector<std::pair<BaseProtocol::s_ptr, SharedFrame>> frames; // 不同协议的连接帧格式不同，按协议缓存编码结果
+                    FilterSnapshot filters;
+                    bool keyed;       // 是否按子键合并
+                    std::string key;  // 积压时合并使用的键，keyed 为 false 时不使用
+                    bool parsed;
+                    Json::Value doc;
+                };
+
+                // 订阅者是否接收该消息，不是 JSON 的消息不满足任何过滤条件
+                bool accept(Delivery& delivery, const Subscriber::s_ptr& sub)
+                {
+                    if (delivery.filters->empty())
+                        return true;
+
+                    auto it = delivery.filters->find(sub);
+                    if (it == delivery.filters->end())
+                        return true;
+
+                    return it->second->match(delivery.document());
+                }
+
+                // 按键合并的主题更新子键的最新值，并设置推送时的合并键，调用方持有 _retain_mtx
+                void updateLastValue(Delivery& delivery)
+                {
+                    if (!_keyed.enabled())
+                        return;
+
+                    const Json::Value& doc = delivery.document();
+                    if (!doc.isObject() || !doc.isMember(_keyed.key_field))
+                        return;
+
+                    const Json::Value& value = doc[_keyed.key_field];
+                    if (!value.isString() && !value.isNumeric())
+                        return;
+
+                    std::string subkey = value.asString();
+                    delivery.keyed = true;
+                    delivery.key = conflateKey(subkey);
+                    auto it = _last_values.find(subkey);
+                    if (it != _last_values.end())
+                    {
+                        it->second.msg = delivery.msg;
+                        _lru.splice(_lru.end(), _lru, it->second.pos); // 移到最近更新的一端
+                        return;
+                    }
+
+                    _lru.push_back(subkey);
+                    _last_values.emplace(std::move(subkey), LastValue{delivery.msg, std::prev(_lru.end())});
+                    while (_keyed.max_keys > 0 && _last_values.size() > _keyed.max_keys)
+                    {
+                        _last_values.erase(_lru.front());
+                        _lru.pop_front();
+                    }
+                }
+
+                // 向新订阅者发送各子键的最新值，调用方持有 _retain_mtx
+                void snapshot(const Subscriber::s_ptr& sub)
+                {
+                    if (_last_values.empty())
+                        return;
+
+                    I_LOG("主题 %s 发送 %zu 个子键的最新值!", _name.c_str(), _last_values.size());
+                    std::vector<Subscriber::s_ptr> target(1, sub);
+                    FilterSnapshot filters = std::atomic_load(&_filters);
+                    for (auto& subkey : _lru) // 按更新先后发送
+                    {
+                        Delivery delivery(_last_values[subkey].msg, filters);
+                        delivery.keyed = true;
+                        delivery.key = conflateKey(subkey);
+                        deliver(target, delivery);
+                    }
+                }
+
+                // 主题名称不包含 '\0'，拼接后不会与其它主题或子键冲突
+                std::string conflateKey(const std::string& subkey)
+                {
+                    std::string key;
+                    key.reserve(_name.size() + 1 + subkey.size());
+                    key.append(_name).push_back('\0');
+                    key.append(subkey);
+                    return key;
+                }
+
+                // 匹配该主题的通配符订阅者，索引版本未变化时直接使用缓存
+                // 版本与结果放在同一个不可变对象中整体替换，并发发布时只用更新的结果替换更旧的缓存
+                WildcardIndex::Matched wildcardSubscribers()
+                {
+                    uint64_t version = _wildcards->version();
+                    std::shared_ptr<const WildcardCache> cache = std::atomic_load(&_wild_cache);
+                    if (cache && cache->version == version)
+                        return cache->subs;
+
+                    // 先读版本再匹配，结果不会比版本旧
+                    auto fresh = std::make_shared<const WildcardCache>(WildcardCache{version, _wildcards->match(_name)});
+                    while (!cache || cache->version < version)
+                    {
+                        if (std::atomic_compare_exchange_weak(&_wild_cache, &cache, fresh))
+                            break;
+                    }
+                    return fresh->subs;
+                }
+
+                // 把一条消息投递给一组订阅者，跳过 skip 中的订阅者与不满足过滤条件的订阅者
+                template <typename Subscribers>
+                void deliver(const Subscribers& subs, Delivery& delivery, const SubscriberSet* skip = nullptr)
+                {
+                    std::shared_ptr<const DeliveryPolicy> policy = std::atomic_load(&_policy);
+
+                    for (auto& sub : subs) // 遍历所有订阅者
+                    {
+                        if ((skip != nullptr && skip->count(sub)) || !accept(delivery, sub))
+                            continue;
+
+                        Subscriber::Pending item;
+                        item.key = delivery.keyed ? delivery.key : _name;
+                        item.frame = frameFor(delivery, sub->conn()->protocol());
+                        sub->deliver(std::move(item), *policy, delivery.keyed);
+                    }
+                }
+
+                // 把一条消息投递给共享订阅组中的一个成员
+                void deliverGroup(ConsumerGroup& group, Delivery& delivery)
+                {
+                    Subscriber::s_ptr sub = group.pick();
+                    if (!sub)
+                        return;
+
+                    Subscriber::Pending item;
+                    item.key = delivery.keyed ? delivery.key : _name;
+                    item.frame = frameFor(delivery, sub->conn()->protocol());
+                    item.group = group.tag();
+                    item.msg = delivery.msg;
+                    sub->deliver(std::move(item), *std::atomic_load(&_policy), delivery.keyed);
+                }
+
+                // 把一条消息追加到所有可靠订阅会话，调用方持有 _retain_mtx
+                void deliverReliable(Delivery& delivery)
+                {
+                    ReliableSnapshot reliables = std::atomic_load(&_reliables);
+                    for (auto& it : *reliables)
+                    {
+                        Subscriber::s_ptr sub = it.second->subscriber();
+                        if (!sub) // 未绑定连接时不编码，续订时再按新连接的协议编码
+                        {
+                            it.second->push(delivery.msg, SharedFrame(), BaseProtocol::s_ptr());
+                            continue;
+                        }
+
+                        BaseProtocol::s_ptr proto = sub->conn()->protocol();
+                        it.second->push(delivery.msg, frameFor(delivery, proto), proto);
+                    }
+                }
+
+                // 按连接的协议取得编码后的帧，同一协议只编码一次
+                SharedFrame frameFor(Delivery& delivery, const BaseProtocol::s_ptr& proto)
+                {
+                    for (auto& cached : delivery.frames)
+                    {
+                        if (cached.first == proto)
+                            return cached.second;
+                    }
+
+                    SharedFrame frame = proto->sharedFrame(delivery.msg, true);
+                    delivery.frames.emplace_back(proto, frame);
+                    return frame;
+                }
+
+                // 分配序号，调用方持有 _retain_mtx
+                // 持久化的主题在这里写日志，写入成功后才推进序号，失败返回 false
+                // (持久化的主题总是持有 _retain_mtx 发布，序号不会被并发修改)
+                bool sequence(const TopicRequest::s_ptr& msg)
+                {
+                    uint64_t seq = _log ? _seq.load() + 1 : _seq.fetch_add(1) + 1;
+                    msg->setTopicSeq(seq);
+                    msg->setRawBody(msg->serialize()); // 写入序号后重新编码一次，之后推送与回放都直接复用
+                    if (!_log)
+                        return true;
+
+                    if (_log->append(seq, msg->rid(), msg->rawBody()) == 0)
+                    {
+                        E_LOG("主题 %s 的消息 %lu 写入日志失败!", _name.c_str(), (unsigned long)seq);
+                        return false;
+                    }
+                    _seq.store(seq);
+                    return true;
+                }
+
+                // 保留已分配序号的消息，调用方持有 _retain_mtx，持久化的主题已在 sequence 中写入日志
+                void retain(const TopicRequest::s_ptr& msg)
+                {
+                    uint64_t seq = msg->topicSeq();
+                    if (_log)
+                        return;
+
+                    Retained item;
+                    item.seq = seq;
+                    item.msg = msg;
+                    item.bytes = msg->rawBody().size();
+                    item.time = std::chrono::steady_clock::now();
+                    _retained.push_back(item);
+                    _retained_bytes += item.bytes;
+
+                    evict(item.time);
+                }
+
+                // 淘汰超出保留上限的消息，调用方持有 _retain_mtx
+                void evict(std::chrono::steady_clock::time_point now)
+                {
+                    if (!_retention.enabled())
+                    {
+                        _retained.clear();
+                        _retained_bytes = 0;
+                        return;
+                    }
+
+                    while (!_retained.empty())
+                    {
+                        const Retained& front = _retained.front();
+                        bool over = (_retention.max_count > 0 && _retained.size() > _retention.max_count)
+                            || (_retention.max_bytes > 0 && _retained_bytes > _retention.max_bytes)
+                            || (_retention.max_age > 0 
+                                && std::chrono::duration<double>(now - front.time).count() > _retention.max_age);
+                        if (!over)
+                            break;
+
+                        _retained_bytes -= front.bytes;
+                        _retained.pop_front();
+                    }
+                }
+
+                // 向新订阅者回放保留的消息，调用方持有 _retain_mtx
+                // from > 0: 回放序号 >= from 的消息(早于保留范围的部分已无法回放)
+                // last > 0: 回放最近 last 条消息
+                void replay(const Subscriber::s_ptr& sub, uint64_t from, uint64_t last)
+                {
+                    if (from == 0 && last == 0)
+                        return;
+
+                    if (_log)
+                        return replayLog(sub, from, last);
+
+                    if (_retained.empty())
+                        return;
+
+                    evict(std::chrono::steady_clock::now());
+
+                    size_t begin = _retained.size();
+                    if (from > 0)
+                    {
+                        while (begin > 0 && _retained[begin - 1].seq >= from)
+                            begin--;
+                    }
+                    else
+                    {
+                        begin = last >= _retained.size() ? 0 : _retained.size() - last;
+                    }
+
+                    I_LOG("主题 %s 回放 %zu 条消息!", _name.c_str(), _retained.size() - begin);
+                    std::vector<Subscriber::s_ptr> target(1, sub);
+                    FilterSnapshot filters = std::atomic_load(&_filters);
+                    for (size_t i = begin; i < _retained.size(); i++)
+                    {
+                        Delivery delivery(_retained[i].msg, filters);
+                        deliver(target, delivery);
+                    }
+                }
+
+                // 从持久化日志回放，正文直接从映射内存拷贝到帧中，不需要反序列化
+                void replayLog(const Subscriber::s_ptr& sub, uint64_t from, uint64_t last)
+                {
+                    uint64_t seq = _seq.load();
+                    if (from == 0)
+                        from = last >= seq ? 1 : seq - last + 1;
+
+                    size_t count = 0;
+                    std::vector<Subscriber::s_ptr> target(1, sub);
+                    FilterSnapshot filters = std::atomic_load(&_filters);
+                    _log->read(from, [&](uint64_t, const char* id, size_t idlen, const char* body, size_t len) {
+                        auto msg = MessageFactory::create<TopicRequest>();
+                        msg->setMtype(MType::REQ_TOPIC);
+                        msg->setRid(std::string(id, idlen));
+                        msg->setRawBody(std::string(body, len));
+                        Delivery delivery(msg, filters);
+                        deliver(target, delivery);
+                        count++;
+                    });
+                    I_LOG("主题 %s 从日志回放 %zu 条消息!", _name.c_str(), count);
+                }
+
+            private:
+                // 保留的消息
+                struct Retained
+                {
+                    uint64_t seq;
+                    TopicRequest::s_ptr msg;
+                    size_t bytes;
+                    std::chrono::steady_clock::time_point time;
+                };
+
+                std::string _name;
+                std::mutex _mtx; // 只保护订阅变更之间的互斥
+                Snapshot _subscribers; // 该主题的订阅者连接，只通过 atomic_load/atomic_store 访问
+                FilterSnapshot _filters; // 设置了过滤条件的订阅者，同样原子替换
+                GroupSnapshot _groups;   // 共享订阅组，同样原子替换
+                ReliableSnapshot _reliables; // 可靠订阅会话: 消费者标识 -> 会话，同样原子替换
+                std::shared_ptr<const DeliveryPolicy> _policy; // 慢消费者策略，同样原子替换
+
+                std::mutex _retain_mtx; // 保护保留队列与最新值缓存，开启保留、按键合并或存在可靠订阅时与订阅回放互斥
+                std::atomic<bool> _retain_enabled; // 发布是否需要持有 _retain_mtx
+                RetentionPolicy _retention;
+                std::atomic<uint64_t> _seq; // 最新消息的序号
+                std::deque<Retained> _retained;
+                size_t _retained_bytes;
+                TopicLog::s_ptr _log; // 持久化日志，非持久化的主题为空
+                KeyedPolicy _keyed;
+                // 子键的最新一条消息及其在淘汰顺序中的位置
+                struct LastValue
+                {
+                    TopicRequest::s_ptr msg;
+                    std::list<std::string>::iterator pos;
+                };
+                std::unordered_map<std::string, LastValue> _last_values; // 子键 -> 最新值
+                std::list<std::string> _lru; // 子键按最近更新时间排序，头部最久没有更新，超出 max_keys 时从头部淘汰
+
+                WildcardIndex::s_ptr _wildcards;
+                struct WildcardCache
+                {
+                    uint64_t version; // 匹配时的索引版本
+                    WildcardIndex::Matched subs;
+                };
+                std::shared_ptr<const WildcardCache> _wild_cache; // 匹配该主题的通配符订阅者缓存，原子替换
+            };
+
+            // 主题分片
+            struct Shard
+            {
+                std::mutex mtx;
+                std::unordered_map<std::string, Topic::s_ptr> topics;
+                BaseExecutor::s_ptr executor; // 分片的专属线程，为空时在调用线程中执行
+            };
+
+        private:
+            size_t shardIndex(const std::string& topicName)
+            {
+                return std::hash<std::string>()(topicName) % _shards.size();
+            }
+
+            Shard& shardOf(const std::string& topicName)
+            {
+                return *_shards[shardIndex(topicName)];
+            }
+
+            Topic::s_ptr findTopic(const std::string& topicName)
+            {
+                Shard& shard = shardOf(topicName);
+                std::unique_lock<std::mutex> lock(shard.mtx);
+                auto it = shard.topics.find(topicName);
+                return it != shard.topics.end() ? it->second : Topic::s_ptr();
+            }
+
+            void runInShard(size_t index, Task task)
+            {
+                Shard& shard = *_shards[index];
+                if (shard.executor)
+                    shard.executor->submit(std::move(task));
+                else
+                    task();
+            }
+
+            // 把 items 按主题所属的分片分组，在各分片中依次执行 fn，全部分片完成后执行一次 done
+            template <typename Item, typename KeyFn, typename Fn>
+            void runSharded(const std::vector<Item>& items, KeyFn key, Fn fn, const std::function<void()>& done)
+            {
+                std::vector<std::vector<Item>> groups(_shards.size());
+                for (auto& item : items)
+                    groups[shardIndex(key(item))].push_back(item);
+
+                auto pending = std::make_shared<std::atomic<size_t>>(1); // 当前线程持有一个计数，分发完成前不会触发 done
+                for (size_t i = 0; i < groups.size(); i++)
+                {
+                    if (groups[i].empty())
+                        continue;
+
+                    pending->fetch_add(1);
+                    auto group = std::make_shared<std::vector<Item>>(std::move(groups[i]));
+                    runInShard(i, [group, fn, pending, done]() {
+                        for (auto& item : *group)
+                            fn(item);
+                        if (pending->fetch_sub(1) == 1)
+                            done();
+                    });
+                }
+
+                if (pending->fetch_sub(1) == 1)
+                    done();
+            }
+
+            // 按主题的策略构造主题对象，调用方持有 _mtx
+            Topic::s_ptr makeTopic(const std::string& topicName, const TopicLog::s_ptr& log)
+            {
+                auto pit = _policies.find(topicName);
+                auto rit = _retentions.find(topicName);
+                auto kit = _keyeds.find(topicName);
+                return std::make_shared<Topic>(topicName, 
+                    pit != _policies.end() ? pit->second : _default_policy,
+                    rit != _retentions.end() ? rit->second : _default_retention,
+                    kit != _keyeds.end() ? kit->second : KeyedPolicy(),
+                    log, _wildcards);
+            }
+
+            // 调用方持有 _mtx
+            DurablePolicy durablePolicy(const std::string& topicName)
+            {
+                auto it = _durables.find(topicName);
+                return it != _durables.end() ? it->second : _default_durable;
+            }
 
         private:
-            std::mutex _mtx;
-            std::unordered_map<std::string, Topic::s_ptr> _topics;
+            std::mutex _mtx; // 保护订阅者表与各项策略，推送消息时不使用
             std::unordered_map<BaseConnection::s_ptr, Subscriber::s_ptr> _subscribes;
+            DeliveryPolicy _default_policy;
+            std::unordered_map<std::string, DeliveryPolicy> _policies; // 单独设置了策略的主题
+            RetentionPolicy _default_retention;
+            std::unordered_map<std::string, RetentionPolicy> _retentions; // 单独设置了保留策略的主题
+            std::unordered_map<std::string, KeyedPolicy> _keyeds; // 按键合并的主题
+            DurablePolicy _default_durable;
+            std::unordered_map<std::string, DurablePolicy> _durables; // 单独设置了持久化策略的主题
+            ReliablePolicy _reliable_policy;
+            CoalescePolicy _coalesce;
+            TopicStore::s_ptr _store; // 只通过 atomic_load/atomic_store 访问
+            WildcardIndex::s_ptr _wildcards = std::make_shared<WildcardIndex>(); // 通配符订阅
+            std::vector<std::unique_ptr<Shard>> _shards; // 最后声明，析构时先停止分片线程
         };
     }
 }
\ No newline at end of file
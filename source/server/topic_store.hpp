@@ -0,0 +1,762 @@
+/*
+ *  主题消息持久化存储
+ *  1.Segment: 固定大小、mmap 映射的段文件，附带稀疏索引文件
+ *  2.TopicLog: 单个主题的段文件序列，追加写入、按序号读取
+ *  3.TopicStore: 所有持久化主题的根目录，后台线程组提交刷盘
+ *
+ *  目录结构:
+ *    <root>/<主题名编码>/<起始序号 20 位>.log  段文件，创建时按固定大小分配
+ *    <root>/<主题名编码>/<起始序号 20 位>.idx  稀疏索引，每写入 index_interval 字节记录一项 | seq(8) | pos(4) |
+ *
+ *  记录格式(小端):
+ *    | len(4) | checksum(4) | seq(8) | idlen(4) | id | body |
+ *    len 为 len 字段之后的字节数，0 表示段内已无记录
+ */
+#pragma once
+
+#include "../common/util.hpp"
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace JsonRpc
+{
+    namespace Server
+    {
+        // 主题持久化策略
+        struct DurablePolicy
+        {
+            bool durable = false;
+            size_t segment_bytes = 64 * 1024 * 1024; // 单个段文件大小
+            size_t index_interval = 4096;            // 稀疏索引的间隔字节数
+            size_t max_segments = 0;                 // 最多保留的段文件数，0 表示不限制
+        };
+
+        // 固定大小的 mmap 段文件
+        // 写入只发生在最后一个(活跃)段，由 TopicLog 串行化；已写入的区域只读，可以在锁外读取
+        class Segment
+        {
+        public:
+            using s_ptr = std::shared_ptr<Segment>;
+
+            // 读取记录时的回调: 序号，请求 id，正文(均指向映射内存)
+            using Visitor = std::function<void(uint64_t seq, const char* id, size_t idlen, const char* body, size_t len)>;
+
+            static const size_t HEADER_LEN = 4 + 4 + 8 + 4;
+
+            ~Segment()
+            {
+                if (_base != nullptr)
+                    ::munmap(_base, _capacity);
+                if (_fd >= 0)
+                    ::close(_fd);
+                if (_idx_fd >= 0)
+                    ::close(_idx_fd);
+                if (_removed)
+                {
+                    ::unlink(_path.c_str());
+                    ::unlink(indexPath().c_str());
+                }
+            }
+
+            // 创建新段文件
+            static s_ptr create(const std::string& dir, uint64_t base_seq, const DurablePolicy& policy)
+            {
+                s_ptr seg(new Segment(dir, base_seq, policy.index_interval));
+                if (!seg->open(policy.segment_bytes, true))
+                    return s_ptr();
+                return seg;
+            }
+
+            // 打开已存在的段文件，active 为真时恢复写入位置
+            static s_ptr load(const std::string& dir, uint64_t base_seq, const DurablePolicy& policy, bool active)
+            {
+                s_ptr seg(new Segment(dir, base_seq, policy.index_interval));
+                if (!seg->open(0, false))
+                    return s_ptr();
+
+                seg->loadIndex();
+                if (active)
+                    seg->recover();
+                return seg;
+            }
+
+            // 追加一条记录，空间不足返回 false
+            bool append(uint64_t seq, const std::string& id, const std::string& body)
+            {
+                size_t need = HEADER_LEN + id.size() + body.size();
+                if (_pos + need + 4 > _capacity) // 留出 4 字节的结束标记
+                    return false;
+
+                char* p = _base + _pos;
+                writeU64(p + 8, seq);
+                writeU32(p + 16, (uint32_t)id.size());
+                ::memcpy(p + HEADER_LEN, id.data(), id.size());
+                ::memcpy(p + HEADER_LEN + id.size(), body.data(), body.size());
+                writeU32(p + 4, checksum(p + 8, need - 8));
+                writeU32(p, (uint32_t)(need - 4)); // 最后写入长度，进程崩溃时不会留下半条记录
+
+                if (_index.empty() || _pos - _index.back().second >= _index_interval)
+                    appendIndex(seq, (uint32_t)_pos);
+
+                _pos += need;
+                _last_seq = seq;
+                return true;
+            }
+
+            // 读取序号 >= from 的记录，end 为调用方观察到的写入位置
+            void read(uint64_t from, size_t end, const Visitor& visitor)
+            {
+                size_t pos = 0;
+                // 稀疏索引中最后一个序号 <= from 的位置开始扫描
+                auto it = std::upper_bound(_index.begin(), _index.end(), std::make_pair(from, UINT32_MAX));
+                if (it != _index.begin())
+                    pos = (--it)->second;
+
+                uint64_t seq;
+                const char* id;
+                size_t idlen;
+                const char* body;
+                size_t len;
+                while (pos < end && parse(pos, seq, id, idlen, body, len))
+                {
+                    if (seq >= from)
+                        visitor(seq, id, idlen, body, len);
+                    pos += 4 + readU32(_base + pos);
+                }
+            }
+
+            // 把 [_synced, end) 区间刷到磁盘，由刷盘线程调用
+            bool sync(size_t end)
+            {
+                size_t synced = _synced.load();
+                if (end <= synced)
+                    return true;
+
+                long page = ::sysconf(_SC_PAGESIZE);
+                size_t begin = synced / page * page;
+                if (::msync(_base + begin, end - begin, MS_SYNC) != 0 || ::fdatasync(_idx_fd) != 0)
+                {
+                    E_LOG("段文件 %s 刷盘失败: %s", _path.c_str(), strerror(errno));
+                    return false;
+                }
+
+                _synced.store(end);
+                return true;
+            }
+
+            // 段文件被淘汰，最后一个引用释放时删除文件
+            void markRemoved()
+            {
+                _removed = true;
+            }
+
+            uint64_t baseSeq() const { return _base_seq; }
+            uint64_t lastSeq() const { return _last_seq; } // 段内最后一条记录的序号，空段为 baseSeq - 1
+            size_t position() const { return _pos; }
+            size_t synced() const { return _synced.load(); }
+            size_t capacity() const { return _capacity; }
+
+            static std::string fileName(uint64_t base_seq, const char* ext)
+            {
+                char name[32] = {0};
+                snprintf(name, sizeof(name), "%020llu%s", (unsigned long long)base_seq, ext);
+                return name;
+            }
+
+        private:
+            Segment(const std::string& dir, uint64_t base_seq, size_t index_interval)
+                : _path(dir + "/" + fileName(base_seq, ".log"))
+                , _dir(dir)
+                , _base_seq(base_seq)
+                , _last_seq(base_seq - 1)
+                , _index_interval(index_interval)
+                , _fd(-1)
+                , _idx_fd(-1)
+                , _base(nullptr)
+                , _capacity(0)
+                , _pos(0)
+                , _synced(0)
+                , _removed(false)
+            {}
+
+            std::string indexPath() const
+            {
+                return _dir + "/" + fileName(_base_seq, ".idx");
+            }
+
+            bool open(size_t capacity, bool create)
+            {
+                _fd = ::open(_path.c_str(), O_RDWR | (create ? O_CREAT | O_TRUNC : 0), 0644);
+                _idx_fd = ::open(indexPath().c_str(), O_RDWR | O_CREAT | O_APPEND | (create ? O_TRUNC : 0), 0644);
+                if (_fd < 0 || _idx_fd < 0)
+                {
+                    E_LOG("打开段文件 %s 失败: %s", _path.c_str(), strerror(errno));
+                    return false;
+                }
+
+                if (create)
+                {
+                    if (::ftruncate(_fd, capacity) != 0) // 文件空洞，未写入的区域读出为 0
+                    {
+                        E_LOG("分配段文件 %s 失败: %s", _path.c_str(), strerror(errno));
+                        return false;
+                    }
+                    _capacity = capacity;
+                }
+                else
+                {
+                    struct stat st;
+                    if (::fstat(_fd, &st) != 0 || st.st_size < (off_t)(HEADER_LEN + 4))
+                    {
+                        E_LOG("段文件 %s 已损坏!", _path.c_str());
+                        return false;
+                    }
+                    _capacity = st.st_size;
+                    _pos = _capacity; // 非活跃段全部视为已写入，读取时遇到结束标记停止
+                    _synced = _capacity;
+                }
+
+                void* addr = ::mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+                if (addr == MAP_FAILED)
+                {
+                    E_LOG("映射段文件 %s 失败: %s", _path.c_str(), strerror(errno));
+                    return false;
+                }
+                _base = static_cast<char*>(addr);
+                return true;
+            }
+
+            // 读取稀疏索引，丢弃指向无效位置的尾部项(索引先于记录落盘时崩溃)
+            void loadIndex()
+            {
+                struct stat st;
+                if (::fstat(_idx_fd, &st) != 0)
+                    return;
+
+                size_t count = st.st_size / 12;
+                std::vector<char> buf(count * 12);
+                if (count == 0 || ::pread(_idx_fd, buf.data(), buf.size(), 0) != (ssize_t)buf.size())
+                    return;
+
+                for (size_t i = 0; i < count; i++)
+                    _index.emplace_back(readU64(buf.data() + i * 12), readU32(buf.data() + i * 12 + 8));
+
+                // 只有尾部的索引项可能无效，从后向前校验到第一个有效项为止，不需要读取整个段文件
+                while (!_index.empty())
+                {
+                    uint64_t seq;
+                    const char* id;
+                    size_t idlen;
+                    const char* body;
+                    size_t len;
+                    size_t pos = _index.back().second;
+                    if (pos < _capacity && parse(pos, seq, id, idlen, body, len) && seq == _index.back().first)
+                        break;
+                    _index.pop_back();
+                }
+
+                if (_index.size() != count) // 截掉无效的索引项
+                {
+                    if (::ftruncate(_idx_fd, _index.size() * 12) != 0)
+                        E_LOG("截断索引文件失败: %s", strerror(errno));
+                }
+            }
+
+            // 从最后一个索引项开始扫描，恢复活跃段的写入位置与最后序号
+            // 只需要扫描 index_interval 字节左右，启动时间与段文件大小无关
+            void recover()
+            {
+                size_t pos = _index.empty() ? 0 : _index.back().second;
+                uint64_t expect = _index.empty() ? _base_seq : _index.back().first;
+
+                uint64_t seq;
+                const char* id;
+                size_t idlen;
+                const char* body;
+                size_t len;
+                while (parse(pos, seq, id, idlen, body, len) && seq == expect)
+                {
+                    pos += 4 + readU32(_base + pos);
+                    _last_seq = seq;
+                    expect++;
+                }
+
+                // 截断处之后可能残留校验失败的半条记录，清零避免之后被误读
+                if (pos + 4 <= _capacity && readU32(_base + pos) != 0)
+                {
+                    E_LOG("段文件 %s 在 %zu 处截断!", _path.c_str(), pos);
+                    ::memset(_base + pos, 0, _capacity - pos);
+                }
+
+                _pos = pos;
+                _synced = pos;
+            }
+
+            // 解析 pos 处的记录，校验失败或没有记录返回 false
+            bool parse(size_t pos, uint64_t& seq, const char*& id, size_t& idlen, const char*& body, size_t& len)
+            {
+                if (pos + HEADER_LEN > _capacity)
+                    return false;
+
+                const char* p = _base + pos;
+                size_t total = readU32(p);
+                if (total < HEADER_LEN - 4 || pos + 4 + total > _capacity)
+                    return false;
+
+                if (readU32(p + 4) != checksum(p + 8, total - 4))
+                    return false;
+
+                seq = readU64(p + 8);
+                idlen = readU32(p + 16);
+                if (HEADER_LEN + idlen > total + 4)
+                    return false;
+
+                id = p + HEADER_LEN;
+                body = id + idlen;
+                len = total + 4 - HEADER_LEN - idlen;
+                return true;
+            }
+
+            void appendIndex(uint64_t seq, uint32_t pos)
+            {
+                char buf[12];
+                writeU64(buf, seq);
+                writeU32(buf + 8, pos);
+                if (::write(_idx_fd, buf, sizeof(buf)) != (ssize_t)sizeof(buf))
+                {
+                    E_LOG("写入索引文件失败: %s", strerror(errno)); // 索引只用于加速，缺失不影响正确性
+                    return;
+                }
+                _index.emplace_back(seq, pos);
+            }
+
+            // FNV-1a，用于识别崩溃时未写完的记录
+            static uint32_t checksum(const char* data, size_t len)
+            {
+                uint32_t hash = 2166136261u;
+                for (size_t i = 0; i < len; i++)
+                {
+                    hash ^= (uint8_t)data[i];
+                    hash *= 16777619u;
+                }
+                return hash;
+            }
+
+            static void writeU32(char* p, uint32_t v) { ::memcpy(p, &v, 4); }
+            static void writeU64(char* p, uint64_t v) { ::memcpy(p, &v, 8); }
+            static uint32_t readU32(const char* p) { uint32_t v; ::memcpy(&v, p, 4); return v; }
+            static uint64_t readU64(const char* p) { uint64_t v; ::memcpy(&v, p, 8); return v; }
+
+        private:
+            std::string _path;
+            std::string _dir;
+            uint64_t _base_seq;
+            uint64_t _last_seq;
+            size_t _index_interval;
+            std::vector<std::pair<uint64_t, uint32_t>> _index; // 稀疏索引: 序号 -> 段内位置
+
+            int _fd;
+            int _idx_fd;
+            char* _base;
+            size_t _capacity;
+            size_t _pos;                 // 写入位置
+            std::atomic<size_t> _synced; // 已刷盘的位置
+            std::atomic<bool> _removed;
+        };
+
+        // 单个主题的持久化日志
+        class TopicLog
+        {
+        public:
+            using s_ptr = std::shared_ptr<TopicLog>;
+
+            TopicLog(const std::string& dir, const DurablePolicy& policy)
+                : _dir(dir)
+                , _policy(policy)
+            {}
+
+            // 打开目录下已有的段文件，只扫描最后一个段的尾部
+            bool open()
+            {
+                ::mkdir(_dir.c_str(), 0755);
+
+                std::vector<uint64_t> bases;
+                DIR* dp = ::opendir(_dir.c_str());
+                if (dp == nullptr)
+                {
+                    E_LOG("打开目录 %s 失败: %s", _dir.c_str(), strerror(errno));
+                    return false;
+                }
+                while (struct dirent* ent = ::readdir(dp))
+                {
+                    std::string name = ent->d_name;
+                    if (name.size() == 24 && name.compare(20, 4, ".log") == 0)
+                        bases.push_back(std::stoull(name.substr(0, 20)));
+                }
+                ::closedir(dp);
+                std::sort(bases.begin(), bases.end());
+
+                std::unique_lock<std::mutex> lock(_mtx);
+                for (size_t i = 0; i < bases.size(); i++)
+                {
+                    bool active = (i + 1 == bases.size());
+                    auto seg = Segment::load(_dir, bases[i], _policy, active);
+                    if (!seg)
+                        return false;
+                    _segments.push_back(seg);
+                }
+
+                if (!_segments.empty())
+                    I_LOG("恢复主题日志 %s: %zu 个段，最后序号 %llu", _dir.c_str(), _segments.size(),
+                        (unsigned long long)lastSeqLocked());
+                return true;
+            }
+
+            // 最后一条记录的序号，没有记录时为 0
+            uint64_t lastSeq()
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                return lastSeqLocked();
+            }
+
+            // 追加一条记录，seq 必须连续递增，由调用方串行化
+            // 返回写入的字节数，失败返回 0
+            size_t append(uint64_t seq, const std::string& id, const std::string& body)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                if (_segments.empty() || !_segments.back()->append(seq, id, body))
+                {
+                    // 活跃段已满，滚动到新段
+                    auto seg = Segment::create(_dir, seq, _policy);
+                    if (!seg || !seg->append(seq, id, body))
+                    {
+                        if (seg)
+                            seg->markRemoved(); // 记录超过段文件大小
+                        E_LOG("主题日志 %s 写入失败，记录大小 %zu!", _dir.c_str(), body.size());
+                        return 0;
+                    }
+
+                    _segments.push_back(seg);
+                    evict();
+                }
+                return Segment::HEADER_LEN + id.size() + body.size();
+            }
+
+            // 读取序号 >= from 的记录，调用方需要与 append 串行化
+            void read(uint64_t from, const Segment::Visitor& visitor)
+            {
+                std::vector<std::pair<Segment::s_ptr, size_t>> segs;
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    for (size_t i = 0; i < _segments.size(); i++)
+                    {
+                        bool has_next = i + 1 < _segments.size();
+                        if (has_next && _segments[i + 1]->baseSeq() <= from)
+                            continue; // 整个段都早于 from
+                        segs.emplace_back(_segments[i], _segments[i]->position());
+                    }
+                }
+
+                for (auto& seg : segs) // 读取映射内存，不持有锁
+                    seg.first->read(from, seg.second, visitor);
+            }
+
+            // 最早可读的序号
+            uint64_t firstSeq()
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                return _segments.empty() ? 0 : _segments.front()->baseSeq();
+            }
+
+            // 刷盘，返回是否成功，由刷盘线程调用
+            bool sync()
+            {
+                std::vector<std::pair<Segment::s_ptr, size_t>> dirty;
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    for (auto& seg : _segments)
+                    {
+                        if (seg->synced() < seg->position())
+                            dirty.emplace_back(seg, seg->position());
+                    }
+                }
+
+                bool ok = true;
+                for (auto& seg : dirty) // msync 不持有锁，不阻塞发布者
+                    ok = seg.first->sync(seg.second) && ok;
+                return ok;
+            }
+
+            // 删除所有段文件
+            void destroy()
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                for (auto& seg : _segments)
+                    seg->markRemoved();
+                _segments.clear();
+                ::rmdir(_dir.c_str()); // 刷盘线程持有的段释放后文件才会删除，目录可能暂时非空
+            }
+
+        private:
+            uint64_t lastSeqLocked()
+            {
+                return _segments.empty() ? 0 : _segments.back()->lastSeq();
+            }
+
+            // 淘汰超出数量的最早的段，调用方持有 _mtx
+            void evict()
+            {
+                while (_policy.max_segments > 0 && _segments.size() > _policy.max_segments)
+                {
+                    _segments.front()->markRemoved();
+                    _segments.erase(_segments.begin());
+                }
+            }
+
+        private:
+            std::string _dir;
+            DurablePolicy _policy;
+            std::mutex _mtx;
+            std::vector<Segment::s_ptr> _segments;
+        };
+
+        // 持久化存储根目录
+        // 组提交: 发布者写入映射内存后立即返回，刷盘线程每 flush_interval_ms 或累计 flush_bytes 字节刷一次盘，
+        // 一次 msync/fdatasync 覆盖这段时间内所有发布者的写入，刷盘完成后再执行等待中的回调(例如发布确认)
+        // 任意日志刷盘失败时，本次等待的回调都收到失败，未刷盘的数据留到下一次重试
+        class TopicStore
+        {
+        public:
+            using s_ptr = std::shared_ptr<TopicStore>;
+            using CommitCallback = std::function<void(bool ok)>; // ok: 回调之前的写入是否已全部刷盘
+            using SyncFunc = std::function<bool(const TopicLog::s_ptr&)>;
+
+            TopicStore(const std::string& root, int flush_interval_ms = 5, size_t flush_bytes = 1024 * 1024)
+                : _root(root)
+                , _flush_interval(flush_interval_ms)
+                , _flush_bytes(flush_bytes)
+                , _pending_bytes(0)
+                , _running(true)
+                , _syncs(0)
+                , _sync_failures(0)
+            {
+                ::mkdir(_root.c_str(), 0755);
+                _thread = std::thread(&TopicStore::flushLoop, this);
+            }
+
+            ~TopicStore()
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    _running = false;
+                }
+                _cv.notify_all();
+                _thread.join(); // 退出前刷完所有数据
+            }
+
+            // 打开(不存在则创建)主题日志
+            TopicLog::s_ptr open(const std::string& topic, const DurablePolicy& policy)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                auto it = _logs.find(topic);
+                if (it != _logs.end())
+                    return it->second;
+
+                auto log = std::make_shared<TopicLog>(_root + "/" + encode(topic), policy);
+                if (!log->open())
+                    return TopicLog::s_ptr();
+
+                _logs.emplace(topic, log);
+                return log;
+            }
+
+            // 删除主题日志
+            void remove(const std::string& topic)
+            {
+                TopicLog::s_ptr log;
+                {
+                    std::unique_lock<std::mutex> lock(_mtx);
+                    auto it = _logs.find(topic);
+                    if (it == _logs.end())
+                        return;
+                    log = it->second;
+                    _logs.erase(it);
+                }
+                log->destroy();
+            }
+
+            // 根目录下已有的主题
+            std::vector<std::string> topics()
+            {
+                std::vector<std::string> names;
+                DIR* dp = ::opendir(_root.c_str());
+                if (dp == nullptr)
+                    return names;
+
+                while (struct dirent* ent = ::readdir(dp))
+                {
+                    std::string name = ent->d_name;
+                    if (name != "." && name != "..")
+                        names.push_back(decode(name));
+                }
+                ::closedir(dp);
+                return names;
+            }
+
+            // 记录新写入的字节数，达到阈值时提前唤醒刷盘线程
+            void written(size_t bytes)
+            {
+                if (_pending_bytes.fetch_add(bytes) + bytes >= _flush_bytes)
+                    _cv.notify_one();
+            }
+
+            // 当前已写入的数据刷盘后执行回调(在刷盘线程中)
+            void onCommit(const CommitCallback& cb)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _callbacks.push_back(cb);
+            }
+
+            // 累计成功的刷盘次数
+            uint64_t syncs()
+            {
+                return _syncs.load(std::memory_order_relaxed);
+            }
+
+            // 累计失败的刷盘次数
+            uint64_t syncFailures()
+            {
+                return _sync_failures.load(std::memory_order_relaxed);
+            }
+
+            // 替换日志的刷盘函数(默认为 TopicLog::sync)，用于在测试中注入刷盘失败
+            void setSyncFunc(const SyncFunc& func)
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _sync_func = func;
+            }
+
+        private:
+            void flushLoop()
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                while (true)
+                {
+                    _cv.wait_for(lock, _flush_interval, [this]() {
+                        return !_running || _pending_bytes.load() >= _flush_bytes;
+                    });
+
+                    bool running = _running;
+                    if (_pending_bytes.load() == 0 && _callbacks.empty())
+                    {
+                        if (!running)
+                            break;
+                        continue;
+                    }
+
+                    // 取出回调之前的写入都会被本次刷盘覆盖
+                    std::vector<CommitCallback> callbacks;
+                    callbacks.swap(_callbacks);
+                    _pending_bytes.store(0);
+
+                    std::vector<TopicLog::s_ptr> logs;
+                    for (auto& it : _logs)
+                        logs.push_back(it.second);
+                    SyncFunc sync_func = _sync_func;
+
+                    lock.unlock();
+                    bool ok = true;
+                    for (auto& log : logs)
+                        ok = (sync_func ? sync_func(log) : log->sync()) && ok;
+                    if (ok)
+                    {
+                        _syncs.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        _sync_failures.fetch_add(1, std::memory_order_relaxed);
+                        E_LOG("持久化存储 %s 刷盘失败，%zu 个等待中的提交按失败处理!", _root.c_str(), callbacks.size());
+                    }
+
+                    for (auto& cb : callbacks)
+                        cb(ok);
+                    lock.lock();
+                }
+            }
+
+            // 主题名转为目录名，字母数字与 - _ . 以外的字符编码为 %XX
+            static std::string encode(const std::string& topic)
+            {
+                std::string dir;
+                for (unsigned char c : topic)
+                {
+                    if (isalnum(c) || c == '-' || c == '_' || (c == '.' && !dir.empty()))
+                    {
+                        dir += c;
+                    }
+                    else
+                    {
+                        char buf[4];
+                        snprintf(buf, sizeof(buf), "%%%02X", c);
+                        dir += buf;
+                    }
+                }
+                return dir;
+            }
+
+            static std::string decode(const std::string& dir)
+            {
+                std::string topic;
+                for (size_t i = 0; i < dir.size(); i++)
+                {
+                    if (dir[i] == '%' && i + 2 < dir.size())
+                    {
+                        topic += (char)std::stoi(dir.substr(i + 1, 2), nullptr, 16);
+                        i += 2;
+                    }
+                    else
+                    {
+                        topic += dir[i];
+                    }
+                }
+                return topic;
+            }
+
+        private:
+            std::string _root;
+            std::chrono::milliseconds _flush_interval;
+            size_t _flush_bytes;
+            std::atomic<size_t> _pending_bytes;
+
+            std::mutex _mtx;
+            std::condition_variable _cv;
+            bool _running;
+            std::unordered_map<std::string, TopicLog::s_ptr> _logs;
+            std::vector<CommitCallback> _callbacks;
+            std::atomic<uint64_t> _syncs;
+            std::atomic<uint64_t> _sync_failures;
+            SyncFunc _sync_func; // 为空时使用 TopicLog::sync
+            std::thread _thread;
+        };
+    }
+}
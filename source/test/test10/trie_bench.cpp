@@ -0,0 +1,104 @@
+// 通配符订阅匹配压测: 前缀树 vs 逐个模式匹配
+// ./trie_bench [模式数] [匹配次数]
+#include "../../common/topic_trie.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 逐段比较的朴素匹配，作为对照和正确性校验
+static bool naiveMatch(const std::vector<std::string>& pat, size_t i, const std::vector<std::string>& topic, size_t j)
+{
+    if (i == pat.size())
+        return j == topic.size();
+    if (pat[i] == "#")
+    {
+        for (size_t k = j; k <= topic.size(); k++)
+            if (naiveMatch(pat, i + 1, topic, k))
+                return true;
+        return false;
+    }
+    if (j == topic.size())
+        return false;
+    return (pat[i] == "*" || pat[i] == topic[j]) && naiveMatch(pat, i + 1, topic, j + 1);
+}
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int pattern_num = argc > 1 ? atoi(argv[1]) : 10000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 100000;
+
+    // market.<交易所>.<代码>.<字段>，模式在各层随机使用通配符
+    std::vector<std::string> patterns;
+    std::vector<std::vector<std::string>> split;
+    TopicTrie<int> trie;
+    for (int i = 0; i < pattern_num; i++)
+    {
+        std::string code = std::to_string(600000 + i % 5000);
+        std::string pattern;
+        switch (i % 8)
+        {
+        case 0: pattern = "market.sh." + code + ".*"; break;
+        case 1: pattern = "market.*." + code + ".price"; break;
+        case 2: pattern = "market.sz." + code + ".#"; break;
+        default: pattern = "market.sh." + code + ".price"; break;
+        }
+        patterns.push_back(pattern);
+        split.push_back(TopicTrie<int>::split(pattern));
+        trie.insert(pattern, i);
+    }
+    trie.insert("market.#", pattern_num);
+    patterns.push_back("market.#");
+    split.push_back(TopicTrie<int>::split("market.#"));
+
+    std::vector<std::string> topics;
+    for (int i = 0; i < 1000; i++)
+        topics.push_back(std::string("market.") + (i % 2 ? "sh." : "sz.") + std::to_string(600000 + i * 7 % 5000) + ".price");
+
+    // 正确性: 前缀树与朴素匹配的结果数量一致
+    for (auto& topic : topics)
+    {
+        std::vector<int> out;
+        trie.match(topic, out);
+        size_t expect = 0;
+        auto segs = TopicTrie<int>::split(topic);
+        for (auto& pat : split)
+            expect += naiveMatch(pat, 0, segs, 0);
+        if (out.size() != expect)
+        {
+            printf("MISMATCH %s: trie %zu naive %zu\n", topic.c_str(), out.size(), expect);
+            return 1;
+        }
+    }
+
+    size_t matched = 0;
+    double start = now();
+    for (int i = 0; i < rounds; i++)
+    {
+        std::vector<int> out;
+        trie.match(topics[i % topics.size()], out);
+        matched += out.size();
+    }
+    double trie_cost = now() - start;
+
+    int naive_rounds = rounds / 100 + 1;
+    start = now();
+    for (int i = 0; i < naive_rounds; i++)
+    {
+        auto segs = TopicTrie<int>::split(topics[i % topics.size()]);
+        for (auto& pat : split)
+            matched += naiveMatch(pat, 0, segs, 0);
+    }
+    double naive_cost = now() - start;
+
+    printf("patterns: %d, trie: %.0f ns/match, naive: %.0f ns/match (%zu)\n", pattern_num,
+        trie_cost / rounds * 1e9, naive_cost / naive_rounds * 1e9, matched);
+    return 0;
+}
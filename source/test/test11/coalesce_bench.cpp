@@ -0,0 +1,52 @@
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 小消息扇出: 一个发布者以批量、不确认的方式向一个主题发布，多个订阅者接收
+// 每个批量请求在服务端的同一轮循环中产生多条推送，开启推送合并后每个订阅者连接合并为一次写入
+// ./coalesce_bench [port] [订阅者数] [发布条数] [每批条数] [消息长度]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int sub_num = argc > 2 ? atoi(argv[2]) : 16;
+    long total = argc > 3 ? atol(argv[3]) : 200000;
+    int batch = argc > 4 ? atoi(argv[4]) : 100;
+    int payload = argc > 5 ? atoi(argv[5]) : 32;
+
+    Client::TopicClient publisher("127.0.0.1", port);
+    publisher.createTopic("fanout");
+
+    std::atomic<long> received(0);
+    std::vector<std::shared_ptr<Client::TopicClient>> subscribers;
+    for (int i = 0; i < sub_num; i++)
+    {
+        auto sub = std::make_shared<Client::TopicClient>("127.0.0.1", port);
+        sub->subscribeTopic("fanout", [&received](const std::string&, const std::string&) { received++; });
+        subscribers.push_back(sub);
+    }
+
+    Client::TopicManager::Batch msgs(batch, std::make_pair(std::string("fanout"), std::string(payload, 'x')));
+    long expected = total / batch * batch * sub_num;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (long i = 0; i < total / batch; i++)
+        publisher.publishBatchNoAck(msgs);
+
+    // 等待全部送达，最多 30 秒
+    while (received < expected && std::chrono::steady_clock::now() - begin < std::chrono::seconds(30))
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    printf("subscribers: %d, published: %ld, batch: %d, payload: %d bytes, delivered: %ld/%ld, %.3f s, deliveries/s: %.0f\n",
+        sub_num, total / batch * batch, batch, payload, received.load(), expected, seconds, received / seconds);
+
+    for (auto& sub : subscribers)
+        sub->shutDown();
+    publisher.shutDown();
+    return 0;
+}
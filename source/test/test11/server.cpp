@@ -0,0 +1,22 @@
+#include "../../server/rpc_server.hpp"
+
+#include <cstdlib>
+
+// ./server [port] [I/O 线程数] [linger 微秒，-1 表示不合并推送]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int thread_num = argc > 2 ? atoi(argv[2]) : 0;
+    int linger_us = argc > 3 ? atoi(argv[3]) : -1;
+
+    auto server = std::make_shared<JsonRpc::Server::TopicServer>(port, thread_num);
+    if (linger_us >= 0)
+    {
+        JsonRpc::Server::CoalescePolicy coalesce;
+        coalesce.enabled = true;
+        coalesce.linger_us = linger_us;
+        server->setCoalescePolicy(coalesce);
+    }
+    server->start();
+    return 0;
+}
@@ -0,0 +1,140 @@
+// 消息正文编码压测: JSON 文本(JsonUtil) vs 紧凑二进制(BinaryCodec)
+// 每种消息先校验二进制编码与 JSON 文本解码出相同的值，再分别统计编码、解码耗时和正文长度
+// ./codec_bench [轮数]
+#include "../../common/binary_codec.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 单条主题推送，消息内容为 JSON 文本
+static Json::Value topicPublish()
+{
+    Json::Value val;
+    val[KEY_TOPIC_KEY] = "market.sh.600000";
+    val[KEY_TOPIC_MSG] = "{\"symbol\":\"600000\",\"price\":10.52,\"volume\":125300}";
+    val[KEY_OPTYPE] = 4;
+    val[KEY_TOPIC_SEQ] = (Json::UInt64)1234567;
+    return val;
+}
+
+// rpc 请求
+static Json::Value rpcRequest()
+{
+    Json::Value val;
+    val[KEY_METHOD] = "Add";
+    val[KEY_PARAMS]["num1"] = 11;
+    val[KEY_PARAMS]["num2"] = 22;
+    return val;
+}
+
+// 100 条的批量发布
+static Json::Value publishBatch()
+{
+    Json::Value val;
+    val[KEY_OPTYPE] = 5;
+    val[KEY_NO_ACK] = true;
+    for (int i = 0; i < 100; i++)
+    {
+        Json::Value item;
+        item[KEY_TOPIC_KEY] = "market.sh." + std::to_string(600000 + i);
+        item[KEY_TOPIC_MSG] = std::string(32, 'x');
+        val[KEY_TOPIC_BATCH].append(item);
+    }
+    return val;
+}
+
+// rpc 响应，结果为 50 条行情的对象数组，键名重复出现
+static Json::Value quoteResponse()
+{
+    Json::Value val;
+    val[KEY_RCODE] = 0;
+    for (int i = 0; i < 50; i++)
+    {
+        Json::Value quote;
+        quote["symbol"] = std::to_string(600000 + i);
+        quote["price"] = 10.0 + i * 0.01;
+        quote["volume"] = 100000 + i * 37;
+        quote["change"] = -0.25 + i * 0.01;
+        quote["halted"] = i % 10 == 0;
+        val[KEY_RESULT].append(quote);
+    }
+    return val;
+}
+
+static bool bench(const char* name, const Json::Value& val, int rounds)
+{
+    std::string json, binary;
+    JsonUtil::serialize(val, json);
+    BinaryCodec::serialize(val, binary);
+
+    // 与经过 JSON 文本往返的结果比较: 两种编码的接收方应得到相同的值
+    Json::Value expect, back;
+    JsonUtil::unSerialize(json, expect);
+    if (!BinaryCodec::unSerialize(binary, back) || back != expect)
+    {
+        printf("%s: binary roundtrip MISMATCH\n", name);
+        return false;
+    }
+
+    size_t sink = 0;
+    double start = now();
+    for (int i = 0; i < rounds; i++)
+    {
+        std::string body;
+        JsonUtil::serialize(val, body);
+        sink += body.size();
+    }
+    double json_enc = now() - start;
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+    {
+        Json::Value out;
+        JsonUtil::unSerialize(json, out);
+        sink += out.size();
+    }
+    double json_dec = now() - start;
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+    {
+        std::string body;
+        BinaryCodec::serialize(val, body);
+        sink += body.size();
+    }
+    double bin_enc = now() - start;
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+    {
+        Json::Value out;
+        BinaryCodec::unSerialize(binary, out);
+        sink += out.size();
+    }
+    double bin_dec = now() - start;
+
+    printf("%-14s json: %5zu bytes, enc %7.0f ns, dec %7.0f ns | binary: %5zu bytes, enc %7.0f ns, dec %7.0f ns | speedup enc %.1fx dec %.1fx (%zu)\n",
+        name, json.size(), json_enc / rounds * 1e9, json_dec / rounds * 1e9,
+        binary.size(), bin_enc / rounds * 1e9, bin_dec / rounds * 1e9,
+        json_enc / bin_enc, json_dec / bin_dec, sink);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 100000;
+
+    bool ok = bench("topic_publish", topicPublish(), rounds)
+        && bench("rpc_request", rpcRequest(), rounds)
+        && bench("publish_batch", publishBatch(), rounds / 50 + 1)
+        && bench("quote_response", quoteResponse(), rounds / 50 + 1);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#include <iostream>
+
+#include "../../common/util.hpp"
+#include "../../client/rpc_client.hpp"
+
+using namespace JsonRpc;
+
+// 同一个服务端上，protobuf 连接与 JSON 连接的调用结果相同
+int main()
+{
+    Client::RpcClient pb_client(false, "127.0.0.1", 6666, BodyCodec::CODEC_PROTOBUF);
+    Client::RpcClient json_client(false, "127.0.0.1", 6666);
+
+    for (int i = 0; i < 3; i++)
+    {
+        Json::Value params, pb_result, json_result;
+        params["num1"] = 11 * i;
+        params["num2"] = 22 * i;
+        bool pb_ret = pb_client.call("Add", params, pb_result);
+        bool json_ret = json_client.call("Add", params, json_result);
+        std::cout << "protobuf: " << (pb_ret ? pb_result.asInt() : -1)
+                  << ", json: " << (json_ret ? json_result.asInt() : -1) << std::endl;
+    }
+
+    Json::Value params, result;
+    params["num1"] = 33;
+    params["num2"] = 44;
+    Client::RpcCaller::JsonAsyncResponse res_future;
+    if (pb_client.call("Add", params, res_future))
+        std::cout << "async protobuf: " << res_future.get().asInt() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <iostream>
+
+#include "../../common/util.hpp"
+#include "../../server/rpc_server.hpp"
+
+using namespace JsonRpc;
+
+void Add(Json::Value& req, Json::Value& rsp)
+{
+    int num1 = req["num1"].asInt();
+    int num2 = req["num2"].asInt();
+    rsp = num1 + num2;
+}
+
+// 服务端不需要额外配置: 客户端握手选择 protobuf 的连接切换为 ProtobufProtocol，其余连接继续使用 JSON
+int main()
+{
+    auto desc_build = std::make_shared<Server::ServiceDescriberBuilder>();
+    desc_build->setName("Add");
+    desc_build->setParamsDesc("num1", Server::VType::INTERGAL);
+    desc_build->setParamsDesc("num2", Server::VType::INTERGAL);
+    desc_build->setReturnType(Server::VType::INTERGAL);
+    desc_build->setCallback(Add);
+
+    Server::RpcServer server({"127.0.0.1", 6666});
+    server.registerMethod(desc_build->build());
+    server.start();
+    return 0;
+}
@@ -0,0 +1,129 @@
+// 帧解码压测: 拷贝解码(改动前的 LVProtocol::onMessage) vs 在接收缓冲区上直接解码
+// 替换全局 operator new 统计每条消息的堆分配次数
+// ./decode_bench [消息数]
+#include "../../common/net.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace JsonRpc;
+
+static size_t g_allocs = 0;
+
+void* operator new(size_t size)
+{
+    g_allocs++;
+    void* p = malloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 改动前的解码路径: 每次回调包装一次缓冲区，id、正文各拷贝一次，每次解析都构造 CharReaderBuilder，总是保留原始正文
+static bool copyingDecode(muduo::net::Buffer* buffer, BaseMessage::s_ptr& msg)
+{
+    BaseBuffer::s_ptr buf = BufferFactory::create(buffer);
+    int32_t totalLen = buf->readInt32();
+    MType mtype = (MType)buf->readInt32();
+    int32_t idLen = buf->readInt32();
+    std::string id = buf->retrieveAsString(idLen);
+    std::string body = buf->retrieveAsString(totalLen - 8 - idLen);
+
+    msg = MessageFactory::create(mtype);
+    Json::CharReaderBuilder crb;
+    std::unique_ptr<Json::CharReader> cr(crb.newCharReader());
+    Json::Value val; // 与改动前解析进消息正文的分配次数相同
+    std::string errs;
+    if (!cr->parse(body.c_str(), body.c_str() + body.size(), &val, &errs))
+        return false;
+
+    msg->setMtype(mtype);
+    std::string rid = id;
+    msg->setRid(rid);
+    msg->setRawBody(std::move(body));
+    return true;
+}
+
+static bool bench(const char* name, const BaseMessage::s_ptr& msg, int count)
+{
+    LVProtocol proto;
+    std::string frame = proto.serialize(msg);
+
+    muduo::net::Buffer buffer;
+    BaseBuffer::s_ptr input = BufferFactory::create(&buffer); // 对应连接上缓存的包装
+    double copy_cost = 0, inplace_cost = 0;
+    size_t copy_allocs = 0, inplace_allocs = 0;
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            buffer.append(frame.data(), frame.size());
+            BaseMessage::s_ptr out;
+            size_t allocs = g_allocs;
+            double start = now();
+            bool ok = round == 0 ? copyingDecode(&buffer, out) : proto.onMessage(input, out);
+            double cost = now() - start;
+            if (!ok || out->rid() != msg->rid() || buffer.readableBytes() != 0)
+            {
+                printf("%s: decode FAILED\n", name);
+                return false;
+            }
+            (round == 0 ? copy_cost : inplace_cost) += cost;
+            (round == 0 ? copy_allocs : inplace_allocs) += g_allocs - allocs;
+        }
+    }
+
+    printf("%-14s frame %4zu bytes | copying: %5.1f allocs, %6.0f ns | in-place: %5.1f allocs, %6.0f ns\n",
+        name, frame.size(), (double)copy_allocs / count, copy_cost / count * 1e9,
+        (double)inplace_allocs / count, inplace_cost / count * 1e9);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+
+    auto rpc = MessageFactory::create<RpcRequest>();
+    rpc->setMtype(MType::REQ_RPC);
+    rpc->setRid(UUID::uuid());
+    rpc->setMethod("Add");
+    Json::Value params;
+    params["num1"] = 11;
+    params["num2"] = 22;
+    rpc->setParams(params);
+
+    auto publish = MessageFactory::create<TopicRequest>();
+    publish->setMtype(MType::REQ_TOPIC);
+    publish->setRid(UUID::uuid());
+    publish->setTopicKey("market.sh.600000");
+    publish->setTopicOpType(TopicOpType::TOPIC_PUBLISH);
+    publish->setTopicMsg("{\"symbol\":\"600000\",\"price\":10.52,\"volume\":125300}");
+
+    auto response = MessageFactory::create<TopicResponse>();
+    response->setMtype(MType::RSP_TOPIC);
+    response->setRid(UUID::uuid());
+    response->setRcode(RetCode::RCODE_OK);
+
+    bool ok = bench("rpc_request", rpc, count)
+        && bench("topic_publish", publish, count)
+        && bench("topic_response", response, count);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+// 帧编码压测: 经过临时 string 编码(改动前的 LVProtocol::serialize) vs 直接编码到缓冲区
+// 替换全局 operator new 统计每个响应的堆分配次数和分配的字节数
+// 分配的字节数 / 帧长度 近似为帧数据被整体拷贝的次数
+// ./encode_bench [响应数]
+#include "../../common/net.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace JsonRpc;
+
+static size_t g_allocs = 0;
+static size_t g_alloc_bytes = 0;
+
+void* operator new(size_t size)
+{
+    g_allocs++;
+    g_alloc_bytes += size;
+    void* p = malloc(size);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 改动前的编码路径: stringstream 序列化正文，ss.str() 取出，再与帧头拼接为新的 string
+static std::string stringEncode(const BaseMessage::s_ptr& msg, const Json::Value& body)
+{
+    std::stringstream ss;
+    Json::StreamWriterBuilder swb;
+    std::unique_ptr<Json::StreamWriter> sw(swb.newStreamWriter());
+    sw->write(body, &ss);
+    std::string data = ss.str();
+
+    int32_t mtype = htonl((int32_t)msg->mtype());
+    std::string id = msg->rid();
+    int32_t idLen = htonl(id.size());
+    int32_t totalLen = 8 + id.size() + data.size();
+
+    std::string result;
+    result.reserve(totalLen + 4);
+    totalLen = htonl(totalLen);
+    result.append((char*)&totalLen, 4);
+    result.append((char*)&mtype, 4);
+    result.append((char*)&idLen, 4);
+    result.append(id);
+    result.append(data);
+    return result;
+}
+
+static bool bench(const char* name, const BaseMessage::s_ptr& msg, const Json::Value& body, int count)
+{
+    LVProtocol proto;
+    muduo::net::Buffer buffer; // 对应 MuduoConnection::send 中线程局部的缓冲区
+    MuduoBuffer out(&buffer);
+
+    std::string expect = stringEncode(msg, body);
+    buffer.retrieveAll();
+    proto.serializeTo(msg, out);
+    if (buffer.retrieveAllAsString() != expect)
+    {
+        printf("%s: encode MISMATCH\n", name);
+        return false;
+    }
+
+    size_t sink = 0;
+    size_t allocs = g_allocs, bytes = g_alloc_bytes;
+    double start = now();
+    for (int i = 0; i < count; i++)
+        sink += stringEncode(msg, body).size();
+    double string_cost = now() - start;
+    size_t string_allocs = g_allocs - allocs, string_bytes = g_alloc_bytes - bytes;
+
+    allocs = g_allocs, bytes = g_alloc_bytes;
+    start = now();
+    for (int i = 0; i < count; i++)
+    {
+        buffer.retrieveAll();
+        proto.serializeTo(msg, out);
+        sink += buffer.readableBytes();
+    }
+    double buffer_cost = now() - start;
+    size_t buffer_allocs = g_allocs - allocs, buffer_bytes = g_alloc_bytes - bytes;
+
+    printf("%-14s frame %5zu bytes | string: %5.1f allocs, %5.1f copies, %7.0f ns | buffer: %5.1f allocs, %5.1f copies, %7.0f ns (%zu)\n",
+        name, expect.size(),
+        (double)string_allocs / count, (double)string_bytes / count / expect.size(), string_cost / count * 1e9,
+        (double)buffer_allocs / count, (double)buffer_bytes / count / expect.size(), buffer_cost / count * 1e9, sink);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+
+    auto rpc = MessageFactory::create<RpcResponse>();
+    rpc->setMtype(MType::RSP_RPC);
+    rpc->setRid(UUID::uuid());
+    rpc->setRcode(RetCode::RCODE_OK);
+    rpc->setResult(33);
+    Json::Value rpc_body;
+    rpc_body[KEY_RCODE] = 0;
+    rpc_body[KEY_RESULT] = 33;
+
+    // 50 条行情的查询结果
+    auto quotes = MessageFactory::create<RpcResponse>();
+    quotes->setMtype(MType::RSP_RPC);
+    quotes->setRid(UUID::uuid());
+    quotes->setRcode(RetCode::RCODE_OK);
+    Json::Value result;
+    for (int i = 0; i < 50; i++)
+    {
+        Json::Value quote;
+        quote["symbol"] = std::to_string(600000 + i);
+        quote["price"] = 10.0 + i * 0.01;
+        quote["volume"] = 100000 + i * 37;
+        result.append(quote);
+    }
+    quotes->setResult(result);
+    Json::Value quotes_body;
+    quotes_body[KEY_RCODE] = 0;
+    quotes_body[KEY_RESULT] = result;
+
+    auto topic = MessageFactory::create<TopicResponse>();
+    topic->setMtype(MType::RSP_TOPIC);
+    topic->setRid(UUID::uuid());
+    topic->setRcode(RetCode::RCODE_OK);
+    Json::Value topic_body;
+    topic_body[KEY_RCODE] = 0;
+
+    bool ok = bench("rpc_response", rpc, rpc_body, count)
+        && bench("quote_response", quotes, quotes_body, count / 20 + 1)
+        && bench("topic_response", topic, topic_body, count);
+    return ok ? 0 : 1;
+}
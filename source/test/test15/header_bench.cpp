@@ -0,0 +1,123 @@
+// 帧头压测: v1(字符串 uuid rid + 4 byte 定长字段) vs v2(varint 长度 + 1 byte mtype + 整数关联 id)
+// 每次调用模拟一个请求的完整 id 开销: 生成 id、登记请求表、编码请求帧、解码响应帧、查找并删除请求
+// ./header_bench [调用次数]
+#include "../../common/net.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+using namespace JsonRpc;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 改动前的 UUID::uuid: 每次构造 random_device、mt19937，经 stringstream 格式化
+static std::string legacyUuid()
+{
+    std::stringstream ss;
+    std::random_device rd;
+    std::mt19937 generator(rd());
+    std::uniform_int_distribution<int> distribution(0, 255);
+    for (int i = 0; i < 8; i++)
+    {
+        if (i == 4 || i == 6)
+            ss << "-";
+        ss << std::setw(2) << std::setfill('0') << std::hex << distribution(generator);
+    }
+    ss << "-";
+    static std::atomic<size_t> seq(1);
+    size_t cur = seq.fetch_add(1);
+    for (int i = 7; i >= 0; i--)
+    {
+        if (i == 5)
+            ss << "-";
+        ss << std::setw(2) << std::setfill('0') << std::hex << ((cur >> (i * 8)) & 0xFF);
+    }
+    return ss.str();
+}
+
+static RpcRequest::s_ptr newRequest()
+{
+    auto req = MessageFactory::create<RpcRequest>();
+    req->setMtype(MType::REQ_RPC);
+    req->setMethod("Add");
+    Json::Value params;
+    params["num1"] = 11;
+    params["num2"] = 22;
+    req->setParams(params);
+    return req;
+}
+
+// 编码请求帧，再作为响应帧解码(只比较帧头开销，正文相同)
+static BaseMessage::s_ptr transfer(const BaseProtocol::s_ptr& proto, const BaseMessage::s_ptr& req,
+    const BaseBuffer::s_ptr& in, size_t& frameLen)
+{
+    in->retrieve(in->readableSize());
+    proto->serializeTo(req, *in);
+    frameLen = in->readableSize();
+
+    BaseMessage::s_ptr rsp;
+    if (!proto->canProcessed(in) || !proto->onMessage(in, rsp))
+        return BaseMessage::s_ptr();
+    return rsp;
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+    auto req = newRequest();
+    muduo::net::Buffer buffer;
+    BaseBuffer::s_ptr in = BufferFactory::create(&buffer);
+    size_t v1_len = 0, v2_len = 0, sink = 0;
+
+    // v1: 字符串 rid，请求表以字符串为键
+    BaseProtocol::s_ptr v1 = ProtocolFactory::create(BodyCodec::CODEC_JSON, FrameVersion::FRAME_V1);
+    std::unordered_map<std::string, int> v1_table;
+    double start = now();
+    for (int i = 0; i < count; i++)
+    {
+        req->setRid(legacyUuid());
+        v1_table[req->rid()] = i;
+        BaseMessage::s_ptr rsp = transfer(v1, req, in, v1_len);
+        if (!rsp || !v1_table.count(rsp->rid()))
+        {
+            printf("v1: response MISMATCH\n");
+            return 1;
+        }
+        sink += v1_table[rsp->rid()];
+        v1_table.erase(rsp->rid());
+    }
+    double v1_cost = now() - start;
+
+    // v2: 连接上的关联 id 计数器，请求表以整数为键
+    BaseProtocol::s_ptr v2 = ProtocolFactory::create(BodyCodec::CODEC_JSON, FrameVersion::FRAME_V2);
+    req->setRid(std::string());
+    std::atomic<uint64_t> counter(0);
+    std::unordered_map<uint64_t, int> v2_table;
+    start = now();
+    for (int i = 0; i < count; i++)
+    {
+        req->setCid(counter.fetch_add(1, std::memory_order_relaxed) + 1);
+        v2_table[req->cid()] = i;
+        BaseMessage::s_ptr rsp = transfer(v2, req, in, v2_len);
+        if (!rsp || !v2_table.count(rsp->cid()))
+        {
+            printf("v2: response MISMATCH\n");
+            return 1;
+        }
+        sink += v2_table[rsp->cid()];
+        v2_table.erase(rsp->cid());
+    }
+    double v2_cost = now() - start;
+
+    // 帧头部分: 帧长度减去正文长度
+    size_t body = req->serialize().size();
+    printf("rpc_request  body %zu bytes | v1: frame %zu bytes (header %zu), %6.0f ns/call | v2: frame %zu bytes (header %zu), %6.0f ns/call (%zu)\n",
+        body, v1_len, v1_len - body, v1_cost / count * 1e9,
+        v2_len, v2_len - body, v2_cost / count * 1e9, sink);
+    return 0;
+}
@@ -0,0 +1,128 @@
+// 帧正文压缩压测: 服务发现的主机列表、大的 rpc 结果、小的 rpc 响应
+// 每种消息分别用未压缩的协议和协商了压缩的协议编码，校验解压后的消息一致，统计帧长度与压缩、解压耗时
+// 启用的算法由编译选项决定，见 makefile
+// ./compress_bench [轮数]
+#include "../../common/net.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 200 个服务提供方的发现结果
+static BaseMessage::s_ptr serviceResponse()
+{
+    auto rsp = MessageFactory::create<ServiceResponse>();
+    rsp->setMtype(MType::RSP_SERVICE);
+    rsp->setCid(1);
+    rsp->setRcode(RetCode::RCODE_OK);
+    rsp->setOptype(ServiceOpType::SERVICE_DISCOVER);
+    rsp->setMethod("Add");
+    std::vector<Address> hosts;
+    for (int i = 0; i < 200; i++)
+        hosts.push_back(Address("10.0." + std::to_string(i / 100) + "." + std::to_string(i % 100), 9000 + i % 8));
+    rsp->setHosts(hosts);
+    return rsp;
+}
+
+// 500 条行情的 rpc 结果
+static BaseMessage::s_ptr quoteResponse()
+{
+    auto rsp = MessageFactory::create<RpcResponse>();
+    rsp->setMtype(MType::RSP_RPC);
+    rsp->setCid(2);
+    rsp->setRcode(RetCode::RCODE_OK);
+    Json::Value result;
+    for (int i = 0; i < 500; i++)
+    {
+        Json::Value quote;
+        quote["symbol"] = std::to_string(600000 + i);
+        quote["price"] = 10.0 + i * 0.01;
+        quote["volume"] = 100000 + i * 37;
+        quote["halted"] = i % 10 == 0;
+        result.append(quote);
+    }
+    rsp->setResult(result);
+    return rsp;
+}
+
+// 低于阈值，不压缩
+static BaseMessage::s_ptr smallResponse()
+{
+    auto rsp = MessageFactory::create<RpcResponse>();
+    rsp->setMtype(MType::RSP_RPC);
+    rsp->setCid(3);
+    rsp->setRcode(RetCode::RCODE_OK);
+    rsp->setResult(33);
+    return rsp;
+}
+
+static bool bench(const char* name, const BaseMessage::s_ptr& msg, CompressType type, int rounds)
+{
+    CompressPolicy policy;
+    policy.type = type;
+    BaseProtocol::s_ptr plain = ProtocolFactory::create(BodyCodec::CODEC_JSON, FrameVersion::FRAME_V2);
+    BaseProtocol::s_ptr proto = ProtocolFactory::create(BodyCodec::CODEC_JSON, FrameVersion::FRAME_V2, policy);
+
+    std::string expect = plain->serialize(msg);
+    std::string frame = proto->serialize(msg);
+
+    // 解压后与未压缩的帧解码出相同的正文
+    muduo::net::Buffer buffer;
+    BaseBuffer::s_ptr in = BufferFactory::create(&buffer);
+    buffer.append(frame.data(), frame.size());
+    BaseMessage::s_ptr back;
+    if (!proto->canProcessed(in) || !proto->onMessage(in, back) || plain->serialize(back) != expect)
+    {
+        printf("%s: compress roundtrip MISMATCH\n", name);
+        return false;
+    }
+
+    size_t sink = 0;
+    double start = now();
+    for (int i = 0; i < rounds; i++)
+        sink += proto->serialize(msg).size();
+    double enc = now() - start;
+
+    start = now();
+    for (int i = 0; i < rounds; i++)
+    {
+        buffer.append(frame.data(), frame.size());
+        proto->onMessage(in, back);
+        sink += back->cid();
+    }
+    double dec = now() - start;
+
+    printf("%-16s type %d | frame %6zu -> %6zu bytes (%4.1fx) | enc %8.0f ns, dec %8.0f ns (%zu)\n",
+        name, (int)type, expect.size(), frame.size(), (double)expect.size() / frame.size(),
+        enc / rounds * 1e9, dec / rounds * 1e9, sink);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+
+    bool ok = true;
+    for (auto type : {CompressType::COMPRESS_NONE, CompressType::COMPRESS_ZLIB, CompressType::COMPRESS_LZ4, CompressType::COMPRESS_ZSTD})
+    {
+        if (!CompressorFactory::supported(type))
+            continue;
+        ok = ok && bench("service_response", serviceResponse(), type, rounds)
+            && bench("quote_response", quoteResponse(), type, rounds / 5 + 1)
+            && bench("small_response", smallResponse(), type, rounds * 10);
+    }
+
+    CompressStats stats = Compressor::stats();
+    printf("compressed %lu frames, skipped %lu, saved %lu of %lu bytes, compress cpu %.1f ms, decompress cpu %.1f ms\n",
+        (unsigned long)stats.compressed_frames, (unsigned long)stats.skipped_frames,
+        (unsigned long)stats.savedBytes(), (unsigned long)stats.raw_bytes,
+        stats.compress_ns / 1e6, stats.decompress_ns / 1e6);
+    return ok ? 0 : 1;
+}
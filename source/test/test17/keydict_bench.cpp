@@ -0,0 +1,116 @@
+// 连接键字典压测: RpcCaller 产生的小请求、小响应，分别用 JSON、二进制、二进制 + 键字典编码
+// 模拟一个连接: 发送方和接收方各持有一个键字典，连续编码、解码同一类消息，校验解码结果一致
+// 统计第一帧(键原样发送)与之后各帧(键只发送序号)的长度，以及每帧的编码 + 解码耗时
+// ./keydict_bench [帧数]
+#include "../../common/net.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static BaseMessage::s_ptr addRequest()
+{
+    auto req = MessageFactory::create<RpcRequest>();
+    req->setMtype(MType::REQ_RPC);
+    req->setCid(1);
+    req->setMethod("Add");
+    Json::Value params;
+    params["num1"] = 11;
+    params["num2"] = 22;
+    req->setParams(params);
+    return req;
+}
+
+// 应用自己的参数名比参数值长
+static BaseMessage::s_ptr profileRequest()
+{
+    auto req = MessageFactory::create<RpcRequest>();
+    req->setMtype(MType::REQ_RPC);
+    req->setCid(2);
+    req->setMethod("GetUserProfile");
+    Json::Value params;
+    params["user_id"] = 10086;
+    params["include_friends"] = true;
+    params["locale"] = "zh";
+    params["fields"].append("nickname");
+    params["fields"].append("avatar");
+    req->setParams(params);
+    return req;
+}
+
+static BaseMessage::s_ptr profileResponse()
+{
+    auto rsp = MessageFactory::create<RpcResponse>();
+    rsp->setMtype(MType::RSP_RPC);
+    rsp->setCid(2);
+    rsp->setRcode(RetCode::RCODE_OK);
+    Json::Value result;
+    result["user_id"] = 10086;
+    result["nickname"] = "tom";
+    result["avatar_url"] = "a/1.png";
+    result["friend_count"] = 12;
+    result["last_login_time"] = 1700000000;
+    rsp->setResult(result);
+    return rsp;
+}
+
+// 返回 false 表示解码结果与原消息不一致
+static bool bench(const char* name, const BaseMessage::s_ptr& msg, BodyCodec codec, int count)
+{
+    BaseProtocol::s_ptr plain = ProtocolFactory::create(BodyCodec::CODEC_BINARY, FrameVersion::FRAME_V2);
+    BaseProtocol::s_ptr proto = ProtocolFactory::create(codec, FrameVersion::FRAME_V2);
+    std::string expect = plain->serialize(msg);
+
+    KeyDictionary send_keys, receive_keys; // 连接两端各自的字典
+    muduo::net::Buffer buffer;
+    BaseBuffer::s_ptr in = BufferFactory::create(&buffer);
+    size_t first = 0, steady = 0, sink = 0;
+
+    double start = now();
+    for (int i = 0; i < count; i++)
+    {
+        proto->serializeTo(msg, *in, &send_keys);
+        if (i == 0)
+            first = in->readableSize();
+        steady = in->readableSize();
+
+        BaseMessage::s_ptr back;
+        if (!proto->canProcessed(in) || !proto->onMessage(in, back, &receive_keys))
+        {
+            printf("%s: decode FAILED\n", name);
+            return false;
+        }
+        if (i == 0 && plain->serialize(back) != expect)
+        {
+            printf("%s: roundtrip MISMATCH\n", name);
+            return false;
+        }
+        sink += back->cid();
+    }
+    double cost = now() - start;
+
+    printf("%-16s codec %d | first frame %3zu bytes, then %3zu bytes | %6.0f ns/frame (%zu)\n",
+        name, (int)codec, first, steady, cost / count * 1e9, sink);
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    int count = argc > 1 ? atoi(argv[1]) : 100000;
+
+    bool ok = true;
+    for (auto codec : {BodyCodec::CODEC_JSON, BodyCodec::CODEC_BINARY, BodyCodec::CODEC_BINARY_DICT})
+    {
+        ok = ok && bench("add_request", addRequest(), codec, count)
+            && bench("profile_request", profileRequest(), codec, count)
+            && bench("profile_response", profileResponse(), codec, count);
+    }
+    return ok ? 0 : 1;
+}
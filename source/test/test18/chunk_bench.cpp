@@ -0,0 +1,61 @@
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 大消息与小调用共用一个连接: 一个线程连续获取大结果，主线程同时发起小调用，统计小调用的延迟
+// 不分片时小调用的响应排在整个大结果之后，分片后最多排在一个分片之后
+// ./chunk_bench [port] [大结果长度] [小调用次数]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int blob_size = argc > 2 ? atoi(argv[2]) : 4 * 1024 * 1024;
+    int calls = argc > 3 ? atoi(argv[3]) : 2000;
+
+    // 握手后才能分片，使用 v2 帧头
+    Client::RpcClient client(false, "127.0.0.1", port, BodyCodec::CODEC_BINARY, FrameVersion::FRAME_V2);
+
+    std::atomic<bool> running(true);
+    std::atomic<long> blobs(0);
+    std::atomic<long> errors(0);
+    std::thread bulk([&]() {
+        Json::Value params;
+        params["size"] = blob_size;
+        while (running)
+        {
+            Json::Value result;
+            if (!client.call("Blob", params, result) || result.asString().size() != (size_t)blob_size)
+                errors++;
+            else
+                blobs++;
+        }
+    });
+
+    std::vector<double> latency;
+    latency.reserve(calls);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++)
+    {
+        Json::Value params, result;
+        params["num1"] = i;
+        params["num2"] = 1;
+        auto start = std::chrono::steady_clock::now();
+        if (!client.call("Add", params, result) || result.asInt() != i + 1)
+            errors++;
+        latency.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    running = false;
+    bulk.join();
+
+    std::sort(latency.begin(), latency.end());
+    printf("blob %d bytes: %ld blobs (%.1f MB/s) | small calls p50 %.0f us, p99 %.0f us, max %.0f us | errors %ld\n",
+        blob_size, blobs.load(), blobs.load() * (double)blob_size / cost / 1e6,
+        latency[calls / 2], latency[calls * 99 / 100], latency.back(), errors.load());
+    return errors == 0 ? 0 : 1;
+}
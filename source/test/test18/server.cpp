@@ -0,0 +1,43 @@
+#include "../../server/rpc_server.hpp"
+
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+void Add(Json::Value& req, Json::Value& rsp)
+{
+    rsp = req["num1"].asInt() + req["num2"].asInt();
+}
+
+// 返回 size byte 的字符串
+void Blob(Json::Value& req, Json::Value& rsp)
+{
+    rsp = std::string(req["size"].asInt(), 'x');
+}
+
+// ./server [port] [分片长度，0 表示不分片]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    size_t chunk = argc > 2 ? atol(argv[2]) : 64 * 1024;
+
+    auto add = std::make_shared<Server::ServiceDescriberBuilder>();
+    add->setName("Add");
+    add->setParamsDesc("num1", Server::VType::INTERGAL);
+    add->setParamsDesc("num2", Server::VType::INTERGAL);
+    add->setReturnType(Server::VType::INTERGAL);
+    add->setCallback(Add);
+
+    auto blob = std::make_shared<Server::ServiceDescriberBuilder>();
+    blob->setName("Blob");
+    blob->setParamsDesc("size", Server::VType::INTERGAL);
+    blob->setReturnType(Server::VType::STRING);
+    blob->setCallback(Blob);
+
+    Server::RpcServer server({"127.0.0.1", port});
+    server.registerMethod(add->build());
+    server.registerMethod(blob->build());
+    server.setChunkSize(chunk);
+    server.start();
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "../../client/rpc_client.hpp"
+
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 推送超过分片长度的主题消息: 订阅者完整收到大消息，且之后发布的小消息排在它后面到达
+// ./topic_chunk_test [port] [大消息长度]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    size_t size = argc > 2 ? atol(argv[2]) : 1024 * 1024;
+
+    // 握手后才能分片，使用 v2 帧头
+    Client::TopicClient publisher("127.0.0.1", port, BodyCodec::CODEC_BINARY, FrameVersion::FRAME_V2);
+    Client::TopicClient subscriber("127.0.0.1", port, BodyCodec::CODEC_BINARY, FrameVersion::FRAME_V2);
+
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::vector<std::string> received;
+    auto cb = [&](const std::string&, const std::string& msg) {
+        std::unique_lock<std::mutex> lock(mtx);
+        received.push_back(msg);
+        cond.notify_all();
+    };
+
+    std::string big(size, 'x');
+    bool ok = publisher.createTopic("chunk") && subscriber.subscribeTopic("chunk", cb)
+        && publisher.publishTopic("chunk", big) && publisher.publishTopic("chunk", "small");
+
+    std::unique_lock<std::mutex> lock(mtx);
+    ok = ok && cond.wait_for(lock, std::chrono::seconds(5), [&]() { return received.size() >= 2; });
+    bool intact = ok && received[0] == big;
+    bool ordered = ok && received[1] == "small";
+    printf("large push: %s\n", intact ? "OK" : "MISMATCH");
+    printf("order:      %s\n", ordered ? "OK" : "MISMATCH");
+    lock.unlock();
+
+    publisher.shutDown();
+    subscriber.shutDown();
+    return intact && ordered ? 0 : 1;
+}
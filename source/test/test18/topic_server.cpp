@@ -0,0 +1,17 @@
+#include "../../server/rpc_server.hpp"
+
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// ./topic_server [port] [分片长度，0 表示不分片]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    size_t chunk = argc > 2 ? atol(argv[2]) : 64 * 1024;
+
+    Server::TopicServer server(port);
+    server.setChunkSize(chunk);
+    server.start();
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include "../../client/rpc_client.hpp"
+
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 服务端刷盘失败时，持久化主题的发布(单条、异步、批量)都应该返回失败
+// ./publish_fail_test [port]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+
+    Client::TopicClient client("127.0.0.1", port);
+    if (!client.createTopic("durable"))
+    {
+        printf("create topic: MISMATCH\n");
+        return 1;
+    }
+
+    bool sync = !client.publishTopic("durable", "hello");
+    bool async = !client.publishTopicAsync("durable", "hello").get();
+    bool batch = !client.publishBatch({ {"durable", "a"}, {"durable", "b"} });
+    printf("publish: %s\n", sync ? "OK" : "MISMATCH");
+    printf("async:   %s\n", async ? "OK" : "MISMATCH");
+    printf("batch:   %s\n", batch ? "OK" : "MISMATCH");
+
+    client.shutDown();
+    return sync && async && batch ? 0 : 1;
+}
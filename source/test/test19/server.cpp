@@ -0,0 +1,25 @@
+#include "../../server/rpc_server.hpp"
+
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 所有主题持久化，刷盘函数总是失败，用于验证发布者收到错误响应
+// ./server [port] [存储目录]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    std::string root = argc > 2 ? argv[2] : "./fail_data";
+
+    Server::DurablePolicy durable;
+    durable.durable = true;
+
+    auto store = std::make_shared<Server::TopicStore>(root);
+    store->setSyncFunc([](const Server::TopicLog::s_ptr&) { return false; });
+
+    Server::TopicServer server(port);
+    server.setStorage(store);
+    server.setDefaultDurable(durable);
+    server.start();
+    return 0;
+}
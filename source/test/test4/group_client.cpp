@@ -0,0 +1,36 @@
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+
+void callback(const std::string& key, const std::string& msg)
+{
+    I_LOG("%s 收到共享订阅消息: %s", key.c_str(), msg.c_str());
+}
+
+// 启动多个实例，同组的实例分担 hello 主题的消息，每条消息只有一个实例收到
+int main(int argc, char* argv[])
+{
+    std::string group = argc > 1 ? argv[1] : "workers";
+
+    // 实例化客户端
+    auto client = std::make_shared<JsonRpc::Client::TopicClient>("127.0.0.1", 6666);
+
+    bool ret = client->createTopic("hello");
+    if (ret == false)
+        E_LOG("创建主题失败!");
+
+    // 以共享订阅方式订阅主题，组内按积压最少的成员分配
+    JsonRpc::Client::SubscribeOptions options;
+    options.group = group;
+    options.balance = JsonRpc::GroupBalance::GROUP_LEAST_OUTSTANDING;
+    ret = client->subscribeTopic("hello", callback, options);
+    if (ret == false)
+        E_LOG("主题订阅失败!");
+
+    // 等待
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    client->shutDown();
+
+    return 0;
+}
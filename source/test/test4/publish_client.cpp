@@ -13,6 +13,14 @@ int main()
     for (int i = 0; i < 10; i++)
         client->publishTopic("hello", "hellowold!" + std::to_string(i));
 
+    // 发布 JSON 消息，供带过滤条件的订阅者筛选
+    bool ok = client->createTopic("quote");
+    if (ok == false)
+        E_LOG("创建主题失败!");
+    const char* symbols[] = { "600000", "600036", "000001" };
+    for (int i = 0; i < 9; i++)
+        client->publishTopic("quote", "{\"symbol\":\"" + std::string(symbols[i % 3]) + "\",\"price\":" + std::to_string(10 + i) + "}");
+
     client->shutDown();
     return 0;
 }
\ No newline at end of file
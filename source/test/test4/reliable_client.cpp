@@ -0,0 +1,38 @@
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+
+void callback(const std::string& key, const std::string& msg)
+{
+    I_LOG("%s 收到可靠推送消息: %s", key.c_str(), msg.c_str());
+}
+
+// 可靠订阅 hello 主题: 中途退出后以同一消费者标识重新启动，会先收到上次未确认的消息
+int main(int argc, char* argv[])
+{
+    std::string consumer = argc > 1 ? argv[1] : "reliable-consumer";
+
+    // 实例化客户端
+    auto client = std::make_shared<JsonRpc::Client::TopicClient>("127.0.0.1", 6666);
+
+    bool ret = client->createTopic("hello");
+    if (ret == false)
+        E_LOG("创建主题失败!");
+
+    // 每 32 条消息或 20ms 累计确认一次
+    JsonRpc::Client::SubscribeOptions options;
+    options.reliable = true;
+    options.consumer = consumer;
+    options.ack_batch = 32;
+    options.ack_delay = 0.02;
+    ret = client->subscribeTopic("hello", callback, options);
+    if (ret == false)
+        E_LOG("主题订阅失败!");
+
+    // 等待
+    std::this_thread::sleep_for(std::chrono::seconds(10));
+
+    client->shutDown();
+
+    return 0;
+}
@@ -4,6 +4,22 @@ int main()
 {
     auto server = std::make_shared<JsonRpc::Server::TopicServer>(6666);
 
+    // 每个主题保留最近 100 条消息，后订阅的客户端可以回放
+    JsonRpc::Server::RetentionPolicy retention;
+    retention.max_count = 100;
+    server->setDefaultRetention(retention);
+
+    // 行情主题按 symbol 合并，新订阅者立即收到每只股票的最新行情
+    JsonRpc::Server::KeyedPolicy keyed;
+    keyed.key_field = "symbol";
+    server->setTopicKeyed("quote", keyed);
+
+    // 可靠订阅每个消费者最多 128 条消息在途，2 秒未确认则重发
+    JsonRpc::Server::ReliablePolicy reliable;
+    reliable.window = 128;
+    reliable.redeliver_timeout = 2;
+    server->setReliablePolicy(reliable);
+
     server->start();
     return 0;
 }
\ No newline at end of file
@@ -19,8 +19,21 @@ int main()
 
     std::this_thread::sleep_for(std::chrono::seconds(2));
 
-    // 订阅主题
-    ret = client->subscribeTopic("hello", callback);
+    // 订阅主题，同时回放最近 10 条保留的消息
+    JsonRpc::Client::SubscribeOptions options;
+    options.replay_last = 10;
+    options.exec = JsonRpc::Client::CallbackPolicy::SERIAL_PER_TOPIC; // 回调在线程池中按主题串行执行，不阻塞 I/O 线程
+    ret = client->subscribeTopic("hello", callback, options);
+    if (ret == false)
+        E_LOG("主题订阅失败!");
+
+    // 只订阅 symbol 为 600000 或 600036 的行情，服务端过滤，不满足条件的消息不会推送
+    ret = client->createTopic("quote");
+    if (ret == false)
+        E_LOG("创建主题失败!");
+    JsonRpc::Client::SubscribeOptions quote_options;
+    quote_options.filter = JsonRpc::TopicFilter::in("symbol", { Json::Value("600000"), Json::Value("600036") });
+    ret = client->subscribeTopic("quote", callback, quote_options);
     if (ret == false)
         E_LOG("主题订阅失败!");
 
@@ -0,0 +1,15 @@
+#!/bin/bash
+# 对比不同 I/O 线程数下的吞吐
+PORT=${PORT:-6666}
+CONNS=${CONNS:-64}
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-10}
+
+for threads in 0 1 2 4 8; do
+    ./server $PORT $threads > /dev/null &
+    pid=$!
+    sleep 1
+    echo -n "io_threads: $threads, "
+    ./bench_client $PORT $CONNS $SECONDS_PER_RUN
+    kill $pid
+    wait $pid 2>/dev/null
+done
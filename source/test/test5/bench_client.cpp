@@ -0,0 +1,51 @@
+#include "../../common/util.hpp"
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 每个压测线程持有一个独立连接，循环发起同步调用
+// ./bench_client [port] [连接数] [压测秒数]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int conn_num = argc > 2 ? atoi(argv[2]) : 32;
+    int seconds = argc > 3 ? atoi(argv[3]) : 10;
+
+    std::atomic<bool> running(true);
+    std::atomic<long> total(0);
+    std::atomic<long> failed(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < conn_num; i++)
+    {
+        threads.emplace_back([&, i]() {
+            Client::RpcClient client(false, "127.0.0.1", port);
+            long count = 0;
+            while (running)
+            {
+                Json::Value params, result;
+                params["num1"] = i;
+                params["num2"] = (int)count;
+                if (client.call("Add", params, result))
+                    count++;
+                else
+                    failed++;
+            }
+            total += count;
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    printf("connections: %d, seconds: %d, calls: %ld, failed: %ld, qps: %.0f\n",
+        conn_num, seconds, total.load(), failed.load(), (double)total / seconds);
+    return 0;
+}
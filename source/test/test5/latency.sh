@@ -0,0 +1,14 @@
+#!/bin/bash
+# 对比慢方法 Fib 不同执行方式下，快方法 Add 的延迟
+PORT=${PORT:-6666}
+IO_THREADS=${IO_THREADS:-2}
+
+for policy in inline shared steal bulkhead; do
+    ./server $PORT $IO_THREADS $policy 2 > /dev/null &
+    pid=$!
+    sleep 1
+    echo -n "Fib policy: $policy, "
+    ./latency_client $PORT 4 4 10 30
+    kill $pid
+    wait $pid 2>/dev/null
+done
@@ -0,0 +1,79 @@
+#include "../../common/util.hpp"
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 若干连接持续调用慢方法 Fib，另外若干连接调用 Add 并统计延迟分布
+// ./latency_client [port] [Fib连接数] [Add连接数] [压测秒数] [fib参数]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int slow_num = argc > 2 ? atoi(argv[2]) : 4;
+    int fast_num = argc > 3 ? atoi(argv[3]) : 4;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    int fib_n = argc > 5 ? atoi(argv[5]) : 30;
+
+    std::atomic<bool> running(true);
+    std::mutex mtx;
+    std::vector<double> latencies; // 微秒
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < slow_num; i++)
+    {
+        threads.emplace_back([&]() {
+            Client::RpcClient client(false, "127.0.0.1", port);
+            while (running)
+            {
+                Json::Value params, result;
+                params["n"] = fib_n;
+                client.call("Fib", params, result);
+            }
+        });
+    }
+
+    for (int i = 0; i < fast_num; i++)
+    {
+        threads.emplace_back([&, i]() {
+            Client::RpcClient client(false, "127.0.0.1", port);
+            std::vector<double> local;
+            while (running)
+            {
+                Json::Value params, result;
+                params["num1"] = i;
+                params["num2"] = (int)local.size();
+
+                auto begin = std::chrono::steady_clock::now();
+                if (!client.call("Add", params, result))
+                    continue;
+                auto end = std::chrono::steady_clock::now();
+                local.push_back(std::chrono::duration<double, std::micro>(end - begin).count());
+            }
+
+            std::unique_lock<std::mutex> lock(mtx);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    if (latencies.empty())
+    {
+        printf("no Add call completed\n");
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto pct = [&](double p) { return latencies[(size_t)(p * (latencies.size() - 1))]; };
+    printf("Add calls: %zu, p50: %.0fus, p99: %.0fus, max: %.0fus\n",
+        latencies.size(), pct(0.5), pct(0.99), latencies.back());
+    return 0;
+}
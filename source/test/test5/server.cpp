@@ -0,0 +1,67 @@
+#include "../../common/util.hpp"
+#include "../../server/rpc_server.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+using namespace JsonRpc;
+
+void Add(Json::Value& req, Json::Value& rsp)
+{
+    int num1 = req["num1"].asInt();
+    int num2 = req["num2"].asInt();
+    rsp = num1 + num2;
+}
+
+// cpu 密集型方法，用于观察慢方法对 Add 延迟的影响
+int fib(int n)
+{
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+void Fib(Json::Value& req, Json::Value& rsp)
+{
+    rsp = fib(req["n"].asInt());
+}
+
+Server::ExecPolicy parsePolicy(const char* name)
+{
+    if (strcmp(name, "shared") == 0 || strcmp(name, "steal") == 0)
+        return Server::ExecPolicy::SHARED_POOL;
+    if (strcmp(name, "bulkhead") == 0)
+        return Server::ExecPolicy::BULKHEAD;
+    return Server::ExecPolicy::INLINE;
+}
+
+// ./server [port] [io线程数] [Fib执行方式: inline|shared|steal|bulkhead] [线程池大小]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int thread_num = argc > 2 ? atoi(argv[2]) : 0;
+    Server::ExecPolicy fib_policy = parsePolicy(argc > 3 ? argv[3] : "inline");
+    int pool_size = argc > 4 ? atoi(argv[4]) : 2;
+
+    Server::RpcServer server({"127.0.0.1", port}, false, Address(), thread_num);
+    server.setSharedThreadNum(pool_size);
+    if (argc > 3 && strcmp(argv[3], "steal") == 0) // 共享线程池替换为工作窃取线程池
+        server.setSharedExecutor(ExecutorFactory::create<WorkStealingExecutor>("RpcSteal", pool_size));
+
+    auto add_build = std::make_shared<Server::ServiceDescriberBuilder>();
+    add_build->setName("Add");
+    add_build->setParamsDesc("num1", Server::VType::INTERGAL);
+    add_build->setParamsDesc("num2", Server::VType::INTERGAL);
+    add_build->setReturnType(Server::VType::INTERGAL);
+    add_build->setCallback(Add);
+    server.registerMethod(add_build->build());
+
+    auto fib_build = std::make_shared<Server::ServiceDescriberBuilder>();
+    fib_build->setName("Fib");
+    fib_build->setParamsDesc("n", Server::VType::INTERGAL);
+    fib_build->setReturnType(Server::VType::INTERGAL);
+    fib_build->setCallback(Fib);
+    fib_build->setExecPolicy(fib_policy, pool_size);
+    server.registerMethod(fib_build->build());
+
+    server.start();
+    return 0;
+}
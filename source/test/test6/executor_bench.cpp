@@ -0,0 +1,117 @@
+#include "../../common/executor.hpp"
+
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include <atomic>
+
+using namespace JsonRpc;
+
+// muduo::ThreadPool(单一加锁队列) 与 WorkStealingExecutor 的对比
+// 1.burst: 多个外部线程同时提交大量小任务，模拟多个 I/O 线程投递请求
+// 2.spawn: 每个任务在工作线程中继续派生子任务，模拟业务回调拆分子任务
+
+static void work(int n)
+{
+    volatile int x = 0;
+    for (int i = 0; i < n; i++)
+        x = x + i;
+}
+
+static double seconds(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+static void waitDone(std::atomic<long>& done, long total)
+{
+    while (done.load() < total)
+        std::this_thread::yield();
+}
+
+double burst(const BaseExecutor::s_ptr& executor, int producers, long per_producer, int task_work)
+{
+    std::atomic<long> done(0);
+    long total = producers * per_producer;
+
+    auto begin = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; i++)
+    {
+        threads.emplace_back([&]() {
+            for (long j = 0; j < per_producer; j++)
+                executor->submit([&]() { work(task_work); done++; });
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    waitDone(done, total);
+    return total / seconds(begin);
+}
+
+// 每个根任务派生 fanout 个子任务，子任务再派生 fanout 个，共 depth 层
+static void spawnTree(const BaseExecutor::s_ptr& executor, int depth, int fanout, int task_work, std::atomic<long>& done)
+{
+    work(task_work);
+    done++;
+    if (depth == 0)
+        return;
+
+    for (int i = 0; i < fanout; i++)
+        executor->submit([=, &done]() { spawnTree(executor, depth - 1, fanout, task_work, done); });
+}
+
+double spawn(const BaseExecutor::s_ptr& executor, int roots, int depth, int fanout, int task_work)
+{
+    long per_root = 0;
+    for (long level = 0, n = 1; level <= depth; level++, n *= fanout)
+        per_root += n;
+
+    std::atomic<long> done(0);
+    long total = roots * per_root;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < roots; i++)
+        executor->submit([&]() { spawnTree(executor, depth, fanout, task_work, done); });
+
+    waitDone(done, total);
+    return total / seconds(begin);
+}
+
+void report(const char* name, const BaseExecutor::s_ptr& executor, double burst_rate, double spawn_rate)
+{
+    printf("%-14s burst: %10.0f task/s, spawn: %10.0f task/s", name, burst_rate, spawn_rate);
+
+    auto ws = std::dynamic_pointer_cast<WorkStealingExecutor>(executor);
+    if (ws)
+        printf(", executed: %lu, steals: %lu", (unsigned long)ws->executed(), (unsigned long)ws->steals());
+    printf("\n");
+}
+
+// ./executor_bench [工作线程数] [提交线程数] [每个提交线程的任务数] [单个任务的计算量]
+int main(int argc, char* argv[])
+{
+    int thread_num = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    int producers = argc > 2 ? atoi(argv[2]) : 4;
+    long per_producer = argc > 3 ? atol(argv[3]) : 200000;
+    int task_work = argc > 4 ? atoi(argv[4]) : 100;
+
+    printf("threads: %d, producers: %d, tasks: %ld, work: %d\n", thread_num, producers, producers * per_producer, task_work);
+
+    {
+        auto pool = ExecutorFactory::create<ThreadPoolExecutor>("ThreadPool", thread_num);
+        double b = burst(pool, producers, per_producer, task_work);
+        double s = spawn(pool, producers * 4, 6, 4, task_work);
+        report("muduo pool", pool, b, s);
+    }
+
+    {
+        auto ws = ExecutorFactory::create<WorkStealingExecutor>("WorkStealing", thread_num);
+        double b = burst(ws, producers, per_producer, task_work);
+        double s = spawn(ws, producers * 4, 6, 4, task_work);
+        report("work stealing", ws, b, s);
+    }
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include "../../common/executor.hpp"
+
+#include <cstdlib>
+#include <thread>
+
+using namespace JsonRpc;
+
+// SerialExecutor 在同步执行任务的目标执行器上排满长队列: 不能随队列长度递归投递(栈溢出)，且按提交顺序执行
+// 第一个任务执行期间提交其余任务，它们全部排在队列中，之后由 SerialExecutor 依次投递
+// ./serial_test [任务数]
+static bool run(const char* name, const BaseExecutor::s_ptr& target, long count)
+{
+    auto serial = ExecutorFactory::create<SerialExecutor>(target);
+    std::atomic<long> done(0);
+    std::atomic<bool> ordered(true);
+    serial->submit([&]() {
+        for (long i = 0; i < count; i++)
+        {
+            serial->submit([&, i]() {
+                if (done.load() != i)
+                    ordered = false;
+                done++;
+            });
+        }
+    });
+
+    while (done.load() < count) // 同步执行的目标执行器在 submit 返回时已全部执行完
+        std::this_thread::yield();
+
+    bool ok = ordered && serial->queueSize() == 0;
+    printf("%-16s %ld tasks: %s\n", name, count, ok ? "OK" : "MISMATCH");
+    return ok;
+}
+
+int main(int argc, char* argv[])
+{
+    long count = argc > 1 ? atol(argv[1]) : 100000;
+
+    bool ok = run("inline", ExecutorFactory::create<InlineExecutor>(), count);
+    ok = run("thread pool(0)", ExecutorFactory::create<ThreadPoolExecutor>("Serial", 0), count) && ok;
+    ok = run("work stealing(0)", ExecutorFactory::create<WorkStealingExecutor>("Serial", 0), count) && ok;
+    ok = run("thread pool(4)", ExecutorFactory::create<ThreadPoolExecutor>("Serial", 4), count) && ok;
+    return ok ? 0 : 1;
+}
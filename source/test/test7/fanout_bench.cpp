@@ -0,0 +1,80 @@
+#include "../../common/net.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace JsonRpc;
+
+// 主题扇出时每条投递消息的编码开销(不含网络发送)
+// 1.per-subscriber: 每个订阅者连接各自序列化一次(原实现)
+// 2.encode-once: 每次发布序列化一次，订阅者共享帧
+// 3.forward: 复用发布者的原始正文，只重写帧头
+
+static double elapsedNs(std::chrono::steady_clock::time_point begin)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// 模拟服务端收到发布请求: 编码后再从缓冲区解析出来
+BaseMessage::s_ptr receivePublish(const BaseProtocol::s_ptr& proto, int payload)
+{
+    auto req = MessageFactory::create<TopicRequest>();
+    req->setRid(UUID::uuid());
+    req->setMtype(MType::REQ_TOPIC);
+    req->setTopicKey("market.quote");
+    req->setTopicOpType(TopicOpType::TOPIC_PUBLISH);
+    req->setTopicMsg(std::string(payload, 'x'));
+
+    muduo::net::Buffer buffer;
+    buffer.append(proto->serialize(req));
+
+    BaseMessage::s_ptr msg;
+    proto->onMessage(BufferFactory::create(&buffer), msg);
+    return msg;
+}
+
+// ./fanout_bench [订阅者数] [发布次数] [消息长度]
+int main(int argc, char* argv[])
+{
+    int subscribers = argc > 1 ? atoi(argv[1]) : 5000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    int payload = argc > 3 ? atoi(argv[3]) : 256;
+
+    BaseProtocol::s_ptr proto = ProtocolFactory::create();
+    BaseMessage::s_ptr msg = receivePublish(proto, payload);
+    double deliveries = (double)subscribers * rounds;
+    size_t checksum = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (int i = 0; i < subscribers; i++)
+            checksum += proto->serialize(msg).size();
+    double per_sub = elapsedNs(begin) / deliveries;
+
+    std::vector<SharedFrame> outbox(subscribers);
+    begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        SharedFrame frame = proto->sharedFrame(msg, false);
+        for (int i = 0; i < subscribers; i++)
+            outbox[i] = frame;
+        checksum += outbox.back()->size();
+    }
+    double once = elapsedNs(begin) / deliveries;
+
+    begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++)
+    {
+        SharedFrame frame = proto->sharedFrame(msg, true);
+        for (int i = 0; i < subscribers; i++)
+            outbox[i] = frame;
+        checksum += outbox.back()->size();
+    }
+    double forward = elapsedNs(begin) / deliveries;
+
+    printf("subscribers: %d, rounds: %d, payload: %d bytes, checksum: %zu\n", subscribers, rounds, payload, checksum);
+    printf("per-subscriber: %8.1f ns/delivery\n", per_sub);
+    printf("encode-once:    %8.1f ns/delivery (%.1fx)\n", once, per_sub / once);
+    printf("forward:        %8.1f ns/delivery (%.1fx)\n", forward, per_sub / forward);
+    return 0;
+}
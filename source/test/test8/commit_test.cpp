@@ -0,0 +1,41 @@
+// 组提交的刷盘结果: 注入刷盘失败时等待中的提交收到失败且不计入刷盘次数，恢复后下一次提交成功
+#include "../../server/topic_store.hpp"
+
+#include <future>
+
+using namespace JsonRpc::Server;
+
+// 写入一条消息并等待提交结果
+static bool commit(TopicStore& store, const TopicLog::s_ptr& log, uint64_t seq)
+{
+    std::string body(128, 'x');
+    store.written(log->append(seq, "id", body));
+
+    auto done = std::make_shared<std::promise<bool>>();
+    store.onCommit([done](bool ok) { done->set_value(ok); });
+    return done->get_future().get();
+}
+
+int main()
+{
+    const std::string root = "./commit_data";
+    DurablePolicy policy;
+    policy.durable = true;
+
+    TopicStore store(root);
+    store.open("commit", policy);
+    store.remove("commit"); // 清理上次的数据
+    auto log = store.open("commit", policy);
+
+    store.setSyncFunc([](const TopicLog::s_ptr&) { return false; });
+    uint64_t syncs = store.syncs();
+    bool failed = !commit(store, log, 1);
+    bool uncounted = store.syncs() == syncs && store.syncFailures() > 0;
+    printf("sync failed:    %s\n", failed && uncounted ? "OK" : "MISMATCH");
+
+    store.setSyncFunc(TopicStore::SyncFunc());
+    bool recovered = commit(store, log, 2);
+    printf("sync recovered: %s\n", recovered ? "OK" : "MISMATCH");
+
+    return failed && uncounted && recovered ? 0 : 1;
+}
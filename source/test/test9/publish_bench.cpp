@@ -0,0 +1,87 @@
+#include "../../common/util.hpp"
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+#include <deque>
+#include <atomic>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 一个发布者、一个订阅者，统计订阅者收齐所有消息的耗时
+// ./publish_bench [port] [sync|async|noack|batch] [消息数] [async 在途窗口/batch 每批条数]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    std::string mode = argc > 2 ? argv[2] : "sync";
+    long count = argc > 3 ? atol(argv[3]) : 100000;
+    size_t window = argc > 4 ? atol(argv[4]) : 64;
+
+    const std::string topic = "bench";
+    std::atomic<long> received(0);
+
+    Client::TopicClient subscriber("127.0.0.1", port);
+    Client::TopicClient publisher("127.0.0.1", port);
+    publisher.createTopic(topic);
+    subscriber.subscribeTopic(topic, [&](const std::string&, const std::string&) { received++; });
+
+    std::string msg(64, 'x');
+    long failed = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    if (mode == "sync")
+    {
+        for (long i = 0; i < count; i++)
+            failed += !publisher.publishTopic(topic, msg);
+    }
+    else if (mode == "async") // 最多 window 个发布同时在途
+    {
+        std::deque<std::future<bool>> inflight;
+        for (long i = 0; i < count; i++)
+        {
+            if (inflight.size() >= window)
+            {
+                failed += !inflight.front().get();
+                inflight.pop_front();
+            }
+            inflight.push_back(publisher.publishTopicAsync(topic, msg));
+        }
+        for (auto& f : inflight)
+            failed += !f.get();
+    }
+    else if (mode == "noack")
+    {
+        for (long i = 0; i < count; i++)
+            failed += !publisher.publishTopicNoAck(topic, msg);
+    }
+    else if (mode == "batch") // 每批 window 条
+    {
+        Client::TopicManager::Batch batch;
+        for (long i = 0; i < count; i++)
+        {
+            batch.emplace_back(topic, msg);
+            if (batch.size() >= window || i + 1 == count)
+            {
+                failed += !publisher.publishBatch(batch);
+                batch.clear();
+            }
+        }
+    }
+    else
+    {
+        E_LOG("未知的发布方式: %s", mode.c_str());
+        return 1;
+    }
+
+    // 等待订阅者收齐
+    while (received < count - failed)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    double cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-6s messages: %ld, failed: %ld, seconds: %.3f, msg/s: %.0f\n", 
+        mode.c_str(), count, failed, cost, count / cost);
+
+    subscriber.shutDown();
+    publisher.shutDown();
+    return 0;
+}
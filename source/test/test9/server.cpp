@@ -0,0 +1,16 @@
+#include "../../server/rpc_server.hpp"
+
+#include <cstdlib>
+
+// ./server [port] [I/O 线程数] [主题分片数]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int thread_num = argc > 2 ? atoi(argv[2]) : 0;
+    int shard_num = argc > 3 ? atoi(argv[3]) : 0;
+
+    auto server = std::make_shared<JsonRpc::Server::TopicServer>(port, thread_num);
+    server->setShardNum(shard_num);
+    server->start();
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "../../common/util.hpp"
+#include "../../client/rpc_client.hpp"
+
+#include <thread>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+
+using namespace JsonRpc;
+
+// 多个发布者向大量主题异步发布，统计服务端确认的吞吐
+// ./shard_bench [port] [连接数] [主题数] [压测秒数] [每个连接的在途窗口]
+int main(int argc, char* argv[])
+{
+    int port = argc > 1 ? atoi(argv[1]) : 6666;
+    int conn_num = argc > 2 ? atoi(argv[2]) : 32;
+    int topic_num = argc > 3 ? atoi(argv[3]) : 1000;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    size_t window = argc > 5 ? atol(argv[5]) : 64;
+
+    {
+        Client::TopicClient client("127.0.0.1", port);
+        for (int i = 0; i < topic_num; i++)
+            client.createTopic("bench." + std::to_string(i));
+        client.shutDown();
+    }
+
+    std::atomic<bool> running(true);
+    std::atomic<long> total(0);
+    std::atomic<long> failed(0);
+    std::string msg(64, 'x');
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < conn_num; i++)
+    {
+        threads.emplace_back([&, i]() {
+            Client::TopicClient client("127.0.0.1", port);
+            std::deque<std::future<bool>> inflight;
+            long count = 0, next = i;
+            while (running)
+            {
+                if (inflight.size() >= window)
+                {
+                    inflight.front().get() ? count++ : failed++;
+                    inflight.pop_front();
+                }
+                inflight.push_back(client.publishTopicAsync("bench." + std::to_string(next++ % topic_num), msg));
+            }
+            for (auto& f : inflight)
+                f.get() ? count++ : failed++;
+            total += count;
+            client.shutDown();
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    running = false;
+    for (auto& t : threads)
+        t.join();
+
+    printf("connections: %d, topics: %d, seconds: %d, published: %ld, failed: %ld, msg/s: %.0f\n",
+        conn_num, topic_num, seconds, total.load(), failed.load(), (double)total / seconds);
+    return 0;
+}